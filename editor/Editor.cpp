@@ -11,6 +11,7 @@
 #include <i18n/TranslationManager.h>
 #include <entity/model/Mesh.h>
 #include <entity/model/MeshDynamic.h>
+#include <loader/mesh/ChiraMeshLoader.h>
 #include <entity/camera/EditorCamera.h>
 #include <ui/IPanel.h>
 #include <imfilebrowser.h>
@@ -69,7 +70,8 @@ public:
             this->setLoadedFile(path);
     }
 
-    void convertToModelTypeSelected(const std::string& extension, const std::string& type) const {
+    template<typename GetMeshData>
+    void saveSelectedMesh(const std::string& extension, GetMeshData getMeshData) const {
         std::string filepath = Dialogs::saveFile(extension);
         if (filepath.empty())
             return Dialogs::popupError(TR("error.modelviewer.filename_empty"));
@@ -78,11 +80,17 @@ public:
             return Dialogs::popupError(TR("error.modelviewer.no_model_present"));
 
         std::ofstream file{filepath, std::ios::binary};
-        std::vector<byte> meshData = Engine::getRoot()->getChild<Mesh>(this->meshId)->getMeshData(type);
+        std::vector<byte> meshData = getMeshData(*Engine::getRoot()->getChild<Mesh>(this->meshId));
         file.write(reinterpret_cast<const char*>(meshData.data()), static_cast<std::streamsize>(meshData.size()));
         file.close();
     }
 
+    void convertToModelTypeSelected(const std::string& extension, const std::string& type) const {
+        this->saveSelectedMesh(extension, [&type](const Mesh& mesh) {
+            return mesh.getMeshData(type);
+        });
+    }
+
     void convertToOBJSelected() const {
         this->convertToModelTypeSelected(".obj", "obj");
     }
@@ -91,6 +99,14 @@ public:
         this->convertToModelTypeSelected(".cmdl", "cmdl");
     }
 
+    void convertToOptimizedCMDLSelected() const {
+        // The mesh resource is shared with everything else that uses it, so only the saved copy is optimized
+        this->saveSelectedMesh(".cmdl", [](const Mesh& mesh) {
+            const auto resource = mesh.getMeshResource();
+            return ChiraMeshLoader::createMesh(resource->getVertices(), resource->getIndices(), {.optimize = true});
+        });
+    }
+
     void preRenderContents() override {
         this->modelDialog.SetTitle("Open Resource");
         this->modelDialog.SetTypeFilters({".json"});
@@ -111,6 +127,8 @@ public:
                     this->convertToOBJSelected();
                 if (ImGui::MenuItem(TRC("ui.menubar.convert_to_cmdl"))) // Convert to CMDL...
                     this->convertToCMDLSelected();
+                if (ImGui::MenuItem(TRC("ui.menubar.convert_to_optimized_cmdl"))) // Convert to Optimized CMDL...
+                    this->convertToOptimizedCMDLSelected();
                 ImGui::EndMenu();
             }
             ImGui::EndMainMenuBar();
@@ -131,6 +149,24 @@ public:
         ImGui::Checkbox(TRC("ui.editor.show_grid"), &this->showGrid);
         Engine::getRoot()->getChild("grid")->setVisible(this->showGrid);
         ImGui::Text("%s", this->loadedFile.c_str());
+        if (auto* mesh = dynamic_cast<Mesh*>(getEntityUnderMouse()))
+            ImGui::Text("%s", TRF("ui.editor.hovered_mesh", mesh->getMeshResource()->getIdentifier()).c_str());
+    }
+
+    // Casts a ray from the camera through the mouse cursor into the scene
+    [[nodiscard]] static Entity* getEntityUnderMouse() {
+        auto* camera = Engine::getRoot()->getCamera();
+        if (!camera)
+            return nullptr;
+        const auto mouse = ImGui::GetIO().MousePos;
+        const auto display = ImGui::GetIO().DisplaySize;
+        const glm::vec2 ndc{2.f * mouse.x / display.x - 1.f, 1.f - 2.f * mouse.y / display.y};
+        const auto inversePV = glm::inverse(camera->getProjection() * camera->getView());
+        auto nearPoint = inversePV * glm::vec4{ndc, -1.f, 1.f};
+        auto farPoint = inversePV * glm::vec4{ndc, 1.f, 1.f};
+        nearPoint /= nearPoint.w;
+        farPoint /= farPoint.w;
+        return Engine::getRoot()->raycast(glm::vec3{nearPoint}, glm::vec3{farPoint - nearPoint});
     }
 
     void setLoadedFile(const std::string& meshName) {
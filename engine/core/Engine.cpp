@@ -10,6 +10,7 @@
 #include <loader/mesh/OBJMeshLoader.h>
 #include <loader/mesh/ChiraMeshLoader.h>
 #include <resource/provider/FilesystemResourceProvider.h>
+#include <resource/Resource.h>
 #include <script/AngelScriptVM.h>
 #include <ui/debug/ConsolePanel.h>
 #include <ui/debug/ResourceUsageTrackerPanel.h>
@@ -222,6 +223,9 @@ void Engine::run() {
             SteamAPI::Client::runCallbacks();
         }
 #endif
+        Resource::processAsyncLoads();
+        Resource::processReloads();
+        Resource::cleanup();
         Events::update();
     } while (!Engine::device->shouldCloseAfterThisFrame());
 
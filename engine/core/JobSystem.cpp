@@ -0,0 +1,127 @@
+#include "JobSystem.h"
+
+using namespace chira;
+
+/// The job system and queue of the worker running on this thread
+static thread_local const JobSystem* CURRENT_JOB_SYSTEM = nullptr;
+static thread_local std::size_t CURRENT_QUEUE_INDEX = 0;
+
+JobSystem::JobSystem(unsigned int threadCount) {
+    const auto workerCount = threadCount > 1 ? threadCount - 1 : 0;
+    for (unsigned int i = 0; i <= workerCount; i++) {
+        this->queues.push_back(std::make_unique<JobQueue>());
+    }
+    this->threads.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; i++) {
+        this->threads.emplace_back(&JobSystem::work, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::scoped_lock lock{this->sleepMutex};
+        this->stopping = true;
+    }
+    this->jobsAvailable.notify_all();
+    for (auto& thread : this->threads) {
+        thread.join();
+    }
+}
+
+void JobSystem::run(JobGroup& group, std::function<void()> job) {
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        auto& queue = *this->queues[this->getQueueIndex()];
+        std::scoped_lock lock{queue.mutex};
+        queue.jobs.push_back({std::move(job), &group});
+    }
+    this->queuedJobs.fetch_add(1, std::memory_order_release);
+    {
+        // Taking the lock makes sure a worker about to sleep sees the new job or gets the notification
+        std::scoped_lock lock{this->sleepMutex};
+    }
+    this->jobsAvailable.notify_one();
+}
+
+void JobSystem::wait(JobGroup& group) {
+    const auto queueIndex = this->getQueueIndex();
+    while (group.pending.load(std::memory_order_acquire) > 0) {
+        if (!this->tryRunJob(queueIndex))
+            std::this_thread::yield();
+    }
+    std::exception_ptr exception;
+    {
+        std::scoped_lock lock{group.exceptionMutex};
+        std::swap(exception, group.exception);
+    }
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+JobSystem& JobSystem::get() {
+    static JobSystem jobSystem;
+    return jobSystem;
+}
+
+std::size_t JobSystem::getQueueIndex() const {
+    if (CURRENT_JOB_SYSTEM == this)
+        return CURRENT_QUEUE_INDEX;
+    return this->queues.size() - 1;
+}
+
+bool JobSystem::tryRunJob(std::size_t queueIndex) {
+    if (this->queuedJobs.load(std::memory_order_acquire) == 0)
+        return false;
+
+    Job job;
+    bool found = false;
+    {
+        // Newest first from our own queue, it's the most likely to still be in the cache
+        auto& queue = *this->queues[queueIndex];
+        std::scoped_lock lock{queue.mutex};
+        if (!queue.jobs.empty()) {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+            found = true;
+        }
+    }
+    for (std::size_t i = 1; !found && i < this->queues.size(); i++) {
+        // Oldest first from everyone else, those tend to be the biggest pieces of work
+        auto& queue = *this->queues[(queueIndex + i) % this->queues.size()];
+        std::scoped_lock lock{queue.mutex};
+        if (!queue.jobs.empty()) {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            found = true;
+        }
+    }
+    if (!found)
+        return false;
+
+    this->queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    try {
+        job.function();
+    } catch (...) {
+        // Still counted as finished, otherwise the group would never finish
+        std::scoped_lock lock{job.group->exceptionMutex};
+        if (!job.group->exception)
+            job.group->exception = std::current_exception();
+    }
+    job.group->pending.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void JobSystem::work(std::size_t queueIndex) {
+    CURRENT_JOB_SYSTEM = this;
+    CURRENT_QUEUE_INDEX = queueIndex;
+    while (true) {
+        if (this->tryRunJob(queueIndex))
+            continue;
+        std::unique_lock lock{this->sleepMutex};
+        this->jobsAvailable.wait(lock, [this] {
+            return this->stopping || this->queuedJobs.load(std::memory_order_acquire) > 0;
+        });
+        if (this->stopping)
+            return;
+    }
+}
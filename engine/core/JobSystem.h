@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ThreadPool.h"
+
+namespace chira {
+
+/// Runs short jobs across a set of worker threads. Every worker has its own queue and steals from the
+/// others when it runs out, and threads waiting on jobs run queued jobs instead of blocking, so jobs
+/// can start more jobs and wait on them without deadlocking.
+class JobSystem {
+public:
+    /// Counts the unfinished jobs started with it, pass it to wait() to wait for all of them.
+    class JobGroup {
+        friend class JobSystem;
+        std::atomic<std::size_t> pending{0};
+        std::mutex exceptionMutex;
+        /// The first exception a job in the group threw
+        std::exception_ptr exception;
+    };
+
+    /// The thread count includes the thread that waits on jobs, so one thread means no workers at all.
+    explicit JobSystem(unsigned int threadCount = ThreadPool::getDefaultThreadCount() + 1);
+    ~JobSystem();
+    JobSystem(const JobSystem& other) = delete;
+    JobSystem& operator=(const JobSystem& other) = delete;
+    JobSystem(JobSystem&& other) noexcept = delete;
+    JobSystem& operator=(JobSystem&& other) noexcept = delete;
+
+    void run(JobGroup& group, std::function<void()> job);
+    /// Runs queued jobs on this thread until every job in the group has finished.
+    /// If any of them threw, the first exception is rethrown once they're all done.
+    void wait(JobGroup& group);
+    [[nodiscard]] std::size_t getThreadCount() const {
+        return this->threads.size() + 1;
+    }
+
+    /// The job system the engine uses
+    [[nodiscard]] static JobSystem& get();
+private:
+    struct Job {
+        std::function<void()> function;
+        JobGroup* group = nullptr;
+    };
+    struct JobQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    /// One per worker, and the last one is shared by every thread that isn't a worker
+    std::vector<std::unique_ptr<JobQueue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<std::size_t> queuedJobs{0};
+    std::mutex sleepMutex;
+    std::condition_variable jobsAvailable;
+    std::atomic<bool> stopping{false};
+
+    /// Index of the calling thread's queue
+    [[nodiscard]] std::size_t getQueueIndex() const;
+    /// Takes the newest job from the given queue, or the oldest job from any other queue
+    [[nodiscard]] bool tryRunJob(std::size_t queueIndex);
+    void work(std::size_t queueIndex);
+};
+
+} // namespace chira
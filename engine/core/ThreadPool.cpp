@@ -0,0 +1,53 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+using namespace chira;
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    this->threads.reserve(std::max(threadCount, 1u));
+    for (unsigned int i = 0; i < std::max(threadCount, 1u); i++) {
+        this->threads.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::scoped_lock lock{this->tasksMutex};
+        this->stopping = true;
+    }
+    this->tasksAvailable.notify_all();
+    for (auto& thread : this->threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::push(std::function<void()> task) {
+    {
+        std::scoped_lock lock{this->tasksMutex};
+        this->tasks.push(std::move(task));
+    }
+    this->tasksAvailable.notify_one();
+}
+
+unsigned int ThreadPool::getDefaultThreadCount() {
+    // hardware_concurrency is allowed to return 0 if it doesn't know
+    return std::max(std::thread::hardware_concurrency(), 2u) - 1;
+}
+
+void ThreadPool::work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock{this->tasksMutex};
+            this->tasksAvailable.wait(lock, [this] {
+                return this->stopping || !this->tasks.empty();
+            });
+            if (this->stopping)
+                return;
+            task = std::move(this->tasks.front());
+            this->tasks.pop();
+        }
+        task();
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace chira {
+
+/// A fixed set of worker threads pulling tasks off a shared queue.
+/// Tasks that have not started when the pool is destroyed are dropped, running tasks are waited on.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned int threadCount = ThreadPool::getDefaultThreadCount());
+    ~ThreadPool();
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+    ThreadPool(ThreadPool&& other) noexcept = delete;
+    ThreadPool& operator=(ThreadPool&& other) noexcept = delete;
+
+    void push(std::function<void()> task);
+    [[nodiscard]] std::size_t getThreadCount() const {
+        return this->threads.size();
+    }
+
+    /// One thread per hardware thread, leaving one for the main thread.
+    [[nodiscard]] static unsigned int getDefaultThreadCount();
+private:
+    std::vector<std::thread> threads;
+    std::queue<std::function<void()>> tasks;
+    std::mutex tasksMutex;
+    std::condition_variable tasksAvailable;
+    bool stopping = false;
+
+    void work();
+};
+
+} // namespace chira
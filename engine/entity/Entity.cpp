@@ -1,6 +1,11 @@
 #include "Entity.h"
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <core/JobSystem.h>
+#include <entity/root/Frame.h>
 #include <i18n/TranslationManager.h>
 #include <utility/UUIDGenerator.h>
 
@@ -8,12 +13,44 @@ using namespace chira;
 
 CHIRA_CREATE_LOG(ENTITY);
 
-Entity::Entity(std::string name_) : name(std::move(name_)) {}
+/// How many parallel updates are running, structural changes are deferred until this is zero
+static std::atomic<int> PARALLEL_UPDATE_DEPTH{0};
+static std::mutex DEFERRED_CHANGES_MUTEX;
+static std::vector<std::function<void()>> DEFERRED_CHANGES;
+
+/// Other threads might be moving transforms during a parallel update, the pool can't grow or shrink under them
+[[nodiscard]] static TransformHandle createTransform() {
+    runtime_assert(!Entity::isUpdatingInParallel(), "Entities can't be created during a parallel update, create them in Entity::runAtSyncPoint()");
+    return TransformPool::get().create();
+}
+
+Entity::Entity(std::string name_) : name(std::move(name_)), transform(createTransform()) {}
 
 Entity::Entity() : Entity(UUIDGenerator::getNewUUIDString()) {}
 
 Entity::~Entity() {
     this->removeAllChildren();
+    if (this->spatialFrame)
+        this->spatialFrame->removeSpatialBounds(this);
+    runtime_assert(!Entity::isUpdatingInParallel(), "Entities can't be deleted during a parallel update, remove them with removeChild()");
+    TransformPool::get().destroy(this->transform);
+}
+
+void* Entity::operator new(std::size_t size) {
+    return EntityAllocator::allocate(size);
+}
+
+void* Entity::operator new(std::size_t size, EntityArena& arena) {
+    return EntityAllocator::allocate(size, &arena);
+}
+
+void Entity::operator delete(void* pointer, std::size_t size) {
+    EntityAllocator::deallocate(pointer, size);
+}
+
+void Entity::operator delete(void* pointer, EntityArena& /*arena*/) {
+    // The size doesn't matter for memory that came from an arena
+    EntityAllocator::deallocate(pointer, 0);
 }
 
 void Entity::update() { // NOLINT(misc-no-recursion)
@@ -22,15 +59,125 @@ void Entity::update() { // NOLINT(misc-no-recursion)
     }
 }
 
-void Entity::render(glm::mat4 parentTransform) { // NOLINT(misc-no-recursion)
-    glm::mat4 transform = transformToMatrix(parentTransform, this->position, this->rotation);
+void Entity::updateInParallel(JobSystem& jobSystem) {
+    std::vector<Entity*> parallelChildren;
+    for (auto* entity : this->children) {
+        if (entity->canUpdateInParallel())
+            parallelChildren.push_back(entity);
+    }
+    // Nothing runs on another thread, so there's no reason to hold back tree changes
+    if (parallelChildren.empty()) {
+        Entity::update();
+        return;
+    }
+
+    PARALLEL_UPDATE_DEPTH++;
+    // A few jobs per thread is enough to balance the load without paying for a job per child
+    const auto jobSize = std::max<std::size_t>(1, parallelChildren.size() / (jobSystem.getThreadCount() * 4));
+    JobSystem::JobGroup group;
+    for (std::size_t start = 0; start < parallelChildren.size(); start += jobSize) {
+        const auto end = std::min(start + jobSize, parallelChildren.size());
+        jobSystem.run(group, [&parallelChildren, start, end] {
+            for (auto i = start; i < end; i++) {
+                parallelChildren[i]->update();
+            }
+        });
+    }
+    // A throwing update still has to end the parallel update, or entities could never be created again
+    std::exception_ptr exception;
+    try {
+        jobSystem.wait(group);
+    } catch (...) {
+        exception = std::current_exception();
+    }
+
+    if (--PARALLEL_UPDATE_DEPTH == 0) {
+        std::vector<std::function<void()>> changes;
+        {
+            std::scoped_lock lock{DEFERRED_CHANGES_MUTEX};
+            changes.swap(DEFERRED_CHANGES);
+        }
+        for (const auto& change : changes) {
+            change();
+        }
+    }
+    if (exception)
+        std::rethrow_exception(exception);
+
+    // The rest update after the parallel children are done, so they can change the tree right away again.
+    // That includes this entity's children, so they can't be iterated over directly
+    for (std::size_t i = 0; i < this->children.size(); i++) {
+        if (!this->children[i]->canUpdateInParallel())
+            this->children[i]->update();
+    }
+}
+
+bool Entity::canUpdateInParallel() const {
+    return this->parallelUpdate;
+}
+
+void Entity::setUpdateInParallel(bool parallel) {
+    this->parallelUpdate = parallel;
+}
+
+void Entity::runAtSyncPoint(std::function<void()> function) {
+    if (!Entity::isUpdatingInParallel()) {
+        function();
+        return;
+    }
+    std::scoped_lock lock{DEFERRED_CHANGES_MUTEX};
+    DEFERRED_CHANGES.push_back(std::move(function));
+}
+
+bool Entity::isUpdatingInParallel() {
+    return PARALLEL_UPDATE_DEPTH > 0;
+}
+
+void Entity::render() { // NOLINT(misc-no-recursion)
+    if (const auto localBounds = this->getLocalBounds(); !localBounds.isEmpty()) {
+        this->worldBounds = localBounds.transform(this->getWorldMatrix());
+        if (auto* frame = Frame::getRenderingFrame())
+            frame->updateSpatialBounds(this, this->worldBounds);
+    } else {
+        this->worldBounds = {};
+        if (this->spatialFrame)
+            this->spatialFrame->removeSpatialBounds(this);
+    }
     for (auto* entity : this->children) {
         if (entity->isVisible()) {
-            entity->render(transform);
+            entity->render();
+            this->worldBounds.expand(entity->getWorldBounds());
         }
     }
 }
 
+void Entity::updateTransforms() {
+    TransformPool::get().update();
+}
+
+const glm::mat4& Entity::getWorldMatrix() const {
+    return TransformPool::get().getWorldMatrix(this->transform);
+}
+
+void Entity::markTransformDirty() {
+    TransformPool::get().markDirty(this->transform);
+}
+
+void Entity::clearSpatialBounds() { // NOLINT(misc-no-recursion)
+    if (this->spatialFrame)
+        this->spatialFrame->removeSpatialBounds(this);
+    this->worldBounds = {};
+    for (auto* entity : this->children) {
+        entity->clearSpatialBounds();
+    }
+}
+
+void Entity::setParent(Entity* newParent) {
+    this->parent = newParent;
+    // Children of transform roots are placed relative to the root, which is the same as having no parent
+    TransformPool::get().setParent(this->transform, newParent && !newParent->isTransformRoot() ? newParent->transform : TransformHandle{});
+}
+
 const Frame* Entity::getFrame() const {
     if (!this->parent)
         return nullptr;
@@ -64,19 +211,20 @@ std::string_view Entity::getName() const {
 }
 
 Entity* Entity::getChild(std::string_view name_) const {
-    for (auto* entity : this->children) {
-        if (entity->getName() == name_) {
-            return entity;
-        }
-    }
+    if (const auto it = this->childIndices.find(name_); it != this->childIndices.end())
+        return this->children[it->second];
     return nullptr;
 }
 
 bool Entity::hasChild(std::string_view name_) const {
-    return static_cast<bool>(this->getChild(name_));
+    return this->childIndices.count(name_) > 0;
 }
 
 std::string_view Entity::addChild(Entity* child) {
+    if (Entity::isUpdatingInParallel()) {
+        Entity::runAtSyncPoint([this, child] { this->addChild(child); });
+        return child->getName();
+    }
     // Do not let two children have the same name!
     if (this->hasChild(child->getName())) {
         LOG_ENTITY.error(TRF("error.entity.duplicate_child_name", child->getName()));
@@ -84,19 +232,33 @@ std::string_view Entity::addChild(Entity* child) {
     }
     child->setParent(this);
     child->onAddedToTree();
+    this->childIndices[child->getName()] = this->children.size();
     this->children.push_back(child);
     return child->getName();
 }
 
 void Entity::removeChild(std::string_view name_) {
-    this->children.erase(std::remove_if(this->children.begin(), this->children.end(), [&name_](Entity* entity) {
-        if (entity->getName() == name_) {
-            entity->removeAllChildren();
-            delete entity;
-            return true;
-        }
-        return false;
-    }), this->children.end());
+    if (Entity::isUpdatingInParallel()) {
+        Entity::runAtSyncPoint([this, childName = std::string{name_}] { this->removeChild(childName); });
+        return;
+    }
+    const auto it = this->childIndices.find(name_);
+    if (it == this->childIndices.end())
+        return;
+    const auto index = it->second;
+    auto* entity = this->children[index];
+    // The name might belong to the entity, forget it before deleting the entity
+    this->childIndices.erase(it);
+
+    // Move the last child into the gap instead of shifting everything after it
+    if (index != this->children.size() - 1) {
+        this->children[index] = this->children.back();
+        this->childIndices[this->children[index]->getName()] = index;
+    }
+    this->children.pop_back();
+
+    entity->removeAllChildren();
+    delete entity;
 }
 
 void Entity::removeAllChildren() { // NOLINT(misc-no-recursion)
@@ -105,6 +267,7 @@ void Entity::removeAllChildren() { // NOLINT(misc-no-recursion)
         delete entity;
     }
     this->children.clear();
+    this->childIndices.clear();
 }
 
 bool Entity::isVisible() const {
@@ -113,30 +276,34 @@ bool Entity::isVisible() const {
 
 void Entity::setVisible(bool visibility) {
     this->visible = visibility;
+    // Hidden entities aren't rendered, so nothing would keep their bounds up to date
+    if (!visibility)
+        Entity::runAtSyncPoint([this] { this->clearSpatialBounds(); });
 }
 
 void Entity::setPosition(glm::vec3 newPos) {
-    this->position = newPos;
+    TransformPool::get().setPosition(this->transform, newPos);
 }
 
 void Entity::setRotation(glm::quat newRot) {
-    this->rotation = newRot;
+    TransformPool::get().setRotation(this->transform, newRot);
 }
 
 glm::vec3 Entity::getPosition() {
-    return this->position;
+    return TransformPool::get().getPosition(this->transform);
 }
 
-glm::vec3 Entity::getGlobalPosition() { // NOLINT(misc-no-recursion)
-    return this->getPosition() + this->parent->getGlobalPosition();
+glm::vec3 Entity::getGlobalPosition() {
+    return glm::vec3{TransformPool::get().getCurrentWorldMatrix(this->transform)[3]};
 }
 
 glm::quat Entity::getRotation() {
-    return this->rotation;
+    return TransformPool::get().getRotation(this->transform);
 }
 
 void Entity::translate(glm::vec3 translateByAmount) {
-    this->position += translateByAmount;
+    auto& pool = TransformPool::get();
+    pool.setPosition(this->transform, pool.getPosition(this->transform) + translateByAmount);
 }
 
 void Entity::translateWithRotation(glm::vec3 translateByAmount) {
@@ -146,11 +313,23 @@ void Entity::translateWithRotation(glm::vec3 translateByAmount) {
 }
 
 void Entity::rotate(glm::quat rotateByAmount) {
-    this->rotation += rotateByAmount;
+    auto& pool = TransformPool::get();
+    pool.setRotation(this->transform, pool.getRotation(this->transform) + rotateByAmount);
+}
+
+AABB Entity::getLocalBounds() const {
+    return {};
+}
+
+const AABB& Entity::getWorldBounds() const {
+    return this->worldBounds;
 }
 
 void Entity::rotate(glm::vec3 rotateByAmount) {
-    this->rotation = glm::rotate(this->rotation, rotateByAmount.x, glm::vec3{1,0,0});
-    this->rotation = glm::rotate(this->rotation, rotateByAmount.y, glm::vec3{0,1,0});
-    this->rotation = glm::rotate(this->rotation, rotateByAmount.z, glm::vec3{0,0,1});
+    auto& pool = TransformPool::get();
+    auto rotation = pool.getRotation(this->transform);
+    rotation = glm::rotate(rotation, rotateByAmount.x, glm::vec3{1,0,0});
+    rotation = glm::rotate(rotation, rotateByAmount.y, glm::vec3{0,1,0});
+    rotation = glm::rotate(rotation, rotateByAmount.z, glm::vec3{0,0,1});
+    pool.setRotation(this->transform, rotation);
 }
@@ -1,34 +1,73 @@
 #pragma once
 
+#include <functional>
 #include <unordered_map>
 #include <string>
 #include <string_view>
 #include <vector>
 #include <glm/glm.hpp>
 #include <core/Assertions.h>
+#include <math/Bounds.h>
+#include <math/BVH.h>
 #include <math/Matrix.h>
+#include "EntityAllocator.h"
+#include "TransformPool.h"
 
 namespace chira {
 
 class Group;
 class Frame;
+class JobSystem;
 
 /// The base entity class. Note that the name of an entity stored in the name variable should
 /// match the name assigned to the entity in the parent's entity map.
 /// Note the entity tree must have a Window as the root entity, always!
 /// Window objects are Frame objects, Frame objects are Root objects (the wonders of inheritance)
 class Entity {
+    // Frames keep track of where entities are in their spatial index
+    friend class Frame;
 public:
     explicit Entity(std::string name_);
     /// Initializes name to a random UUID.
     Entity();
     virtual ~Entity();
 
+    /// Entities are pooled by size, see EntityAllocator
+    [[nodiscard]] static void* operator new(std::size_t size);
+    /// Allocates the entity from the given arena, e.g. `new(arena) Mesh{...}`
+    [[nodiscard]] static void* operator new(std::size_t size, EntityArena& arena);
+    static void operator delete(void* pointer, std::size_t size);
+    /// Only called if the constructor throws
+    static void operator delete(void* pointer, EntityArena& arena);
+
     /// Run game logic.
     virtual void update();
 
-    /// Draw to screen.
-    virtual void render(glm::mat4 parentTransform);
+    /// Updates the children that can update in parallel as jobs, then the rest on this thread.
+    /// While the parallel children update, adding or removing children anywhere in the tree is deferred until
+    /// they're all done, and creating or deleting entities isn't allowed. Without any children that can update
+    /// in parallel this is the same as update(), and nothing is deferred.
+    /// Those rules are only checked by assertions. If an update throws, the other jobs still finish and the deferred
+    /// changes are applied, then the first exception is rethrown here.
+    void updateInParallel(JobSystem& jobSystem);
+    /// If true, this entity's update (and the update of everything under it) only touches its own subtree,
+    /// so it can run on another thread alongside its siblings. Off by default.
+    [[nodiscard]] virtual bool canUpdateInParallel() const;
+    void setUpdateInParallel(bool parallel);
+    /// Runs the function right away, or once the current parallel update is done if one is running.
+    /// Use this for anything that changes the entity tree from a parallel update, like creating an entity.
+    static void runAtSyncPoint(std::function<void()> function);
+    [[nodiscard]] static bool isUpdatingInParallel();
+
+    /// Draw to screen. Entities draw with their world matrix from the last updateTransforms() call,
+    /// which already includes every parent's transform.
+    virtual void render();
+
+    /// Recalculates the world matrices of every entity that moved, or whose parent moved.
+    /// Frames call this once before updating and once before rendering.
+    static void updateTransforms();
+    /// As of the last updateTransforms() call
+    [[nodiscard]] const glm::mat4& getWorldMatrix() const;
 
     [[nodiscard]] virtual const Frame* getFrame() const;
     [[nodiscard]] virtual Frame* getFrame();
@@ -49,11 +88,14 @@ public:
     void removeAllChildren();
 
     [[nodiscard]] bool isVisible() const;
+    /// Hiding an entity takes it and its children out of their frame's spatial index until it's shown and rendered again
     virtual void setVisible(bool visibility);
 
     virtual void setPosition(glm::vec3 newPos);
     virtual void setRotation(glm::quat newRot);
     [[nodiscard]] virtual glm::vec3 getPosition();
+    /// Recalculated on the spot if this entity or one of its parents moved since the last updateTransforms() call.
+    /// Parent rotations apply, so a child offset from a rotated parent is rotated around it.
     [[nodiscard]] virtual glm::vec3 getGlobalPosition();
     /// Note: the global rotation is inaccessible.
     [[nodiscard]] virtual glm::quat getRotation();
@@ -61,21 +103,42 @@ public:
     virtual void translateWithRotation(glm::vec3 translateByAmount);
     virtual void rotate(glm::quat rotateByAmount);
     virtual void rotate(glm::vec3 rotateByAmount);
+
+    /// Bounds of whatever this entity draws itself, in local space. Empty if it draws nothing.
+    [[nodiscard]] virtual AABB getLocalBounds() const;
+    /// Bounds of this entity and its visible children in world space, as of the last time it was rendered.
+    /// Empty while the entity is hidden.
+    [[nodiscard]] const AABB& getWorldBounds() const;
 protected:
     Entity* parent = nullptr;
     std::string name;
+    /// Children are in no particular order, removing a child moves the last child into its place
     std::vector<Entity*> children;
+    /// Index of each child in children, keyed by the child's name
+    std::unordered_map<std::string_view, std::size_t> childIndices;
     bool visible = true;
+    bool parallelUpdate = false;
+    AABB worldBounds;
+    /// The frame whose spatial index this entity is in, if any
+    Frame* spatialFrame = nullptr;
+    BVH::ObjectID spatialID = BVH::INVALID_ID;
 
-    // The following are in local space and are relative to the parent.
-    glm::vec3 position{};
-    glm::quat rotation = glm::identity<glm::quat>();
+    /// Position and rotation relative to the parent, and the matrices calculated from them
+    TransformHandle transform;
 
-    /// For internal use only!
-    void setParent(Entity* newParent) {
-        this->parent = newParent;
+    /// Call after changing the position or rotation
+    void markTransformDirty();
+    /// Children of transform roots are positioned relative to the root instead of the root's parent
+    [[nodiscard]] virtual bool isTransformRoot() const {
+        return false;
     }
 
+    /// Removes this entity and everything under it from the spatial index
+    void clearSpatialBounds();
+
+    /// For internal use only!
+    void setParent(Entity* newParent);
+
     /// Callback called after parent is set
     virtual void onAddedToTree() {}
 };
@@ -0,0 +1,172 @@
+#include "EntityAllocator.h"
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <core/Assertions.h>
+#include <core/Logger.h>
+
+using namespace chira;
+
+CHIRA_CREATE_LOG(ENTITYALLOCATOR);
+
+namespace {
+
+/// Stored in front of every entity so deleting it knows where the memory came from
+struct alignas(alignof(std::max_align_t)) AllocationHeader {
+    EntityArena* arena = nullptr;
+};
+
+constexpr std::size_t ALIGNMENT = alignof(std::max_align_t);
+constexpr std::size_t HEADER_SIZE = sizeof(AllocationHeader);
+/// Anything bigger than this comes straight from the system allocator
+constexpr std::size_t MAX_POOLED_SIZE = 2048;
+constexpr std::size_t SLAB_SIZE = 64 * 1024;
+
+[[nodiscard]] constexpr std::size_t alignSize(std::size_t size) {
+    return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+struct SizeClassPool {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<std::byte[]>> slabs;
+    /// Each free slot stores a pointer to the next free slot
+    void* freeList = nullptr;
+    std::size_t totalSlots = 0;
+    std::size_t liveSlots = 0;
+
+    void grow(std::size_t slotSize, std::size_t slotCount) {
+        auto& slab = this->slabs.emplace_back(new std::byte[slotSize * slotCount]);
+        // Link backwards so the slots get handed out front to back
+        for (std::size_t i = slotCount; i-- > 0;) {
+            auto* slot = slab.get() + i * slotSize;
+            *reinterpret_cast<void**>(slot) = this->freeList;
+            this->freeList = slot;
+        }
+        this->totalSlots += slotCount;
+    }
+};
+
+/// Indexed by slot size divided by the alignment
+using SizeClassPools = std::array<SizeClassPool, MAX_POOLED_SIZE / ALIGNMENT + 1>;
+
+[[nodiscard]] SizeClassPools& getPools() {
+    static SizeClassPools pools;
+    return pools;
+}
+
+[[nodiscard]] std::size_t getSlotsPerSlab(std::size_t slotSize) {
+    return std::max<std::size_t>(16, SLAB_SIZE / slotSize);
+}
+
+} // namespace
+
+EntityArena::EntityArena(std::size_t blockSize_) : blockSize(blockSize_), blockOffset(blockSize_) {}
+
+EntityArena::~EntityArena() {
+    if (this->liveCount > 0)
+        LOG_ENTITYALLOCATOR.error("Destroying an arena with {} entities still allocated from it!", this->liveCount);
+}
+
+void* EntityArena::allocate(std::size_t size) {
+    size = alignSize(size);
+    if (size > this->blockSize) {
+        // Give it its own block, and keep filling the current one
+        auto block = std::unique_ptr<std::byte[]>{new std::byte[size]};
+        void* memory = block.get();
+        this->blocks.insert(this->blocks.empty() ? this->blocks.end() : this->blocks.end() - 1, std::move(block));
+        this->reservedBytes += size;
+        this->usedBytes += size;
+        this->liveCount++;
+        return memory;
+    }
+    if (this->blockOffset + size > this->blockSize) {
+        this->blocks.emplace_back(new std::byte[this->blockSize]);
+        this->blockOffset = 0;
+        this->reservedBytes += this->blockSize;
+    }
+    void* memory = this->blocks.back().get() + this->blockOffset;
+    this->blockOffset += size;
+    this->usedBytes += size;
+    this->liveCount++;
+    return memory;
+}
+
+void EntityArena::deallocate() {
+    runtime_assert(this->liveCount > 0, "Deallocating from an arena with nothing allocated!");
+    this->liveCount--;
+}
+
+std::size_t EntityArena::getLiveCount() const {
+    return this->liveCount;
+}
+
+std::size_t EntityArena::getReservedBytes() const {
+    return this->reservedBytes;
+}
+
+std::size_t EntityArena::getUsedBytes() const {
+    return this->usedBytes;
+}
+
+void* EntityAllocator::allocate(std::size_t size, EntityArena* arena) {
+    const auto slotSize = alignSize(size) + HEADER_SIZE;
+    std::byte* memory;
+    if (arena) {
+        memory = static_cast<std::byte*>(arena->allocate(slotSize));
+    } else if (slotSize > MAX_POOLED_SIZE) {
+        memory = static_cast<std::byte*>(::operator new(slotSize));
+    } else {
+        auto& pool = getPools()[slotSize / ALIGNMENT];
+        std::scoped_lock lock{pool.mutex};
+        if (!pool.freeList)
+            pool.grow(slotSize, getSlotsPerSlab(slotSize));
+        memory = static_cast<std::byte*>(pool.freeList);
+        pool.freeList = *reinterpret_cast<void**>(memory);
+        pool.liveSlots++;
+    }
+    new(memory) AllocationHeader{arena};
+    return memory + HEADER_SIZE;
+}
+
+void EntityAllocator::deallocate(void* pointer, std::size_t size) {
+    if (!pointer)
+        return;
+    auto* memory = static_cast<std::byte*>(pointer) - HEADER_SIZE;
+    if (auto* arena = reinterpret_cast<AllocationHeader*>(memory)->arena) {
+        arena->deallocate();
+        return;
+    }
+    const auto slotSize = alignSize(size) + HEADER_SIZE;
+    if (slotSize > MAX_POOLED_SIZE) {
+        ::operator delete(memory);
+        return;
+    }
+    auto& pool = getPools()[slotSize / ALIGNMENT];
+    std::scoped_lock lock{pool.mutex};
+    *reinterpret_cast<void**>(memory) = pool.freeList;
+    pool.freeList = memory;
+    pool.liveSlots--;
+}
+
+void EntityAllocator::reserve(std::size_t size, std::size_t count) {
+    const auto slotSize = alignSize(size) + HEADER_SIZE;
+    if (slotSize > MAX_POOLED_SIZE)
+        return;
+    auto& pool = getPools()[slotSize / ALIGNMENT];
+    std::scoped_lock lock{pool.mutex};
+    if (const auto freeSlots = pool.totalSlots - pool.liveSlots; freeSlots < count)
+        pool.grow(slotSize, std::max(count - freeSlots, getSlotsPerSlab(slotSize)));
+}
+
+EntityAllocator::Statistics EntityAllocator::getStatistics() {
+    Statistics statistics;
+    auto& pools = getPools();
+    for (std::size_t i = 0; i < pools.size(); i++) {
+        std::scoped_lock lock{pools[i].mutex};
+        statistics.reservedBytes += pools[i].totalSlots * i * ALIGNMENT;
+        statistics.usedBytes += pools[i].liveSlots * i * ALIGNMENT;
+        statistics.liveAllocations += pools[i].liveSlots;
+    }
+    return statistics;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace chira {
+
+/// Hands out memory for entities from large blocks, freeing an entity doesn't give its memory back.
+/// Every block is released at once when the arena is destroyed, so every entity allocated from
+/// the arena must be deleted by then. Not thread safe, use an arena from one thread at a time.
+class EntityArena {
+public:
+    explicit EntityArena(std::size_t blockSize_ = 64 * 1024);
+    ~EntityArena();
+    EntityArena(const EntityArena& other) = delete;
+    EntityArena& operator=(const EntityArena& other) = delete;
+    EntityArena(EntityArena&& other) noexcept = delete;
+    EntityArena& operator=(EntityArena&& other) noexcept = delete;
+
+    [[nodiscard]] void* allocate(std::size_t size);
+    void deallocate();
+
+    /// Entities allocated from the arena that haven't been deleted yet
+    [[nodiscard]] std::size_t getLiveCount() const;
+    [[nodiscard]] std::size_t getReservedBytes() const;
+    [[nodiscard]] std::size_t getUsedBytes() const;
+private:
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::size_t blockSize;
+    /// Offset of the first free byte in the last block
+    std::size_t blockOffset;
+    std::size_t liveCount = 0;
+    std::size_t reservedBytes = 0;
+    std::size_t usedBytes = 0;
+};
+
+/// Keeps a pool of fixed size slots for every entity size, so entities of the same class are packed
+/// together and deleting one makes room for the next instead of going back to the system allocator.
+/// Entity allocates itself through this, so every `new SomeEntity{}` is pooled already.
+/// The pools are thread safe, each size has its own lock. Entities themselves still can't be created
+/// or deleted during a parallel update, see Entity::runAtSyncPoint.
+class EntityAllocator {
+public:
+    struct Statistics {
+        std::size_t reservedBytes = 0;
+        std::size_t usedBytes = 0;
+        std::size_t liveAllocations = 0;
+    };
+
+    /// Allocates from the arena if one is given, and from the pools otherwise
+    [[nodiscard]] static void* allocate(std::size_t size, EntityArena* arena = nullptr);
+    /// The size must be the same size the memory was allocated with
+    static void deallocate(void* pointer, std::size_t size);
+
+    /// Makes room for the given amount of entities of this type up front
+    template<typename EntityType>
+    static void reserve(std::size_t count) {
+        EntityAllocator::reserve(sizeof(EntityType), count);
+    }
+    static void reserve(std::size_t size, std::size_t count);
+
+    /// Only counts pooled memory, arenas keep their own statistics
+    [[nodiscard]] static Statistics getStatistics();
+};
+
+} // namespace chira
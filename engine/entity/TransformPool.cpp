@@ -0,0 +1,219 @@
+#include "TransformPool.h"
+
+#include <algorithm>
+#include <math/Matrix.h>
+
+using namespace chira;
+
+/// Moves every element to the position given by order, order[i] being the old index of the new element i
+template<typename T>
+static void applyOrder(std::vector<T>& values, const std::vector<std::uint32_t>& order) {
+    std::vector<T> sorted;
+    sorted.reserve(order.size());
+    for (auto index : order) {
+        sorted.push_back(values[index]);
+    }
+    values = std::move(sorted);
+}
+
+TransformHandle TransformPool::create() {
+    TransformHandle handle;
+    if (!this->freeHandles.empty()) {
+        handle.id = this->freeHandles.back();
+        this->freeHandles.pop_back();
+    } else {
+        handle.id = static_cast<std::uint32_t>(this->indices.size());
+        this->indices.emplace_back();
+    }
+    // Transforms without a parent can go anywhere, so appending keeps the order intact
+    this->indices[handle.id] = static_cast<std::uint32_t>(this->handles.size());
+    this->positions.emplace_back(0.f);
+    this->rotations.push_back(glm::identity<glm::quat>());
+    this->localMatrices.emplace_back(1.f);
+    this->worldMatrices.emplace_back(1.f);
+    this->parents.push_back(NO_PARENT);
+    this->parentHandles.emplace_back();
+    this->handles.push_back(handle);
+    this->dirty.push_back(true);
+    this->anyDirty = true;
+    return handle;
+}
+
+void TransformPool::destroy(TransformHandle handle) {
+    // Removing it from the arrays right away would shift everything after it, so that waits until the next update
+    this->handles[this->indices[handle.id]] = {};
+    this->indices[handle.id] = TransformHandle::INVALID;
+    this->destroyedHandles.push_back(handle.id);
+}
+
+void TransformPool::setParent(TransformHandle handle, TransformHandle parent) {
+    const auto index = this->indices[handle.id];
+    this->parentHandles[index] = parent;
+    this->parents[index] = parent ? this->indices[parent.id] : NO_PARENT;
+    if (parent && this->parents[index] > index)
+        this->orderBroken = true;
+    this->markDirty(handle);
+}
+
+glm::vec3 TransformPool::getPosition(TransformHandle handle) const {
+    return this->positions[this->indices[handle.id]];
+}
+
+void TransformPool::setPosition(TransformHandle handle, glm::vec3 position) {
+    const auto index = this->indices[handle.id];
+    this->positions[index] = position;
+    this->dirty[index] = true;
+    this->anyDirty = true;
+}
+
+glm::quat TransformPool::getRotation(TransformHandle handle) const {
+    return this->rotations[this->indices[handle.id]];
+}
+
+void TransformPool::setRotation(TransformHandle handle, glm::quat rotation) {
+    const auto index = this->indices[handle.id];
+    this->rotations[index] = rotation;
+    this->dirty[index] = true;
+    this->anyDirty = true;
+}
+
+const glm::mat4& TransformPool::getWorldMatrix(TransformHandle handle) const {
+    return this->worldMatrices[this->indices[handle.id]];
+}
+
+glm::mat4 TransformPool::getCurrentWorldMatrix(TransformHandle handle) const {
+    if (!this->anyDirty && this->destroyedHandles.empty())
+        return this->getWorldMatrix(handle);
+    glm::mat4 matrix{1.f};
+    for (auto current = handle; current && this->indices[current.id] != TransformHandle::INVALID;) {
+        const auto index = this->indices[current.id];
+        matrix = transformToMatrix(glm::identity<glm::mat4>(), this->positions[index], this->rotations[index]) * matrix;
+        current = this->parentHandles[index];
+    }
+    return matrix;
+}
+
+void TransformPool::markDirty(TransformHandle handle) {
+    this->dirty[this->indices[handle.id]] = true;
+    this->anyDirty = true;
+}
+
+void TransformPool::update() {
+    if (!this->destroyedHandles.empty())
+        this->compact();
+    if (this->orderBroken)
+        this->sortByDepth();
+    if (!this->anyDirty)
+        return;
+
+    const auto size = this->handles.size();
+    this->changed.resize(size);
+    for (std::size_t i = 0; i < size; i++) {
+        const auto parent = this->parents[i];
+        bool worldChanged = this->dirty[i];
+        if (worldChanged) {
+            this->localMatrices[i] = transformToMatrix(glm::identity<glm::mat4>(), this->positions[i], this->rotations[i]);
+            this->dirty[i] = false;
+        }
+        // The parent is always earlier in the arrays, so it's already up to date
+        if (parent != NO_PARENT)
+            worldChanged |= static_cast<bool>(this->changed[parent]);
+        this->changed[i] = worldChanged;
+        if (worldChanged)
+            this->worldMatrices[i] = parent != NO_PARENT ? this->worldMatrices[parent] * this->localMatrices[i] : this->localMatrices[i];
+    }
+    this->anyDirty = false;
+}
+
+std::size_t TransformPool::getSize() const {
+    return this->handles.size();
+}
+
+TransformPool& TransformPool::get() {
+    static TransformPool pool;
+    return pool;
+}
+
+void TransformPool::compact() {
+    std::vector<std::uint32_t> order;
+    order.reserve(this->handles.size());
+    for (std::uint32_t i = 0; i < this->handles.size(); i++) {
+        if (this->handles[i])
+            order.push_back(i);
+    }
+    applyOrder(this->positions, order);
+    applyOrder(this->rotations, order);
+    applyOrder(this->localMatrices, order);
+    applyOrder(this->worldMatrices, order);
+    applyOrder(this->parentHandles, order);
+    applyOrder(this->handles, order);
+    applyOrder(this->dirty, order);
+    this->parents.resize(this->handles.size());
+
+    this->freeHandles.insert(this->freeHandles.end(), this->destroyedHandles.begin(), this->destroyedHandles.end());
+    this->destroyedHandles.clear();
+    this->relinkParents();
+}
+
+void TransformPool::sortByDepth() {
+    const auto size = static_cast<std::uint32_t>(this->handles.size());
+    constexpr auto UNKNOWN = std::numeric_limits<std::uint32_t>::max();
+    std::vector<std::uint32_t> depths(size, UNKNOWN);
+    std::vector<std::uint32_t> chain;
+    std::uint32_t maxDepth = 0;
+    for (std::uint32_t i = 0; i < size; i++) {
+        // Walk up until a transform with a known depth, then fill in the depths on the way back down
+        auto current = i;
+        while (depths[current] == UNKNOWN && this->parents[current] != NO_PARENT) {
+            chain.push_back(current);
+            current = this->parents[current];
+        }
+        auto depth = depths[current] == UNKNOWN ? (depths[current] = 0) : depths[current];
+        while (!chain.empty()) {
+            depths[chain.back()] = ++depth;
+            chain.pop_back();
+        }
+        maxDepth = std::max(maxDepth, depths[i]);
+    }
+
+    // Counting sort, transforms at the same depth keep their order
+    std::vector<std::uint32_t> offsets(maxDepth + 2, 0);
+    for (auto depth : depths) {
+        offsets[depth + 1]++;
+    }
+    for (std::uint32_t depth = 1; depth < offsets.size(); depth++) {
+        offsets[depth] += offsets[depth - 1];
+    }
+    std::vector<std::uint32_t> order(size);
+    for (std::uint32_t i = 0; i < size; i++) {
+        order[offsets[depths[i]]++] = i;
+    }
+
+    applyOrder(this->positions, order);
+    applyOrder(this->rotations, order);
+    applyOrder(this->localMatrices, order);
+    applyOrder(this->worldMatrices, order);
+    applyOrder(this->parentHandles, order);
+    applyOrder(this->handles, order);
+    applyOrder(this->dirty, order);
+    this->relinkParents();
+    this->orderBroken = false;
+}
+
+void TransformPool::relinkParents() {
+    for (std::uint32_t i = 0; i < this->handles.size(); i++) {
+        this->indices[this->handles[i].id] = i;
+    }
+    for (std::uint32_t i = 0; i < this->handles.size(); i++) {
+        auto& parent = this->parentHandles[i];
+        if (parent && this->indices[parent.id] == TransformHandle::INVALID) {
+            // The parent was destroyed
+            parent = {};
+            this->dirty[i] = true;
+            this->anyDirty = true;
+        }
+        this->parents[i] = parent ? this->indices[parent.id] : NO_PARENT;
+        if (this->parents[i] != NO_PARENT && this->parents[i] > i)
+            this->orderBroken = true;
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace chira {
+
+/// Stable reference to a transform in a TransformPool, the transform's data moves around inside the pool.
+struct TransformHandle {
+    static constexpr std::uint32_t INVALID = std::numeric_limits<std::uint32_t>::max();
+    std::uint32_t id = INVALID;
+
+    explicit inline operator bool() const { return id != INVALID; }
+    inline bool operator!() const { return id == INVALID; }
+};
+
+/// Stores every transform's position, rotation and matrices in separate contiguous arrays,
+/// ordered so parents always come before their children. That way update() can calculate
+/// every world matrix in one front to back pass.
+/// Different transforms can be moved from different threads at once, as long as nothing creates, destroys, reparents
+/// or updates transforms at the same time. Creating a transform can move every array, so that must happen on one
+/// thread while nothing else touches the pool. Entities can't be created during parallel updates for that reason.
+class TransformPool {
+public:
+    [[nodiscard]] TransformHandle create();
+    /// Children of the destroyed transform lose their parent
+    void destroy(TransformHandle handle);
+    /// Transforms without a parent are in world space
+    void setParent(TransformHandle handle, TransformHandle parent);
+
+    [[nodiscard]] glm::vec3 getPosition(TransformHandle handle) const;
+    void setPosition(TransformHandle handle, glm::vec3 position);
+    [[nodiscard]] glm::quat getRotation(TransformHandle handle) const;
+    void setRotation(TransformHandle handle, glm::quat rotation);
+    /// As of the last update() call
+    [[nodiscard]] const glm::mat4& getWorldMatrix(TransformHandle handle) const;
+    /// Same as getWorldMatrix() if nothing moved since the last update() call,
+    /// otherwise it's recalculated from this transform and its parents without touching the cache
+    [[nodiscard]] glm::mat4 getCurrentWorldMatrix(TransformHandle handle) const;
+    void markDirty(TransformHandle handle);
+
+    /// Recalculates the world matrix of every transform that changed or whose parent changed.
+    /// Does nothing if no transform changed since the last call.
+    void update();
+    [[nodiscard]] std::size_t getSize() const;
+
+    /// The pool entities keep their transforms in
+    [[nodiscard]] static TransformPool& get();
+private:
+    static constexpr std::uint32_t NO_PARENT = std::numeric_limits<std::uint32_t>::max();
+
+    /// Removes destroyed transforms, keeping the order of the rest
+    void compact();
+    /// Reorders everything by depth in the hierarchy so parents come first again
+    void sortByDepth();
+    /// Recalculates the parent indices from the parent handles after transforms moved
+    void relinkParents();
+
+    // Indexed by position in the pool
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::mat4> localMatrices;
+    std::vector<glm::mat4> worldMatrices;
+    std::vector<std::uint32_t> parents;
+    std::vector<TransformHandle> parentHandles;
+    std::vector<TransformHandle> handles;
+    /// The local matrix is out of date
+    std::vector<std::uint8_t> dirty;
+    /// Scratch space for update(), true if the world matrix changed this update
+    std::vector<std::uint8_t> changed;
+
+    /// Indexed by handle
+    std::vector<std::uint32_t> indices;
+    std::vector<std::uint32_t> freeHandles;
+    /// Destroyed handles can only be reused once nothing refers to them anymore
+    std::vector<std::uint32_t> destroyedHandles;
+
+    /// Set from whichever thread moves a transform, entities can move themselves during parallel updates
+    std::atomic<bool> anyDirty{false};
+    bool orderBroken = false;
+};
+
+} // namespace chira
@@ -18,7 +18,7 @@ public:
         return this->projection;
     }
     [[nodiscard]] glm::mat4 getView() {
-        return glm::lookAt(this->position, this->position + this->getFrontVector(), this->getUpVector());
+        return glm::lookAt(this->getPosition(), this->getPosition() + this->getFrontVector(), this->getUpVector());
     }
     void setFieldOfView(float fov_) {
         this->fov = fov_;
@@ -19,9 +19,9 @@ void Script::update() {
     Entity::update();
 }
 
-void Script::render(glm::mat4 parentTransform) {
+void Script::render() {
     this->script.callFunction<void>("render");
-    Entity::render(parentTransform);
+    Entity::render();
 }
 
 Script::~Script() {
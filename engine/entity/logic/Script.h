@@ -11,7 +11,11 @@ public:
     explicit Script(const std::string& scriptID);
     void onAddedToTree() override;
     void update() override;
-    void render(glm::mat4 parentTransform) override;
+    /// The script VM is shared by every script
+    [[nodiscard]] bool canUpdateInParallel() const override {
+        return false;
+    }
+    void render() override;
     ~Script() override;
 private:
     AngelScriptHolder script;
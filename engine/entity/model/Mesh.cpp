@@ -12,7 +12,7 @@ Mesh::Mesh(const std::string& meshId) : Entity() {
     this->mesh = Resource::getResource<MeshDataResource>(meshId);
 }
 
-void Mesh::render(glm::mat4 parentTransform) {
-    this->mesh->render(transformToMatrix(parentTransform, this->position, this->rotation));
-    Entity::render(parentTransform);
+void Mesh::render() {
+    this->mesh->render(this->getWorldMatrix());
+    Entity::render();
 }
@@ -9,7 +9,10 @@ class Mesh : public Entity {
 public:
     Mesh(std::string name_, const std::string& meshId);
     explicit Mesh(const std::string& meshId);
-    void render(glm::mat4 parentTransform) override;
+    void render() override;
+    [[nodiscard]] AABB getLocalBounds() const override {
+        return this->mesh->getBounds();
+    }
     [[nodiscard]] SharedPointer<MeshDataResource> getMeshResource() const {
         return this->mesh;
     }
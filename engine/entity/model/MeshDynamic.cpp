@@ -2,9 +2,13 @@
 
 using namespace chira;
 
-void MeshDynamic::render(glm::mat4 parentTransform) {
-    this->mesh.render(transformToMatrix(parentTransform, this->position, this->rotation));
-    Entity::render(parentTransform);
+void MeshDynamic::render() {
+    this->mesh.render(this->getWorldMatrix());
+    Entity::render();
+}
+
+AABB MeshDynamic::getLocalBounds() const {
+    return this->mesh.getBounds();
 }
 
 MeshDataBuilder* MeshDynamic::getMesh() {
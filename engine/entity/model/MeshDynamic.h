@@ -9,7 +9,8 @@ class MeshDynamic : public Entity {
 public:
     explicit MeshDynamic(std::string name_) : Entity(std::move(name_)) {}
     MeshDynamic() : Entity() {}
-    void render(glm::mat4 parentTransform) override;
+    void render() override;
+    [[nodiscard]] AABB getLocalBounds() const override;
     [[nodiscard]] MeshDataBuilder* getMesh();
 protected:
     MeshDataBuilder mesh;
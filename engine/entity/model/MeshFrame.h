@@ -9,7 +9,7 @@ class MeshFrame : public Frame {
 public:
     MeshFrame(std::string name_, int width_, int height_, ColorRGB backgroundColor_ = {}, bool smoothResize = true);
     MeshFrame(int width_, int height_, ColorRGB backgroundColor_ = {}, bool smoothResize = true);
-    void render(glm::mat4 parentTransform) override;
+    void render() override;
     [[nodiscard]] MeshDynamic* getMeshDynamic();
 protected:
     MeshDynamic mesh{};
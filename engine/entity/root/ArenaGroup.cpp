@@ -0,0 +1,16 @@
+#include "ArenaGroup.h"
+
+using namespace chira;
+
+ArenaGroup::ArenaGroup(std::string name_, std::size_t blockSize) : Group(std::move(name_)), arena(blockSize) {}
+
+ArenaGroup::ArenaGroup(std::size_t blockSize) : Group(), arena(blockSize) {}
+
+ArenaGroup::~ArenaGroup() {
+    // The children have to go before the arena they live in
+    this->removeAllChildren();
+}
+
+const EntityArena& ArenaGroup::getArena() const {
+    return this->arena;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <utility>
+#include <entity/EntityAllocator.h>
+#include "Group.h"
+
+namespace chira {
+
+/// A group that allocates its whole subtree from one arena, for things like levels that are loaded and
+/// unloaded all at once. Removing the group deletes the subtree and releases all of its memory in one go.
+/// Entities created by the group must stay in its subtree.
+class ArenaGroup : public Group {
+public:
+    explicit ArenaGroup(std::string name_, std::size_t blockSize = 64 * 1024);
+    explicit ArenaGroup(std::size_t blockSize = 64 * 1024);
+    ~ArenaGroup() override;
+
+    /// Allocates an entity from this group's arena, add it anywhere under this group
+    template<typename EntityType, typename... Params>
+    [[nodiscard]] EntityType* create(Params&&... params) {
+        return new(this->arena) EntityType{std::forward<Params>(params)...};
+    }
+
+    [[nodiscard]] const EntityArena& getArena() const;
+private:
+    EntityArena arena;
+};
+
+} // namespace chira
@@ -1,6 +1,7 @@
 #include "Frame.h"
 
 #include <core/Engine.h>
+#include <core/JobSystem.h>
 #include <render/shader/UBO.h>
 
 using namespace chira;
@@ -35,14 +36,21 @@ void Frame::recreateFramebuffer() {
                                                this->linearFiltering ? FilterMode::LINEAR : FilterMode::NEAREST, true);
 }
 
-void Frame::render(glm::mat4 /*parentTransform*/) {
+void Frame::update() {
+    // A frame inside a parallel update can't recalculate transforms while its siblings move
+    if (!Entity::isUpdatingInParallel())
+        this->updateTransforms();
+    this->updateInParallel(JobSystem::get());
+}
+
+void Frame::render() {
     Renderer::setClearColor(ColorRGBA{this->backgroundColor, 1.0f});
     Renderer::pushFrameBuffer(this->handle);
+    auto* previousRenderingFrame = Frame::renderingFrame;
+    Frame::renderingFrame = this;
 
-    auto tempPos = this->position;
-    this->position = {};
-    auto tempRot = this->rotation;
-    this->rotation = {};
+    // Pick up anything that moved during update
+    this->updateTransforms();
 
     // Push camera projection/view
     if (this->mainCamera) {
@@ -55,11 +63,19 @@ void Frame::render(glm::mat4 /*parentTransform*/) {
     // Push lighting
     this->getLightManager()->updateUBOs();
 
-    Group::render(glm::identity<glm::mat4>());
+    // Meshes in the tree only queue their draws, they are sorted and drawn all at once below
+    if (this->mainCamera) {
+        this->renderQueue.begin(this->mainCamera->getGlobalPosition(), Frustum{this->mainCamera->getProjection() * this->mainCamera->getView()});
+    } else {
+        this->renderQueue.begin({});
+    }
+    Group::render();
 
     if (this->renderSkybox) {
         this->skybox.render(glm::identity<glm::mat4>());
     }
+    this->renderQueue.execute();
+    this->spatialIndex.commit();
 
     // Pop camera projection/view
     if (this->mainCamera && Entity::getFrame() && Entity::getFrame()->getCamera()) {
@@ -74,14 +90,13 @@ void Frame::render(glm::mat4 /*parentTransform*/) {
         Entity::getFrame()->getLightManager()->updateUBOs();
     }
 
-    // (Hopefully) preserve any transformations from children
-    this->translate(tempPos);
-    this->rotate(tempRot);
-
+    Frame::renderingFrame = previousRenderingFrame;
     Renderer::popFrameBuffer();
 }
 
 Frame::~Frame() {
+    // Children remove themselves from the spatial index, so they need to go before it does
+    this->removeAllChildren();
     if (this->handle) {
         Renderer::destroyFrameBuffer(this->handle);
     }
@@ -92,7 +107,7 @@ void Frame::useFrameBufferTexture(TextureUnit activeTextureUnit /*= TextureUnit:
 }
 
 glm::vec3 Frame::getGlobalPosition() {
-    return this->position;
+    return this->getPosition();
 }
 
 const Frame* Frame::getFrame() const {
@@ -136,6 +151,7 @@ void Frame::setSkybox(const std::string& cubemapId) {
     if (!this->skyboxMeshCreated) {
         this->skybox.addCube({}, {1, 1, 1}, false);
         this->skybox.update();
+        this->skybox.setRenderPass(RenderPass::SKYBOX);
         this->skyboxMeshCreated = true;
     }
     this->skybox.setMaterial(Resource::getResource<MaterialCubemap>(cubemapId).castAssert<IMaterial>());
@@ -153,3 +169,63 @@ LightManager* Frame::getLightManager() {
 Renderer::FrameBufferHandle Frame::getRawHandle() const {
     return this->handle;
 }
+
+void Frame::updateSpatialBounds(Entity* entity, const AABB& bounds) {
+    if (entity->spatialFrame == this) {
+        if (this->spatialIndex.getBounds(entity->spatialID) != bounds)
+            this->spatialIndex.update(entity->spatialID, bounds);
+        return;
+    }
+    if (entity->spatialFrame)
+        entity->spatialFrame->removeSpatialBounds(entity);
+    entity->spatialFrame = this;
+    entity->spatialID = this->spatialIndex.insert(bounds);
+    if (entity->spatialID >= this->spatialEntities.size())
+        this->spatialEntities.resize(entity->spatialID + 1);
+    this->spatialEntities[entity->spatialID] = entity;
+}
+
+void Frame::removeSpatialBounds(Entity* entity) {
+    if (entity->spatialFrame != this)
+        return;
+    this->spatialIndex.remove(entity->spatialID);
+    this->spatialEntities[entity->spatialID] = nullptr;
+    entity->spatialFrame = nullptr;
+    entity->spatialID = BVH::INVALID_ID;
+}
+
+std::vector<Entity*> Frame::getEntitiesInFrustum(const Frustum& frustum) const {
+    std::vector<BVH::ObjectID> ids;
+    this->spatialIndex.queryFrustum(frustum, ids);
+    std::vector<Entity*> out;
+    out.reserve(ids.size());
+    for (auto id : ids) {
+        // Entities removed this frame are still in the tree until it's committed
+        if (auto* entity = this->spatialEntities[id])
+            out.push_back(entity);
+    }
+    return out;
+}
+
+std::vector<Entity*> Frame::getEntitiesInSphere(glm::vec3 center, float radius) const {
+    std::vector<BVH::ObjectID> ids;
+    this->spatialIndex.querySphere(center, radius, ids);
+    std::vector<Entity*> out;
+    out.reserve(ids.size());
+    for (auto id : ids) {
+        if (auto* entity = this->spatialEntities[id])
+            out.push_back(entity);
+    }
+    return out;
+}
+
+Entity* Frame::raycast(glm::vec3 origin, glm::vec3 direction, float* distance) const {
+    const auto id = this->spatialIndex.raycast(origin, direction, distance);
+    if (id == BVH::INVALID_ID)
+        return nullptr;
+    return this->spatialEntities[id];
+}
+
+Frame* Frame::getRenderingFrame() {
+    return Frame::renderingFrame;
+}
@@ -4,6 +4,7 @@
 #include <math/Types.h>
 #include <render/mesh/MeshDataBuilder.h>
 #include <render/material/MaterialCubemap.h>
+#include <render/queue/RenderQueue.h>
 
 #include "Group.h"
 #include "../light/LightManager.h"
@@ -17,7 +18,8 @@ public:
     /// Deletes and recreates the existing framebuffer if one already exists.
     /// If one doesn't exist, initialize a new framebuffer.
     void recreateFramebuffer();
-    void render(glm::mat4 parentTransform) override;
+    void update() override;
+    void render() override;
     ~Frame() override;
     void useFrameBufferTexture(TextureUnit activeTextureUnit = TextureUnit::G0) const;
     [[nodiscard]] glm::vec3 getGlobalPosition() override;
@@ -33,7 +35,26 @@ public:
     [[nodiscard]] SharedPointer<MaterialCubemap> getSkybox() const;
     [[nodiscard]] LightManager* getLightManager();
     [[nodiscard]] Renderer::FrameBufferHandle getRawHandle() const;
+
+    /// Queues a change to where the entity is in the spatial index, changes are applied at the end of the frame.
+    /// Entities with bounds are added automatically when they're rendered, and removed when they're hidden.
+    /// Bounds that didn't change since the last call are ignored, so entities that stand still cost nothing.
+    void updateSpatialBounds(Entity* entity, const AABB& bounds);
+    void removeSpatialBounds(Entity* entity);
+    /// Entities whose world bounds were inside the frustum when this frame was last rendered
+    [[nodiscard]] std::vector<Entity*> getEntitiesInFrustum(const Frustum& frustum) const;
+    [[nodiscard]] std::vector<Entity*> getEntitiesInSphere(glm::vec3 center, float radius) const;
+    /// Returns the entity with the closest world bounds the ray hits, or nullptr
+    [[nodiscard]] Entity* raycast(glm::vec3 origin, glm::vec3 direction, float* distance = nullptr) const;
+
+    /// The innermost frame currently being rendered, or nullptr
+    [[nodiscard]] static Frame* getRenderingFrame();
 protected:
+    /// Entities in a frame are positioned relative to the frame
+    [[nodiscard]] bool isTransformRoot() const override {
+        return true;
+    }
+
     ColorRGB backgroundColor{};
     Renderer::FrameBufferHandle handle{};
     int width = 0, height = 0;
@@ -45,6 +66,12 @@ protected:
     Camera* mainCamera = nullptr;
 
     LightManager lightManager{};
+    RenderQueue renderQueue;
+    BVH spatialIndex;
+    /// Indexed by the IDs in the spatial index
+    std::vector<Entity*> spatialEntities;
+
+    static inline Frame* renderingFrame = nullptr;
 };
 
 } // namespace chira
@@ -23,8 +23,30 @@ void Image::compile(const byte buffer[], std::size_t bufferLen) {
     this->bitDepth = bd;
 }
 
+void Image::compileMapped(const std::shared_ptr<const MappedFile>& file) {
+    int w, h, bd;
+    this->image = Image::getUncompressedImage(file->getData(), static_cast<int>(file->getSize()), &w, &h, &bd, 0, this->isVerticallyFlipped());
+    this->width = w;
+    this->height = h;
+    this->bitDepth = bd;
+}
+
+bool Image::unloadForReload() {
+    Image::deleteUncompressedImage(this->image);
+    this->image = nullptr;
+    return true;
+}
+
+std::size_t Image::getCPUMemoryUsage() const {
+    std::size_t size = Resource::getCPUMemoryUsage();
+    if (this->image)
+        size += static_cast<std::size_t>(this->width) * this->height * this->bitDepth;
+    return size;
+}
+
 byte* Image::getUncompressedImage(const byte buffer[], int bufferLen, int* width, int* height, int* fileChannels, int desiredChannels, bool vflip) {
-    stbi_set_flip_vertically_on_load(vflip);
+    // Images can be decoded on resource loader threads, so don't touch stb_image's global flip setting
+    stbi_set_flip_vertically_on_load_thread(vflip);
     return stbi_load_from_memory(buffer, bufferLen, width, height, fileChannels, desiredChannels);
 }
 
@@ -34,7 +56,7 @@ byte* Image::getUncompressedImage(const byte buffer[], int bufferLen, int desire
 }
 
 byte* Image::getUncompressedImage(std::string_view filepath, int* width, int* height, int* fileChannels, int desiredChannels, bool vflip) {
-    stbi_set_flip_vertically_on_load(vflip);
+    stbi_set_flip_vertically_on_load_thread(vflip);
     return stbi_load(filepath.data(), width, height, fileChannels, desiredChannels);
 }
 
@@ -15,6 +15,13 @@ public:
     Image& operator=(Image&& other) noexcept = default;
 
     void compile(const byte buffer[], std::size_t bufferLen) override;
+    /// Decodes straight from the mapping, stb_image doesn't need it to be null-terminated.
+    void compileMapped(const std::shared_ptr<const MappedFile>& file) override;
+    [[nodiscard]] bool canCompileAsync() const override {
+        return true;
+    }
+    bool unloadForReload() override;
+    [[nodiscard]] std::size_t getCPUMemoryUsage() const override;
     [[nodiscard]] inline byte* getData() const {
         return this->image;
     }
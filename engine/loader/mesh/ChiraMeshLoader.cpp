@@ -1,48 +1,432 @@
 #include "ChiraMeshLoader.h"
 
+#include <cmath>
 #include <cstring>
 #include <algorithm>
+#include <glm/gtc/packing.hpp>
 #include <core/Logger.h>
 #include <resource/BinaryResource.h>
 #include <i18n/TranslationManager.h>
+#include <math/MeshOptimizer.h>
+#include <utility/LZ4.h>
 
 using namespace chira;
 
 CHIRA_CREATE_LOG(CMDL);
 
+namespace {
+
+constexpr std::uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr std::uint32_t MESHLET_MAX_TRIANGLES = 124;
+/// Quantized UVs are half floats, which get too coarse for texture coordinates past this
+constexpr float QUANTIZED_UV_LIMIT = 2.f;
+/// Every byte of LZ4 data decompresses to at most this many bytes, anything claiming more is corrupt
+constexpr std::uint64_t LZ4_MAX_EXPANSION = 255;
+
+struct Meshlet {
+    std::uint32_t vertexOffset = 0;
+    std::uint32_t vertexCount = 0;
+    /// In bytes, each triangle is three bytes
+    std::uint32_t triangleOffset = 0;
+    std::uint32_t triangleCount = 0;
+};
+
+struct PendingSection {
+    ChiraMeshSectionType type;
+    ChiraMeshEncoding encoding;
+    std::vector<byte> data;
+};
+
+[[nodiscard]] constexpr std::size_t alignOffset(std::size_t offset) {
+    return (offset + CHIRA_MESH_SECTION_ALIGNMENT - 1) / CHIRA_MESH_SECTION_ALIGNMENT * CHIRA_MESH_SECTION_ALIGNMENT;
+}
+
+[[nodiscard]] std::uint64_t getChecksum(const byte* data, std::size_t size) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template<typename T>
+void write(std::vector<byte>& out, const T& value) {
+    const auto offset = out.size();
+    out.resize(offset + sizeof(T));
+    std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+template<typename T>
+[[nodiscard]] T read(const byte* data, std::size_t index) {
+    T value;
+    std::memcpy(&value, data + index * sizeof(T), sizeof(T));
+    return value;
+}
+
+[[nodiscard]] float signNotZero(float value) {
+    return value >= 0.f ? 1.f : -1.f;
+}
+
+[[nodiscard]] glm::vec2 encodeOctahedral(glm::vec3 normal) {
+    normal /= std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (normal.z >= 0.f)
+        return {normal.x, normal.y};
+    return {(1.f - std::abs(normal.y)) * signNotZero(normal.x), (1.f - std::abs(normal.x)) * signNotZero(normal.y)};
+}
+
+[[nodiscard]] glm::vec3 decodeOctahedral(glm::vec2 encoded) {
+    glm::vec3 normal{encoded.x, encoded.y, 1.f - std::abs(encoded.x) - std::abs(encoded.y)};
+    if (normal.z < 0.f) {
+        normal.x = (1.f - std::abs(encoded.y)) * signNotZero(encoded.x);
+        normal.y = (1.f - std::abs(encoded.x)) * signNotZero(encoded.y);
+    }
+    return glm::normalize(normal);
+}
+
+[[nodiscard]] std::vector<byte> buildMeshlets(std::size_t vertexCount, const std::vector<Index>& indices) {
+    std::vector<Meshlet> meshlets;
+    std::vector<std::uint32_t> meshletVertices;
+    std::vector<std::uint8_t> meshletTriangles;
+    // A vertex is in the current meshlet if its mark is the current meshlet's number
+    std::vector<std::uint32_t> marks(vertexCount, ~0u);
+    std::vector<std::uint8_t> localIndices(vertexCount);
+
+    Meshlet current;
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        std::uint32_t newVertices = 0;
+        for (std::size_t corner = 0; corner < 3; corner++) {
+            if (marks[indices[i + corner]] != meshlets.size())
+                newVertices++;
+        }
+        if (current.vertexCount + newVertices > MESHLET_MAX_VERTICES || current.triangleCount == MESHLET_MAX_TRIANGLES) {
+            meshlets.push_back(current);
+            current = {static_cast<std::uint32_t>(meshletVertices.size()), 0, static_cast<std::uint32_t>(meshletTriangles.size()), 0};
+        }
+        for (std::size_t corner = 0; corner < 3; corner++) {
+            const auto index = indices[i + corner];
+            if (marks[index] != meshlets.size()) {
+                marks[index] = static_cast<std::uint32_t>(meshlets.size());
+                localIndices[index] = static_cast<std::uint8_t>(current.vertexCount++);
+                meshletVertices.push_back(index);
+            }
+            meshletTriangles.push_back(localIndices[index]);
+        }
+        current.triangleCount++;
+    }
+    if (current.triangleCount > 0)
+        meshlets.push_back(current);
+
+    std::vector<byte> out;
+    write(out, static_cast<std::uint32_t>(meshlets.size()));
+    for (const auto& meshlet : meshlets) {
+        write(out, meshlet);
+    }
+    for (const auto vertex : meshletVertices) {
+        write(out, vertex);
+    }
+    out.insert(out.end(), meshletTriangles.begin(), meshletTriangles.end());
+    return out;
+}
+
+/// Checks the section's size against the counts in the header without reading its data
+[[nodiscard]] bool hasValidSize(const ChiraMeshSection& section, std::uint64_t vertexCount, std::uint64_t indexCount) {
+    switch (section.type) {
+        case ChiraMeshSectionType::POSITIONS:
+            return section.encoding == ChiraMeshEncoding::FLOAT32 && section.size == vertexCount * sizeof(float) * 3;
+        case ChiraMeshSectionType::NORMALS:
+        case ChiraMeshSectionType::COLORS:
+            if (section.encoding == ChiraMeshEncoding::FLOAT32)
+                return section.size == vertexCount * sizeof(float) * 3;
+            if (section.encoding == (section.type == ChiraMeshSectionType::NORMALS ? ChiraMeshEncoding::OCTAHEDRAL_SNORM16 : ChiraMeshEncoding::UNORM8))
+                return section.size == vertexCount * sizeof(std::uint32_t);
+            return false;
+        case ChiraMeshSectionType::UVS:
+            if (section.encoding == ChiraMeshEncoding::FLOAT32)
+                return section.size == vertexCount * sizeof(float) * 2;
+            return section.encoding == ChiraMeshEncoding::FLOAT16 && section.size == vertexCount * sizeof(std::uint32_t);
+        case ChiraMeshSectionType::INDICES:
+            if (section.encoding == ChiraMeshEncoding::UINT16)
+                return section.size == indexCount * sizeof(std::uint16_t);
+            return section.encoding == ChiraMeshEncoding::UINT32 && section.size == indexCount * sizeof(std::uint32_t);
+        default:
+            return true;
+    }
+}
+
+[[nodiscard]] bool decodeSection(const ChiraMeshSection& section, const byte* data, std::vector<Vertex>& vertices, std::vector<Index>& indices) {
+    const auto vertexCount = vertices.size();
+    const auto hasSize = [&section](std::size_t count, std::size_t stride) {
+        return section.size == count * stride;
+    };
+    switch (section.type) {
+        case ChiraMeshSectionType::POSITIONS:
+            if (section.encoding != ChiraMeshEncoding::FLOAT32 || !hasSize(vertexCount, sizeof(float) * 3))
+                return false;
+            for (std::size_t i = 0; i < vertexCount; i++) {
+                vertices[i].position = {read<float>(data, i * 3), read<float>(data, i * 3 + 1), read<float>(data, i * 3 + 2)};
+            }
+            return true;
+        case ChiraMeshSectionType::NORMALS:
+            if (section.encoding == ChiraMeshEncoding::FLOAT32 && hasSize(vertexCount, sizeof(float) * 3)) {
+                for (std::size_t i = 0; i < vertexCount; i++) {
+                    vertices[i].normal = {read<float>(data, i * 3), read<float>(data, i * 3 + 1), read<float>(data, i * 3 + 2)};
+                }
+                return true;
+            }
+            if (section.encoding == ChiraMeshEncoding::OCTAHEDRAL_SNORM16 && hasSize(vertexCount, sizeof(std::uint32_t))) {
+                for (std::size_t i = 0; i < vertexCount; i++) {
+                    const auto normal = decodeOctahedral(glm::unpackSnorm2x16(read<std::uint32_t>(data, i)));
+                    vertices[i].normal = {normal.x, normal.y, normal.z};
+                }
+                return true;
+            }
+            return false;
+        case ChiraMeshSectionType::COLORS:
+            if (section.encoding == ChiraMeshEncoding::FLOAT32 && hasSize(vertexCount, sizeof(float) * 3)) {
+                for (std::size_t i = 0; i < vertexCount; i++) {
+                    vertices[i].color = {read<float>(data, i * 3), read<float>(data, i * 3 + 1), read<float>(data, i * 3 + 2)};
+                }
+                return true;
+            }
+            if (section.encoding == ChiraMeshEncoding::UNORM8 && hasSize(vertexCount, sizeof(std::uint32_t))) {
+                for (std::size_t i = 0; i < vertexCount; i++) {
+                    const auto color = glm::unpackUnorm4x8(read<std::uint32_t>(data, i));
+                    vertices[i].color = {color.r, color.g, color.b};
+                }
+                return true;
+            }
+            return false;
+        case ChiraMeshSectionType::UVS:
+            if (section.encoding == ChiraMeshEncoding::FLOAT32 && hasSize(vertexCount, sizeof(float) * 2)) {
+                for (std::size_t i = 0; i < vertexCount; i++) {
+                    vertices[i].uv = {read<float>(data, i * 2), read<float>(data, i * 2 + 1)};
+                }
+                return true;
+            }
+            if (section.encoding == ChiraMeshEncoding::FLOAT16 && hasSize(vertexCount, sizeof(std::uint32_t))) {
+                for (std::size_t i = 0; i < vertexCount; i++) {
+                    const auto uv = glm::unpackHalf2x16(read<std::uint32_t>(data, i));
+                    vertices[i].uv = {uv.x, uv.y};
+                }
+                return true;
+            }
+            return false;
+        case ChiraMeshSectionType::INDICES:
+            if (section.encoding == ChiraMeshEncoding::UINT16 && hasSize(indices.size(), sizeof(std::uint16_t))) {
+                for (std::size_t i = 0; i < indices.size(); i++) {
+                    indices[i] = read<std::uint16_t>(data, i);
+                }
+            } else if (section.encoding == ChiraMeshEncoding::UINT32 && hasSize(indices.size(), sizeof(std::uint32_t))) {
+                if (!indices.empty())
+                    std::memcpy(indices.data(), data, section.size);
+            } else {
+                return false;
+            }
+            return std::all_of(indices.begin(), indices.end(), [vertexCount](Index index) {
+                return index < vertexCount;
+            });
+        default:
+            // Meshlets and LODs aren't used by the renderer yet
+            return true;
+    }
+}
+
+} // namespace
+
 void ChiraMeshLoader::loadMesh(const std::string& identifier, std::vector<Vertex>& vertices, std::vector<Index>& indices) const {
     auto meshData = Resource::getResource<BinaryResource>(identifier);
-    if (meshData->getBufferLength() < CHIRA_MESH_HEADER_SIZE) {
-        // die
-        LOG_CMDL.error(TRF("error.cmdl_loader.invalid_data", identifier));
-        return;
+    ChiraMeshLoader::loadMeshData(identifier, meshData->getBuffer(), meshData->getBufferLength(), vertices, indices);
+}
+
+std::vector<byte> ChiraMeshLoader::createMesh(const std::vector<Vertex>& vertices, const std::vector<Index>& indices) const {
+    return ChiraMeshLoader::createMesh(vertices, indices, ChiraMeshOptions{});
+}
+
+std::vector<byte> ChiraMeshLoader::createMesh(const std::vector<Vertex>& vertices, const std::vector<Index>& indices, const ChiraMeshOptions& options) {
+    if (options.optimize) {
+        auto optimizedVertices = vertices;
+        auto optimizedIndices = indices;
+        MeshOptimizer::optimize(optimizedVertices, optimizedIndices);
+        auto optimizedOptions = options;
+        optimizedOptions.optimize = false;
+        return ChiraMeshLoader::createMesh(optimizedVertices, optimizedIndices, optimizedOptions);
+    }
+
+    std::vector<PendingSection> sections;
+
+    auto& positions = sections.emplace_back(PendingSection{ChiraMeshSectionType::POSITIONS, ChiraMeshEncoding::FLOAT32, {}}).data;
+    positions.reserve(vertices.size() * sizeof(float) * 3);
+    for (const auto& vertex : vertices) {
+        write(positions, vertex.position.x);
+        write(positions, vertex.position.y);
+        write(positions, vertex.position.z);
+    }
+
+    // Zero or unnormalized normals would come back as unit vectors
+    const bool quantizeNormals = options.quantize && std::all_of(vertices.begin(), vertices.end(), [](const Vertex& vertex) {
+        return std::abs(glm::length(glm::vec3{vertex.normal.r, vertex.normal.g, vertex.normal.b}) - 1.f) < 0.001f;
+    });
+    auto& normals = sections.emplace_back(PendingSection{ChiraMeshSectionType::NORMALS, quantizeNormals ? ChiraMeshEncoding::OCTAHEDRAL_SNORM16 : ChiraMeshEncoding::FLOAT32, {}}).data;
+    for (const auto& vertex : vertices) {
+        if (quantizeNormals) {
+            write(normals, glm::packSnorm2x16(encodeOctahedral({vertex.normal.r, vertex.normal.g, vertex.normal.b})));
+        } else {
+            write(normals, vertex.normal.r);
+            write(normals, vertex.normal.g);
+            write(normals, vertex.normal.b);
+        }
+    }
+
+    const bool quantizeColors = options.quantize && std::all_of(vertices.begin(), vertices.end(), [](const Vertex& vertex) {
+        return vertex.color.r >= 0.f && vertex.color.r <= 1.f && vertex.color.g >= 0.f && vertex.color.g <= 1.f && vertex.color.b >= 0.f && vertex.color.b <= 1.f;
+    });
+    auto& colors = sections.emplace_back(PendingSection{ChiraMeshSectionType::COLORS, quantizeColors ? ChiraMeshEncoding::UNORM8 : ChiraMeshEncoding::FLOAT32, {}}).data;
+    for (const auto& vertex : vertices) {
+        if (quantizeColors) {
+            write(colors, glm::packUnorm4x8({vertex.color.r, vertex.color.g, vertex.color.b, 1.f}));
+        } else {
+            write(colors, vertex.color.r);
+            write(colors, vertex.color.g);
+            write(colors, vertex.color.b);
+        }
+    }
+
+    const bool quantizeUVs = options.quantize && std::all_of(vertices.begin(), vertices.end(), [](const Vertex& vertex) {
+        return std::abs(vertex.uv.r) <= QUANTIZED_UV_LIMIT && std::abs(vertex.uv.g) <= QUANTIZED_UV_LIMIT;
+    });
+    auto& uvs = sections.emplace_back(PendingSection{ChiraMeshSectionType::UVS, quantizeUVs ? ChiraMeshEncoding::FLOAT16 : ChiraMeshEncoding::FLOAT32, {}}).data;
+    for (const auto& vertex : vertices) {
+        if (quantizeUVs) {
+            write(uvs, glm::packHalf2x16({vertex.uv.r, vertex.uv.g}));
+        } else {
+            write(uvs, vertex.uv.r);
+            write(uvs, vertex.uv.g);
+        }
+    }
+
+    // Lossless, so it doesn't need to be asked for
+    const bool shortIndices = vertices.size() <= 0x10000;
+    auto& indexData = sections.emplace_back(PendingSection{ChiraMeshSectionType::INDICES, shortIndices ? ChiraMeshEncoding::UINT16 : ChiraMeshEncoding::UINT32, {}}).data;
+    for (const auto index : indices) {
+        if (shortIndices)
+            write(indexData, static_cast<std::uint16_t>(index));
+        else
+            write(indexData, static_cast<std::uint32_t>(index));
     }
-    ChiraMeshHeader header;
-    std::memcpy(&header, meshData->getBuffer(), CHIRA_MESH_HEADER_SIZE);
 
-    // read mesh data
-    if (header.version == 1) {
+    if (options.meshlets)
+        sections.push_back({ChiraMeshSectionType::MESHLETS, ChiraMeshEncoding::UINT32, buildMeshlets(vertices.size(), indices)});
+
+    ChiraMeshHeaderV2 header;
+    header.vertexCount = static_cast<std::uint32_t>(vertices.size());
+    header.indexCount = static_cast<std::uint32_t>(indices.size());
+    header.sectionCount = static_cast<std::uint32_t>(sections.size());
+
+    std::vector<ChiraMeshSection> table(sections.size());
+    std::size_t offset = alignOffset(sizeof(ChiraMeshHeaderV2) + sizeof(ChiraMeshSection) * sections.size());
+    for (std::size_t i = 0; i < sections.size(); i++) {
+        auto& section = sections[i];
+        table[i].type = section.type;
+        table[i].encoding = section.encoding;
+        table[i].size = section.data.size();
+        if (options.compress) {
+            if (auto compressed = LZ4::compress(section.data.data(), section.data.size()); compressed.size() < section.data.size()) {
+                section.data = std::move(compressed);
+                table[i].compression = ChiraMeshCompression::LZ4;
+            }
+        }
+        table[i].dataOffset = offset;
+        table[i].storedSize = section.data.size();
+        offset = alignOffset(offset + section.data.size());
+    }
+
+    std::vector<byte> out(offset);
+    std::memcpy(out.data() + sizeof(ChiraMeshHeaderV2), table.data(), sizeof(ChiraMeshSection) * table.size());
+    for (std::size_t i = 0; i < sections.size(); i++) {
+        if (!sections[i].data.empty())
+            std::memcpy(out.data() + table[i].dataOffset, sections[i].data.data(), sections[i].data.size());
+    }
+    header.checksum = getChecksum(out.data() + sizeof(ChiraMeshHeaderV2), out.size() - sizeof(ChiraMeshHeaderV2));
+    std::memcpy(out.data(), &header, sizeof(ChiraMeshHeaderV2));
+    return out;
+}
+
+bool ChiraMeshLoader::loadMeshData(std::string_view identifier, const byte* data, std::size_t size, std::vector<Vertex>& vertices, std::vector<Index>& indices) {
+    const auto invalid = [identifier] {
+        LOG_CMDL.error(TRF("error.cmdl_loader.invalid_data", identifier));
+        return false;
+    };
+    if (size < sizeof(std::uint32_t))
+        return invalid();
+    const auto version = read<std::uint32_t>(data, 0);
+
+    if (version == 1) {
+        if (size < CHIRA_MESH_HEADER_SIZE)
+            return invalid();
+        ChiraMeshHeader header;
+        std::memcpy(&header, data, CHIRA_MESH_HEADER_SIZE);
+        const auto vertexSize = static_cast<std::size_t>(header.vertexCount) * sizeof(Vertex);
+        const auto indexSize = static_cast<std::size_t>(header.indexCount) * sizeof(Index);
+        if (size < CHIRA_MESH_HEADER_SIZE + vertexSize + indexSize)
+            return invalid();
         vertices.resize(header.vertexCount);
-        std::memcpy(vertices.data(), meshData->getBuffer() + CHIRA_MESH_HEADER_SIZE, header.vertexCount * sizeof(Vertex));
+        std::memcpy(vertices.data(), data + CHIRA_MESH_HEADER_SIZE, vertexSize);
         indices.resize(header.indexCount);
-        std::memcpy(indices.data(), meshData->getBuffer() + CHIRA_MESH_HEADER_SIZE + (header.vertexCount * sizeof(Vertex)), header.indexCount * sizeof(Index));
+        std::memcpy(indices.data(), data + CHIRA_MESH_HEADER_SIZE + vertexSize, indexSize);
+        return true;
+    }
+    if (version != 2) {
+        LOG_CMDL.error(TRF("error.cmdl_loader.unsupported_version", identifier, version));
+        return false;
     }
-}
 
-std::vector<byte> ChiraMeshLoader::createMesh(const std::vector<Vertex>& vertices, const std::vector<Index>& indices) const {
-    std::vector<byte> bytebuffer;
-    ChiraMeshHeader header;
-    header.version = 1;
-    header.vertexCount = static_cast<Index>(vertices.size());
-    header.indexCount = static_cast<Index>(indices.size());
-    const unsigned int VERTEX_SIZE = (sizeof(Vertex) * header.vertexCount);
-    const unsigned int INDEX_SIZE = (sizeof(Index) * header.indexCount);
-
-    // Since each element in bytebuffer is one byte wide, this works
-    bytebuffer.resize(CHIRA_MESH_HEADER_SIZE + VERTEX_SIZE + INDEX_SIZE);
-    std::memcpy(bytebuffer.data(), &header, CHIRA_MESH_HEADER_SIZE);
-    std::memcpy(&bytebuffer[CHIRA_MESH_HEADER_SIZE], vertices.data(), VERTEX_SIZE);
-    std::memcpy(&bytebuffer[CHIRA_MESH_HEADER_SIZE + VERTEX_SIZE], indices.data(), INDEX_SIZE);
-
-    return bytebuffer;
+    if (size < sizeof(ChiraMeshHeaderV2))
+        return invalid();
+    ChiraMeshHeaderV2 header;
+    std::memcpy(&header, data, sizeof(ChiraMeshHeaderV2));
+    if (size < sizeof(ChiraMeshHeaderV2) + sizeof(ChiraMeshSection) * static_cast<std::size_t>(header.sectionCount))
+        return invalid();
+    if (getChecksum(data + sizeof(ChiraMeshHeaderV2), size - sizeof(ChiraMeshHeaderV2)) != header.checksum) {
+        LOG_CMDL.error(TRF("error.cmdl_loader.checksum_mismatch", identifier));
+        return false;
+    }
+
+    // The counts in the header decide how much gets allocated, so every section has to agree with them first.
+    // Sections can only be as big as the file, or as big as the file could decompress to.
+    bool hasPositions = false, hasIndices = false;
+    for (std::uint32_t i = 0; i < header.sectionCount; i++) {
+        const auto section = read<ChiraMeshSection>(data + sizeof(ChiraMeshHeaderV2), i);
+        if (section.dataOffset > size || section.storedSize > size - section.dataOffset)
+            return invalid();
+        if (section.compression == ChiraMeshCompression::LZ4) {
+            if (section.size / LZ4_MAX_EXPANSION > section.storedSize)
+                return invalid();
+        } else if (section.compression != ChiraMeshCompression::NONE || section.storedSize != section.size) {
+            return invalid();
+        }
+        if (!hasValidSize(section, header.vertexCount, header.indexCount))
+            return invalid();
+        hasPositions |= section.type == ChiraMeshSectionType::POSITIONS;
+        hasIndices |= section.type == ChiraMeshSectionType::INDICES;
+    }
+    if (!hasPositions || !hasIndices)
+        return invalid();
+
+    vertices.assign(header.vertexCount, Vertex{});
+    indices.assign(header.indexCount, 0);
+    std::vector<byte> decompressed;
+    for (std::uint32_t i = 0; i < header.sectionCount; i++) {
+        const auto section = read<ChiraMeshSection>(data + sizeof(ChiraMeshHeaderV2), i);
+        const byte* sectionData = data + section.dataOffset;
+        if (section.compression == ChiraMeshCompression::LZ4) {
+            decompressed.resize(section.size);
+            if (!LZ4::decompress(sectionData, section.storedSize, decompressed.data(), decompressed.size()))
+                return invalid();
+            sectionData = decompressed.data();
+        }
+        if (!decodeSection(section, sectionData, vertices, indices))
+            return invalid();
+    }
+    return true;
 }
@@ -1,13 +1,33 @@
 #pragma once
 
+#include <cstdint>
+#include <string_view>
 #include "IMeshLoader.h"
 
 namespace chira {
 
+/// How ChiraMeshLoader::createMesh writes meshes
+struct ChiraMeshOptions {
+    /// Store normals, colors and UVs in smaller formats when they fit without visible loss.
+    /// Off by default, half float UVs are still a few texels off on big textures
+    bool quantize = false;
+    /// Compress sections with LZ4 when it makes them smaller, compressed sections can't be read in place
+    bool compress = false;
+    /// Split the triangles into meshlets of at most 64 vertices and 124 triangles
+    bool meshlets = false;
+    /// Reorder the triangles and vertices for the GPU's vertex cache and to reduce overdraw, see MeshOptimizer
+    bool optimize = false;
+};
+
 class ChiraMeshLoader : public IMeshLoader {
 public:
     void loadMesh(const std::string& identifier, std::vector<Vertex>& vertices, std::vector<Index>& indices) const override;
+    /// Writes version 2 with the default options, which don't lose any precision
     [[nodiscard]] std::vector<byte> createMesh(const std::vector<Vertex>& vertices, const std::vector<Index>& indices) const override;
+
+    [[nodiscard]] static std::vector<byte> createMesh(const std::vector<Vertex>& vertices, const std::vector<Index>& indices, const ChiraMeshOptions& options);
+    /// Reads version 1 and 2 meshes. The identifier is only used for error messages.
+    static bool loadMeshData(std::string_view identifier, const byte* data, std::size_t size, std::vector<Vertex>& vertices, std::vector<Index>& indices);
 };
 
 struct ChiraMeshHeader {
@@ -17,4 +37,58 @@ struct ChiraMeshHeader {
 };
 constexpr unsigned short CHIRA_MESH_HEADER_SIZE = sizeof(ChiraMeshHeader);
 
+enum class ChiraMeshSectionType : std::uint32_t {
+    POSITIONS = 0,
+    NORMALS = 1,
+    COLORS = 2,
+    UVS = 3,
+    INDICES = 4,
+    /// Meshlet count, then each meshlet's vertex offset, vertex count, triangle offset and triangle count,
+    /// then the meshlets' vertex indices, then three byte-sized indices into the meshlet's vertices per triangle
+    MESHLETS = 5,
+    /// Index buffer of a lower detail version of the mesh, with the same encodings as INDICES
+    LOD_INDICES = 6,
+};
+
+enum class ChiraMeshEncoding : std::uint32_t {
+    FLOAT32 = 0,
+    /// Normals packed with an octahedral mapping into two 16-bit signed normalized integers
+    OCTAHEDRAL_SNORM16 = 1,
+    /// RGBA, 8 bits per channel
+    UNORM8 = 2,
+    FLOAT16 = 3,
+    UINT16 = 4,
+    UINT32 = 5,
+};
+
+enum class ChiraMeshCompression : std::uint32_t {
+    NONE = 0,
+    LZ4 = 1,
+};
+
+/// Version 2 layout: the header, then the section table, then each section's data aligned to 16 bytes.
+/// Uncompressed sections can be read in place from a memory mapped file.
+/// The version is the first field, like version 1, so the loader can tell them apart.
+struct ChiraMeshHeaderV2 {
+    std::uint32_t version = 2;
+    std::uint32_t vertexCount = 0;
+    std::uint32_t indexCount = 0;
+    std::uint32_t sectionCount = 0;
+    /// FNV-1a of everything after the header
+    std::uint64_t checksum = 0;
+    std::uint64_t reserved = 0;
+};
+
+struct ChiraMeshSection {
+    ChiraMeshSectionType type = ChiraMeshSectionType::POSITIONS;
+    ChiraMeshEncoding encoding = ChiraMeshEncoding::FLOAT32;
+    std::uint64_t dataOffset = 0;
+    std::uint64_t storedSize = 0;
+    std::uint64_t size = 0;
+    ChiraMeshCompression compression = ChiraMeshCompression::NONE;
+    std::uint32_t reserved = 0;
+};
+
+constexpr std::size_t CHIRA_MESH_SECTION_ALIGNMENT = 16;
+
 } // namespace chira
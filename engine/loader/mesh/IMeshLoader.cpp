@@ -7,5 +7,7 @@ void IMeshLoader::addMeshLoader(const std::string& name, IMeshLoader* meshLoader
 }
 
 IMeshLoader* IMeshLoader::getMeshLoader(const std::string& name) {
-    return IMeshLoader::meshLoaders[name].get();
+    if (auto loader = IMeshLoader::meshLoaders.find(name); loader != IMeshLoader::meshLoaders.end())
+        return loader->second.get();
+    return nullptr;
 }
@@ -15,6 +15,7 @@ public:
     virtual void loadMesh(const std::string& identifier, std::vector<Vertex>& vertices, std::vector<Index>& indices) const = 0;
     [[nodiscard]] virtual std::vector<byte> createMesh(const std::vector<Vertex>& vertices, const std::vector<Index>& indices) const = 0;
     static void addMeshLoader(const std::string& name, IMeshLoader* meshLoader);
+    /// Mesh loaders are added on startup, after that this is safe to call from resource loader threads.
     static IMeshLoader* getMeshLoader(const std::string& name);
 private:
     static inline std::unordered_map<std::string, std::unique_ptr<IMeshLoader>> meshLoaders;
@@ -1,95 +1,271 @@
 #include "OBJMeshLoader.h"
 
 #include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <core/JobSystem.h>
 #include <core/Logger.h>
-#include <resource/StringResource.h>
+#include <resource/BinaryResource.h>
 #include <i18n/TranslationManager.h>
+#include <math/VertexWelder.h>
 #include <sstream>
 
 using namespace chira;
 
 CHIRA_CREATE_LOG(OBJ);
 
-void OBJMeshLoader::loadMesh(const std::string& identifier, std::vector<Vertex>& vertices, std::vector<Index>& indices) const {
-    std::vector<glm::vec3> vertexBuffer;
-    std::vector<ColorRG> uvBuffer;
-    std::vector<ColorRGB> normalBuffer;
-
-    auto meshData = Resource::getResource<StringResource>(identifier);
-    std::istringstream meshDataStream{meshData->getString()};
-
-    std::string line;
-    Index currentIndex = 0;
-    while (std::getline(meshDataStream, line)) {
-        if (line.substr(0,2) == "v ") {
-            glm::vec3 pos;
-            std::istringstream iss(line.substr(2));
-            iss >> pos.x >> pos.y >> pos.z;
-            vertexBuffer.push_back(pos);
-        } else if (line.substr(0,3) == "vt ") {
-            ColorRG uv;
-            std::istringstream iss(line.substr(2));
-            iss >> uv.r >> uv.g;
-            uvBuffer.push_back(uv);
-        } else if (line.substr(0,3) == "vn ") {
-            ColorRGB normal;
-            std::istringstream iss(line.substr(2));
-            iss >> normal.r >> normal.g >> normal.b;
-            normalBuffer.push_back(normal);
-        } else if (line.substr(0,2) == "f ") {
-            // this line has 10 zeroes to check if OBJ is triangulated concisely
-            int objIndices[10];
-            std::string data = line.substr(2);
-            std::replace(data.begin(), data.end(), '/', ' ');
-            std::istringstream iss(data);
-            unsigned short counter = 0;
-            bool includeUVs = false;
-            while (iss >> objIndices[counter]) {
-                objIndices[counter] -= 1;
-                if (counter >= 9) {
-                    LOG_OBJ.warning(TRF("warn.obj_loader.not_triangulated", identifier));
-                    break;
-                } else if (counter >= 6) {
-                    includeUVs = true;
-                }
-                counter++;
+namespace {
+
+/// How many of each element come before a chunk, negative indices are relative to these
+struct ElementCounts {
+    std::size_t positions = 0;
+    std::size_t uvs = 0;
+    std::size_t normals = 0;
+};
+
+/// Files smaller than this aren't worth splitting up
+constexpr std::size_t PARALLEL_PARSE_MIN_SIZE = 4 * 1024 * 1024;
+
+/// Meshes are loaded from resource loader threads, which aren't workers of the engine's job system.
+/// Their jobs would go in the queue the main thread runs while it waits on the frame update, so imports get their own workers
+[[nodiscard]] JobSystem& getImportJobSystem() {
+    static JobSystem jobSystem;
+    return jobSystem;
+}
+
+[[nodiscard]] inline bool isSpace(char c) {
+    return c == ' ' || c == '\t';
+}
+
+[[nodiscard]] inline bool isLineEnd(char c) {
+    return c == '\n' || c == '\r' || c == '#';
+}
+
+[[nodiscard]] inline const char* skipSpaces(const char* it, const char* end) {
+    while (it < end && isSpace(*it))
+        it++;
+    return it;
+}
+
+[[nodiscard]] inline const char* skipLine(const char* it, const char* end) {
+    const auto* newline = static_cast<const char*>(std::memchr(it, '\n', end - it));
+    return newline ? newline + 1 : end;
+}
+
+/// Leaves the value at zero if there's no number to parse
+[[nodiscard]] inline const char* parseFloat(const char* it, const char* end, float& value) {
+    it = skipSpaces(it, end);
+    if (it < end && *it == '+')
+        it++;
+    value = 0.f;
+    const auto result = std::from_chars(it, end, value);
+    return result.ec == std::errc{} ? result.ptr : it;
+}
+
+/// Turns a one-based or negative OBJ index into a zero-based one, or -1 if there is no index
+[[nodiscard]] inline const char* parseIndex(const char* it, const char* end, std::size_t definedSoFar, int& index) {
+    int value = 0;
+    const auto result = std::from_chars(it, end, value);
+    if (result.ec != std::errc{} || value == 0) {
+        index = -1;
+        return result.ec == std::errc{} ? result.ptr : it;
+    }
+    index = value > 0 ? value - 1 : static_cast<int>(definedSoFar) + value;
+    // Negative indices reaching past the start of the file are just as broken as a missing index
+    if (index < 0)
+        index = -1;
+    return result.ptr;
+}
+
+void parseFace(const char* it, const char* end, const ElementCounts& base, OBJMeshLoader::OBJData& out) {
+    OBJMeshLoader::OBJData::Corner first, previous;
+    int count = 0;
+    while (true) {
+        it = skipSpaces(it, end);
+        if (it >= end || isLineEnd(*it))
+            break;
+
+        OBJMeshLoader::OBJData::Corner corner;
+        const auto* next = parseIndex(it, end, base.positions + out.positions.size(), corner.position);
+        if (next == it)
+            break;
+        it = next;
+        if (it < end && *it == '/') {
+            it++;
+            // v//vn has no UV
+            if (it < end && *it != '/')
+                it = parseIndex(it, end, base.uvs + out.uvs.size(), corner.uv);
+            if (it < end && *it == '/') {
+                it++;
+                it = parseIndex(it, end, base.normals + out.normals.size(), corner.normal);
             }
-            if (includeUVs) {
-                addVertex({{vertexBuffer[objIndices[0]].x, vertexBuffer[objIndices[0]].y, vertexBuffer[objIndices[0]].z},
-                           {normalBuffer[objIndices[2]].r, normalBuffer[objIndices[2]].g, normalBuffer[objIndices[2]].b},
-                           {uvBuffer[objIndices[1]].r, uvBuffer[objIndices[1]].g}},
-                          &currentIndex, vertices, indices);
-                addVertex({{vertexBuffer[objIndices[3]].x, vertexBuffer[objIndices[3]].y, vertexBuffer[objIndices[3]].z},
-                           {normalBuffer[objIndices[5]].r, normalBuffer[objIndices[5]].g, normalBuffer[objIndices[5]].b},
-                           {uvBuffer[objIndices[4]].r, uvBuffer[objIndices[4]].g}},
-                          &currentIndex, vertices, indices);
-                addVertex({{vertexBuffer[objIndices[6]].x, vertexBuffer[objIndices[6]].y, vertexBuffer[objIndices[6]].z},
-                           {normalBuffer[objIndices[8]].r, normalBuffer[objIndices[8]].g, normalBuffer[objIndices[8]].b},
-                           {uvBuffer[objIndices[7]].r, uvBuffer[objIndices[7]].g}},
-                          &currentIndex, vertices, indices);
-            } else {
-                addVertex({{vertexBuffer[objIndices[0]].x, vertexBuffer[objIndices[0]].y, vertexBuffer[objIndices[0]].z},
-                           {normalBuffer[objIndices[1]].r, normalBuffer[objIndices[1]].g, normalBuffer[objIndices[1]].b}},
-                          &currentIndex, vertices, indices);
-                addVertex({{vertexBuffer[objIndices[2]].x, vertexBuffer[objIndices[2]].y, vertexBuffer[objIndices[2]].z},
-                           {normalBuffer[objIndices[3]].r, normalBuffer[objIndices[3]].g, normalBuffer[objIndices[3]].b}},
-                          &currentIndex, vertices, indices);
-                addVertex({{vertexBuffer[objIndices[4]].x, vertexBuffer[objIndices[4]].y, vertexBuffer[objIndices[4]].z},
-                           {normalBuffer[objIndices[5]].r, normalBuffer[objIndices[5]].g, normalBuffer[objIndices[5]].b}},
-                          &currentIndex, vertices, indices);
+        }
+
+        if (count == 0) {
+            first = corner;
+        } else if (count >= 2) {
+            out.corners.push_back(first);
+            out.corners.push_back(previous);
+            out.corners.push_back(corner);
+        }
+        previous = corner;
+        count++;
+    }
+}
+
+void parseChunk(std::string_view data, const ElementCounts& base, OBJMeshLoader::OBJData& out) {
+    const char* it = data.data();
+    const char* end = data.data() + data.size();
+    while (it < end) {
+        it = skipSpaces(it, end);
+        if (end - it >= 3 && it[0] == 'v') {
+            if (isSpace(it[1])) {
+                auto& position = out.positions.emplace_back();
+                it = parseFloat(it + 2, end, position.x);
+                it = parseFloat(it, end, position.y);
+                it = parseFloat(it, end, position.z);
+            } else if (it[1] == 't' && isSpace(it[2])) {
+                auto& uv = out.uvs.emplace_back();
+                it = parseFloat(it + 3, end, uv.r);
+                it = parseFloat(it, end, uv.g);
+            } else if (it[1] == 'n' && isSpace(it[2])) {
+                auto& normal = out.normals.emplace_back();
+                it = parseFloat(it + 3, end, normal.r);
+                it = parseFloat(it, end, normal.g);
+                it = parseFloat(it, end, normal.b);
             }
+        } else if (end - it >= 2 && it[0] == 'f' && isSpace(it[1])) {
+            const auto* lineEnd = skipLine(it, end);
+            parseFace(it + 2, lineEnd, base, out);
+            it = lineEnd;
+            continue;
         }
+        // Comments, groups, materials, and anything after the values we read
+        it = skipLine(it, end);
     }
 }
 
-void OBJMeshLoader::addVertex(Vertex v, Index* currentIndex, std::vector<Vertex>& vertices, std::vector<Index>& indices) {
-    auto position = std::find(vertices.begin(), vertices.end(), v);
-    if (position != vertices.end()) {
-        indices.push_back(static_cast<Index>(position - vertices.begin()));
-    } else {
-        vertices.push_back(v);
-        indices.push_back(*currentIndex);
-        *currentIndex += 1;
+[[nodiscard]] ElementCounts countElements(std::string_view data) {
+    ElementCounts counts;
+    const char* it = data.data();
+    const char* end = data.data() + data.size();
+    while (it < end) {
+        it = skipSpaces(it, end);
+        if (end - it >= 3 && it[0] == 'v') {
+            if (isSpace(it[1]))
+                counts.positions++;
+            else if (it[1] == 't' && isSpace(it[2]))
+                counts.uvs++;
+            else if (it[1] == 'n' && isSpace(it[2]))
+                counts.normals++;
+        }
+        it = skipLine(it, end);
+    }
+    return counts;
+}
+
+template<typename T>
+void append(std::vector<T>& to, const std::vector<T>& from) {
+    to.insert(to.end(), from.begin(), from.end());
+}
+
+} // namespace
+
+void OBJMeshLoader::loadMesh(const std::string& identifier, std::vector<Vertex>& vertices, std::vector<Index>& indices) const {
+    auto meshData = Resource::getResource<BinaryResource>(identifier);
+    OBJData data;
+    OBJMeshLoader::parse({reinterpret_cast<const char*>(meshData->getBuffer()), meshData->getBufferLength()}, data, &getImportJobSystem());
+
+    const auto isValid = [](int index, std::size_t size) {
+        return index >= 0 && static_cast<std::size_t>(index) < size;
+    };
+    bool skippedFaces = false;
+    // The mesh might be added to vertices that are already there, which it should share
+    VertexWelder welder;
+    welder.rebuild(vertices);
+    welder.reserve(vertices.size() + data.corners.size());
+    for (std::size_t i = 0; i + 2 < data.corners.size(); i += 3) {
+        const auto* triangle = &data.corners[i];
+        if (!isValid(triangle[0].position, data.positions.size()) ||
+            !isValid(triangle[1].position, data.positions.size()) ||
+            !isValid(triangle[2].position, data.positions.size())) {
+            skippedFaces = true;
+            continue;
+        }
+
+        // Corners without normals get the normal of the face
+        const auto& p0 = data.positions[triangle[0].position];
+        const auto& p1 = data.positions[triangle[1].position];
+        const auto& p2 = data.positions[triangle[2].position];
+        auto faceNormal = glm::cross(p1 - p0, p2 - p0);
+        if (const auto length = glm::length(faceNormal); length > 0.f)
+            faceNormal /= length;
+
+        for (int corner = 0; corner < 3; corner++) {
+            const auto& c = triangle[corner];
+            const auto normal = isValid(c.normal, data.normals.size()) ? data.normals[c.normal] : ColorRGB{faceNormal.x, faceNormal.y, faceNormal.z};
+            const auto uv = isValid(c.uv, data.uvs.size()) ? data.uvs[c.uv] : ColorRG{};
+            indices.push_back(welder.weld({data.positions[c.position], normal, uv}, vertices));
+        }
+    }
+    if (skippedFaces) {
+        LOG_OBJ.warning(TRF("warn.obj_loader.invalid_index", identifier));
+    }
+}
+
+void OBJMeshLoader::parse(std::string_view data, OBJData& out, JobSystem* jobSystem) {
+    if (!jobSystem || jobSystem->getThreadCount() < 2 || data.size() < PARALLEL_PARSE_MIN_SIZE) {
+        parseChunk(data, {}, out);
+        return;
+    }
+
+    // Split on line boundaries
+    const auto chunkCount = jobSystem->getThreadCount();
+    std::vector<std::string_view> chunks;
+    std::size_t chunkStart = 0;
+    for (std::size_t i = 1; i <= chunkCount && chunkStart < data.size(); i++) {
+        auto chunkEnd = i == chunkCount ? data.size() : std::max(chunkStart, data.size() * i / chunkCount);
+        if (const auto newline = data.find('\n', chunkEnd); chunkEnd < data.size())
+            chunkEnd = newline == std::string_view::npos ? data.size() : newline + 1;
+        chunks.push_back(data.substr(chunkStart, chunkEnd - chunkStart));
+        chunkStart = chunkEnd;
+    }
+
+    // Negative indices need to know how many elements came before each chunk
+    std::vector<ElementCounts> bases(chunks.size());
+    JobSystem::JobGroup counting;
+    for (std::size_t i = 0; i < chunks.size(); i++) {
+        jobSystem->run(counting, [&bases, &chunks, i] {
+            bases[i] = countElements(chunks[i]);
+        });
+    }
+    jobSystem->wait(counting);
+    ElementCounts total;
+    for (auto& base : bases) {
+        const auto counts = base;
+        base = total;
+        total.positions += counts.positions;
+        total.uvs += counts.uvs;
+        total.normals += counts.normals;
+    }
+
+    std::vector<OBJData> parsed(chunks.size());
+    JobSystem::JobGroup parsing;
+    for (std::size_t i = 0; i < chunks.size(); i++) {
+        jobSystem->run(parsing, [&parsed, &bases, &chunks, i] {
+            parseChunk(chunks[i], bases[i], parsed[i]);
+        });
+    }
+    jobSystem->wait(parsing);
+
+    out.positions.reserve(out.positions.size() + total.positions);
+    out.uvs.reserve(out.uvs.size() + total.uvs);
+    out.normals.reserve(out.normals.size() + total.normals);
+    for (const auto& chunk : parsed) {
+        append(out.positions, chunk.positions);
+        append(out.uvs, chunk.uvs);
+        append(out.normals, chunk.normals);
+        append(out.corners, chunk.corners);
     }
 }
 
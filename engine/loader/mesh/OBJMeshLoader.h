@@ -1,15 +1,35 @@
 #pragma once
 
+#include <string_view>
 #include "IMeshLoader.h"
 
 namespace chira {
 
+class JobSystem;
+
 class OBJMeshLoader : public IMeshLoader {
 public:
+    /// Everything in an OBJ file that matters to us
+    struct OBJData {
+        /// Zero-based indices into the arrays below, negative if the corner doesn't have one
+        struct Corner {
+            int position = -1;
+            int uv = -1;
+            int normal = -1;
+        };
+        std::vector<glm::vec3> positions;
+        std::vector<ColorRG> uvs;
+        std::vector<ColorRGB> normals;
+        /// Three per triangle, polygons are split into triangle fans
+        std::vector<Corner> corners;
+    };
+
     void loadMesh(const std::string& identifier, std::vector<Vertex>& vertices, std::vector<Index>& indices) const override;
     [[nodiscard]] std::vector<byte> createMesh(const std::vector<Vertex>& vertices, const std::vector<Index>& indices) const override;
-private:
-    static void addVertex(Vertex v, Index* currentIndex, std::vector<Vertex>& vertices, std::vector<Index>& indices);
+
+    /// Parses the file in one pass straight out of the given memory. If a job system is given,
+    /// big files are split into chunks that are parsed in parallel.
+    static void parse(std::string_view data, OBJData& out, JobSystem* jobSystem = nullptr);
 };
 
 } // namespace chira
@@ -0,0 +1,389 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace chira;
+
+/// Refitting stops being worth it once the nodes cover this much more area than a fresh build would
+static constexpr float MAX_REFIT_AREA_GROWTH = 2.f;
+/// If more than one in this many objects moved, refitting the whole tree is cheaper than walking up from each of them
+static constexpr std::size_t FULL_REFIT_RATIO = 4;
+
+[[nodiscard]] static float getSurfaceArea(const AABB& box) {
+    if (box.isEmpty())
+        return 0.f;
+    const auto size = box.max - box.min;
+    return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+[[nodiscard]] static bool intersectsSphere(const AABB& box, glm::vec3 center, float radius) {
+    if (box.isEmpty())
+        return false;
+    const auto offset = glm::clamp(center, box.min, box.max) - center;
+    return glm::dot(offset, offset) <= radius * radius;
+}
+
+/// Slab test, returns the distance along the ray to where it enters the box or a negative number if it misses
+[[nodiscard]] static float intersectsRay(const AABB& box, glm::vec3 origin, glm::vec3 direction, glm::vec3 inverseDirection) {
+    if (box.isEmpty())
+        return -1.f;
+    float enter = 0.f;
+    float exit = std::numeric_limits<float>::max();
+    for (int axis = 0; axis < 3; axis++) {
+        // Parallel to the slab, 0 * infinity would be NaN
+        if (direction[axis] == 0.f) {
+            if (origin[axis] < box.min[axis] || origin[axis] > box.max[axis])
+                return -1.f;
+            continue;
+        }
+        const float t1 = (box.min[axis] - origin[axis]) * inverseDirection[axis];
+        const float t2 = (box.max[axis] - origin[axis]) * inverseDirection[axis];
+        enter = std::max(enter, std::min(t1, t2));
+        exit = std::min(exit, std::max(t1, t2));
+    }
+    return exit >= enter ? enter : -1.f;
+}
+
+BVH::ObjectID BVH::insert(const AABB& bounds) {
+    ObjectID id;
+    if (!this->freeIDs.empty()) {
+        id = this->freeIDs.back();
+        this->freeIDs.pop_back();
+    } else {
+        id = static_cast<ObjectID>(this->objects.size());
+        this->objects.emplace_back();
+    }
+    this->objects[id] = {bounds, NULL_NODE, true};
+    this->insertedIDs.push_back(id);
+    return id;
+}
+
+void BVH::update(ObjectID id, const AABB& bounds) {
+    this->objects[id].bounds = bounds;
+    this->updatedIDs.push_back(id);
+}
+
+void BVH::remove(ObjectID id) {
+    // The tree can still reference the ID until it's committed, the empty box keeps queries from returning it
+    this->objects[id].bounds = {};
+    this->objects[id].alive = false;
+    this->removedIDs.push_back(id);
+}
+
+const AABB& BVH::getBounds(ObjectID id) const {
+    return this->objects[id].bounds;
+}
+
+void BVH::commit() {
+    // Changing most of the tree at once is cheaper and gives a better tree when done from scratch
+    if (this->insertedIDs.size() + this->removedIDs.size() > this->getNodeCount() / 2) {
+        this->build();
+        return;
+    }
+
+    // Moved objects first, so new ones are placed against up to date bounds
+    if (this->updatedIDs.size() * FULL_REFIT_RATIO > this->getObjectCount()) {
+        this->refit();
+    } else {
+        for (const auto id : this->updatedIDs) {
+            if (this->objects[id].alive && this->objects[id].leaf != NULL_NODE)
+                this->refitAncestors(this->objects[id].leaf);
+        }
+        this->updatedIDs.clear();
+    }
+
+    // Adding and removing objects changes how much area a fresh build would have, moving them doesn't
+    const float areaBeforeStructureChanges = this->totalArea;
+    for (const auto id : this->removedIDs) {
+        if (this->objects[id].leaf != NULL_NODE) {
+            this->removeLeaf(this->objects[id].leaf);
+            this->objects[id].leaf = NULL_NODE;
+        }
+    }
+    for (const auto id : this->insertedIDs) {
+        if (this->objects[id].alive && this->objects[id].leaf == NULL_NODE)
+            this->insertLeaf(id);
+    }
+    this->insertedIDs.clear();
+    this->freeIDs.insert(this->freeIDs.end(), this->removedIDs.begin(), this->removedIDs.end());
+    this->removedIDs.clear();
+    this->referenceArea += this->totalArea - areaBeforeStructureChanges;
+
+    if (this->totalArea > this->referenceArea * MAX_REFIT_AREA_GROWTH)
+        this->build();
+}
+
+void BVH::build() {
+    this->nodes.clear();
+    this->freeNodes.clear();
+    this->root = NULL_NODE;
+    this->totalArea = 0.f;
+    std::vector<ObjectID> ids;
+    for (ObjectID id = 0; id < this->objects.size(); id++) {
+        this->objects[id].leaf = NULL_NODE;
+        if (this->objects[id].alive)
+            ids.push_back(id);
+    }
+    if (!ids.empty()) {
+        // A binary tree with one object per leaf has exactly this many nodes
+        this->nodes.reserve(2 * ids.size() - 1);
+        this->root = this->buildNode(ids, 0, ids.size(), NULL_NODE);
+    }
+    this->freeIDs.insert(this->freeIDs.end(), this->removedIDs.begin(), this->removedIDs.end());
+    this->removedIDs.clear();
+    this->insertedIDs.clear();
+    this->updatedIDs.clear();
+    this->referenceArea = this->totalArea;
+}
+
+std::uint32_t BVH::buildNode(std::vector<ObjectID>& ids, std::size_t begin, std::size_t end, std::uint32_t parent) { // NOLINT(misc-no-recursion)
+    const auto index = this->allocateNode();
+    this->nodes[index].parent = parent;
+
+    if (end - begin == 1) {
+        const auto id = ids[begin];
+        this->nodes[index].object = id;
+        this->objects[id].leaf = index;
+        this->setNodeBounds(index, this->objects[id].bounds);
+        return index;
+    }
+
+    // Split at the median along the axis the centers are most spread out on
+    AABB centers;
+    for (auto i = begin; i < end; i++) {
+        centers.expand(this->objects[ids[i]].bounds.getCenter());
+    }
+    const auto spread = centers.max - centers.min;
+    const int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+    const auto middle = begin + (end - begin) / 2;
+    std::nth_element(ids.begin() + static_cast<std::ptrdiff_t>(begin), ids.begin() + static_cast<std::ptrdiff_t>(middle), ids.begin() + static_cast<std::ptrdiff_t>(end), [this, axis](ObjectID lhs, ObjectID rhs) {
+        return this->objects[lhs].bounds.getCenter()[axis] < this->objects[rhs].bounds.getCenter()[axis];
+    });
+
+    const auto left = this->buildNode(ids, begin, middle, index);
+    const auto right = this->buildNode(ids, middle, end, index);
+    this->nodes[index].left = left;
+    this->nodes[index].right = right;
+    auto bounds = this->nodes[left].bounds;
+    bounds.expand(this->nodes[right].bounds);
+    this->setNodeBounds(index, bounds);
+    return index;
+}
+
+void BVH::refit() {
+    if (this->root != NULL_NODE) {
+        // Parents are listed before their children, so going backwards visits children first
+        std::vector<std::uint32_t> visited{this->root};
+        for (std::size_t i = 0; i < visited.size(); i++) {
+            if (const auto& node = this->nodes[visited[i]]; !node.isLeaf()) {
+                visited.push_back(node.left);
+                visited.push_back(node.right);
+            }
+        }
+        for (auto i = visited.size(); i-- > 0;) {
+            const auto& node = this->nodes[visited[i]];
+            AABB bounds;
+            if (node.isLeaf()) {
+                bounds = this->objects[node.object].bounds;
+            } else {
+                bounds = this->nodes[node.left].bounds;
+                bounds.expand(this->nodes[node.right].bounds);
+            }
+            this->setNodeBounds(visited[i], bounds);
+        }
+    }
+    this->updatedIDs.clear();
+}
+
+std::uint32_t BVH::allocateNode() {
+    if (!this->freeNodes.empty()) {
+        const auto index = this->freeNodes.back();
+        this->freeNodes.pop_back();
+        return index;
+    }
+    this->nodes.emplace_back();
+    return static_cast<std::uint32_t>(this->nodes.size() - 1);
+}
+
+void BVH::freeNode(std::uint32_t index) {
+    this->setNodeBounds(index, {});
+    this->nodes[index] = {};
+    this->freeNodes.push_back(index);
+}
+
+void BVH::setNodeBounds(std::uint32_t index, const AABB& bounds) {
+    this->totalArea += getSurfaceArea(bounds) - getSurfaceArea(this->nodes[index].bounds);
+    this->nodes[index].bounds = bounds;
+}
+
+std::uint32_t BVH::findBestSibling(const AABB& bounds) const {
+    // Branch and bound on the surface area heuristic: the cost of pairing with a node is the area of the new parent,
+    // plus how much every ancestor has to grow. A subtree can't do better than the new box plus what its ancestors add
+    const float boxArea = getSurfaceArea(bounds);
+    std::uint32_t best = this->root;
+    float bestCost = std::numeric_limits<float>::max();
+    std::vector<std::pair<std::uint32_t, float>> stack{{this->root, 0.f}};
+    while (!stack.empty()) {
+        const auto [index, inheritedCost] = stack.back();
+        stack.pop_back();
+        const auto& node = this->nodes[index];
+        auto combined = node.bounds;
+        combined.expand(bounds);
+        const float combinedArea = getSurfaceArea(combined);
+        if (combinedArea + inheritedCost < bestCost) {
+            best = index;
+            bestCost = combinedArea + inheritedCost;
+        }
+        const float childInheritedCost = inheritedCost + combinedArea - getSurfaceArea(node.bounds);
+        if (!node.isLeaf() && boxArea + childInheritedCost < bestCost) {
+            stack.emplace_back(node.left, childInheritedCost);
+            stack.emplace_back(node.right, childInheritedCost);
+        }
+    }
+    return best;
+}
+
+void BVH::insertLeaf(ObjectID id) {
+    const auto leaf = this->allocateNode();
+    this->nodes[leaf].object = id;
+    this->objects[id].leaf = leaf;
+    this->setNodeBounds(leaf, this->objects[id].bounds);
+    if (this->root == NULL_NODE) {
+        this->root = leaf;
+        return;
+    }
+
+    const auto sibling = this->findBestSibling(this->objects[id].bounds);
+    const auto oldParent = this->nodes[sibling].parent;
+    const auto newParent = this->allocateNode();
+    this->nodes[newParent].parent = oldParent;
+    this->nodes[newParent].left = sibling;
+    this->nodes[newParent].right = leaf;
+    this->nodes[sibling].parent = newParent;
+    this->nodes[leaf].parent = newParent;
+    if (oldParent == NULL_NODE) {
+        this->root = newParent;
+    } else if (this->nodes[oldParent].left == sibling) {
+        this->nodes[oldParent].left = newParent;
+    } else {
+        this->nodes[oldParent].right = newParent;
+    }
+    this->refitAncestors(newParent);
+}
+
+void BVH::removeLeaf(std::uint32_t leaf) {
+    const auto parent = this->nodes[leaf].parent;
+    this->freeNode(leaf);
+    if (parent == NULL_NODE) {
+        this->root = NULL_NODE;
+        return;
+    }
+
+    // The sibling takes the parent's place
+    const auto sibling = this->nodes[parent].left == leaf ? this->nodes[parent].right : this->nodes[parent].left;
+    const auto grandparent = this->nodes[parent].parent;
+    this->nodes[sibling].parent = grandparent;
+    if (grandparent == NULL_NODE) {
+        this->root = sibling;
+    } else if (this->nodes[grandparent].left == parent) {
+        this->nodes[grandparent].left = sibling;
+    } else {
+        this->nodes[grandparent].right = sibling;
+    }
+    this->freeNode(parent);
+    this->refitAncestors(grandparent);
+}
+
+void BVH::refitAncestors(std::uint32_t index) {
+    while (index != NULL_NODE) {
+        const auto& node = this->nodes[index];
+        AABB bounds;
+        if (node.isLeaf()) {
+            bounds = this->objects[node.object].bounds;
+        } else {
+            bounds = this->nodes[node.left].bounds;
+            bounds.expand(this->nodes[node.right].bounds);
+        }
+        // Nothing above it changes either
+        if (bounds == node.bounds)
+            return;
+        this->setNodeBounds(index, bounds);
+        index = node.parent;
+    }
+}
+
+void BVH::queryFrustum(const Frustum& frustum, std::vector<ObjectID>& out) const {
+    if (this->root == NULL_NODE)
+        return;
+    std::vector<std::uint32_t> stack{this->root};
+    while (!stack.empty()) {
+        const auto& node = this->nodes[stack.back()];
+        stack.pop_back();
+        if (!frustum.intersects(node.bounds))
+            continue;
+        if (node.isLeaf()) {
+            if (frustum.intersects(this->objects[node.object].bounds))
+                out.push_back(node.object);
+        } else {
+            stack.push_back(node.right);
+            stack.push_back(node.left);
+        }
+    }
+}
+
+void BVH::querySphere(glm::vec3 center, float radius, std::vector<ObjectID>& out) const {
+    if (this->root == NULL_NODE)
+        return;
+    std::vector<std::uint32_t> stack{this->root};
+    while (!stack.empty()) {
+        const auto& node = this->nodes[stack.back()];
+        stack.pop_back();
+        if (!intersectsSphere(node.bounds, center, radius))
+            continue;
+        if (node.isLeaf()) {
+            if (intersectsSphere(this->objects[node.object].bounds, center, radius))
+                out.push_back(node.object);
+        } else {
+            stack.push_back(node.right);
+            stack.push_back(node.left);
+        }
+    }
+}
+
+BVH::ObjectID BVH::raycast(glm::vec3 origin, glm::vec3 direction, float* distance) const {
+    ObjectID closest = INVALID_ID;
+    float closestDistance = std::numeric_limits<float>::max();
+    if (this->root != NULL_NODE) {
+        // Zero components become infinity here, intersectsRay() doesn't use them
+        const auto inverseDirection = 1.f / direction;
+        std::vector<std::uint32_t> stack{this->root};
+        while (!stack.empty()) {
+            const auto& node = this->nodes[stack.back()];
+            stack.pop_back();
+            if (const float hit = intersectsRay(node.bounds, origin, direction, inverseDirection); hit < 0.f || hit >= closestDistance)
+                continue;
+            if (node.isLeaf()) {
+                const float hit = intersectsRay(this->objects[node.object].bounds, origin, direction, inverseDirection);
+                if (hit >= 0.f && hit < closestDistance) {
+                    closest = node.object;
+                    closestDistance = hit;
+                }
+            } else {
+                stack.push_back(node.right);
+                stack.push_back(node.left);
+            }
+        }
+    }
+    if (distance)
+        *distance = closestDistance;
+    return closest;
+}
+
+std::size_t BVH::getObjectCount() const {
+    return this->objects.size() - this->freeIDs.size() - this->removedIDs.size();
+}
+
+std::size_t BVH::getNodeCount() const {
+    return this->nodes.size() - this->freeNodes.size();
+}
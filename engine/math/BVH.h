@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Bounds.h"
+
+namespace chira {
+
+/// Bounding volume hierarchy over boxes identified by the IDs insert() hands out.
+/// Changes are only applied to the tree when commit() is called, queries in between see the last committed state.
+/// New objects are inserted next to whichever node grows the tree the least, and removed ones are unlinked in place,
+/// so the tree is only rebuilt from scratch once moving objects have made it too loose.
+class BVH {
+public:
+    using ObjectID = std::uint32_t;
+    static constexpr ObjectID INVALID_ID = std::numeric_limits<ObjectID>::max();
+
+    [[nodiscard]] ObjectID insert(const AABB& bounds);
+    void update(ObjectID id, const AABB& bounds);
+    void remove(ObjectID id);
+    /// The bounds last passed to insert() or update(), removed objects have empty bounds
+    [[nodiscard]] const AABB& getBounds(ObjectID id) const;
+    /// Adds and removes objects from the tree and refits it around the ones that moved, then rebuilds it if it got too loose
+    void commit();
+    /// Rebuilds the whole tree from scratch
+    void build();
+    /// Recalculates node bounds without changing the tree's structure
+    void refit();
+
+    void queryFrustum(const Frustum& frustum, std::vector<ObjectID>& out) const;
+    void querySphere(glm::vec3 center, float radius, std::vector<ObjectID>& out) const;
+    /// Returns the object with the closest box the ray hits, or INVALID_ID. The direction doesn't need to be normalized,
+    /// the distance is measured in multiples of it.
+    [[nodiscard]] ObjectID raycast(glm::vec3 origin, glm::vec3 direction, float* distance = nullptr) const;
+
+    [[nodiscard]] std::size_t getObjectCount() const;
+    [[nodiscard]] std::size_t getNodeCount() const;
+private:
+    static constexpr std::uint32_t NULL_NODE = std::numeric_limits<std::uint32_t>::max();
+
+    struct Node {
+        AABB bounds;
+        std::uint32_t parent = NULL_NODE;
+        /// Both are NULL_NODE for leaves
+        std::uint32_t left = NULL_NODE;
+        std::uint32_t right = NULL_NODE;
+        /// Only set for leaves, which hold exactly one object
+        ObjectID object = INVALID_ID;
+        [[nodiscard]] bool isLeaf() const {
+            return this->left == NULL_NODE;
+        }
+    };
+    struct Object {
+        AABB bounds;
+        /// NULL_NODE until commit() adds the object to the tree
+        std::uint32_t leaf = NULL_NODE;
+        bool alive = false;
+    };
+
+    [[nodiscard]] std::uint32_t allocateNode();
+    void freeNode(std::uint32_t index);
+    void setNodeBounds(std::uint32_t index, const AABB& bounds);
+    std::uint32_t buildNode(std::vector<ObjectID>& ids, std::size_t begin, std::size_t end, std::uint32_t parent);
+    [[nodiscard]] std::uint32_t findBestSibling(const AABB& bounds) const;
+    void insertLeaf(ObjectID id);
+    void removeLeaf(std::uint32_t leaf);
+    /// Recalculates the bounds of the node and its ancestors, stopping early once one doesn't change
+    void refitAncestors(std::uint32_t index);
+
+    std::vector<Node> nodes;
+    std::vector<std::uint32_t> freeNodes;
+    std::uint32_t root = NULL_NODE;
+    std::vector<Object> objects;
+    std::vector<ObjectID> freeIDs;
+    /// Waiting for commit()
+    std::vector<ObjectID> insertedIDs;
+    std::vector<ObjectID> updatedIDs;
+    /// Freed once the tree no longer references them
+    std::vector<ObjectID> removedIDs;
+    /// The surface area of every node added together, kept up to date as nodes change
+    float totalArea = 0.f;
+    /// What totalArea would be if nothing had moved since the last build
+    float referenceArea = 0.f;
+};
+
+} // namespace chira
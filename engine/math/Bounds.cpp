@@ -0,0 +1,52 @@
+#include "Bounds.h"
+
+using namespace chira;
+
+void AABB::expand(glm::vec3 point) {
+    this->min = glm::min(this->min, point);
+    this->max = glm::max(this->max, point);
+}
+
+void AABB::expand(const AABB& other) {
+    this->min = glm::min(this->min, other.min);
+    this->max = glm::max(this->max, other.max);
+}
+
+AABB AABB::transform(const glm::mat4& matrix) const {
+    if (this->isEmpty())
+        return {};
+    // Transform the center, then find the extents along each world axis from the absolute rotation/scale
+    const glm::vec3 center{matrix * glm::vec4{this->getCenter(), 1.f}};
+    const glm::mat3 absolute{glm::abs(glm::vec3{matrix[0]}), glm::abs(glm::vec3{matrix[1]}), glm::abs(glm::vec3{matrix[2]})};
+    const glm::vec3 extents = absolute * this->getExtents();
+    return {center - extents, center + extents};
+}
+
+Frustum::Frustum(const glm::mat4& projectionView) {
+    // Gribb/Hartmann plane extraction, glm matrices are column major so rows are read across columns
+    const auto row = [&projectionView](int i) {
+        return glm::vec4{projectionView[0][i], projectionView[1][i], projectionView[2][i], projectionView[3][i]};
+    };
+    this->planes = {
+            row(3) + row(0), // left
+            row(3) - row(0), // right
+            row(3) + row(1), // bottom
+            row(3) - row(1), // top
+            row(3) + row(2), // near
+            row(3) - row(2), // far
+    };
+}
+
+bool Frustum::intersects(const AABB& box) const {
+    if (box.isEmpty())
+        return false;
+    const auto center = box.getCenter();
+    const auto extents = box.getExtents();
+    for (const auto& plane : this->planes) {
+        const glm::vec3 normal{plane};
+        // The box is outside if even its corner furthest along the normal is behind the plane
+        if (glm::dot(normal, center) + glm::dot(glm::abs(normal), extents) + plane.w < 0.f)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <limits>
+#include <glm/glm.hpp>
+
+namespace chira {
+
+/// Axis-aligned bounding box, default constructed boxes are empty and contain nothing.
+struct AABB {
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+    [[nodiscard]] inline bool isEmpty() const {
+        return this->min.x > this->max.x || this->min.y > this->max.y || this->min.z > this->max.z;
+    }
+    [[nodiscard]] inline glm::vec3 getCenter() const {
+        return (this->min + this->max) * 0.5f;
+    }
+    [[nodiscard]] inline glm::vec3 getExtents() const {
+        return (this->max - this->min) * 0.5f;
+    }
+    [[nodiscard]] inline bool operator==(const AABB& other) const {
+        return this->min == other.min && this->max == other.max;
+    }
+    void expand(glm::vec3 point);
+    void expand(const AABB& other);
+    /// Returns the box around this box after it has been transformed, empty boxes stay empty
+    [[nodiscard]] AABB transform(const glm::mat4& matrix) const;
+};
+
+/// The six planes of a projection-view matrix, normals point inwards.
+struct Frustum {
+    std::array<glm::vec4, 6> planes{};
+
+    Frustum() = default;
+    explicit Frustum(const glm::mat4& projectionView);
+    /// Conservative: boxes near a corner of the frustum may be reported as intersecting when they aren't
+    [[nodiscard]] bool intersects(const AABB& box) const;
+};
+
+} // namespace chira
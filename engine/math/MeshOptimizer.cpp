@@ -0,0 +1,275 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <glm/glm.hpp>
+
+using namespace chira;
+
+namespace {
+
+/// Size of the LRU cache the vertex cache optimization plans for, larger than real caches so it works well on any of them
+constexpr std::size_t SIMULATED_CACHE_SIZE = 32;
+constexpr Index NO_TRIANGLE = ~Index{0};
+
+/// Vertices that were just used score highest, and vertices with few triangles left score higher so they get finished off
+[[nodiscard]] float getVertexScore(int cachePosition, unsigned int remainingTriangles) {
+    if (remainingTriangles == 0)
+        return -1.f;
+    float score = 0.f;
+    if (cachePosition >= 0) {
+        // The last triangle's vertices get a fixed score so it doesn't matter which order they were used in
+        if (cachePosition < 3) {
+            score = 0.75f;
+        } else {
+            const auto scaler = 1.f - static_cast<float>(cachePosition - 3) / static_cast<float>(SIMULATED_CACHE_SIZE - 3);
+            score = std::pow(scaler, 1.5f);
+        }
+    }
+    return score + 2.f / std::sqrt(static_cast<float>(remainingTriangles));
+}
+
+/// Vertex shader invocations for the indices with a FIFO cache
+[[nodiscard]] std::size_t getCacheMisses(const std::vector<Index>& indices, std::size_t vertexCount, std::size_t cacheSize) {
+    // A vertex is still cached if fewer than cacheSize vertices were added since it was
+    std::vector<std::size_t> timestamps(vertexCount, 0);
+    std::size_t time = cacheSize + 1;
+    std::size_t misses = 0;
+    for (const auto index : indices) {
+        if (time - timestamps[index] > cacheSize) {
+            timestamps[index] = time++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+} // namespace
+
+float MeshOptimizer::getACMR(const std::vector<Index>& indices, std::size_t vertexCount, std::size_t cacheSize) {
+    if (indices.size() < 3)
+        return 0.f;
+    return static_cast<float>(getCacheMisses(indices, vertexCount, cacheSize)) / static_cast<float>(indices.size() / 3);
+}
+
+float MeshOptimizer::getATVR(const std::vector<Index>& indices, std::size_t vertexCount, std::size_t cacheSize) {
+    std::vector<bool> used(vertexCount, false);
+    std::size_t usedCount = 0;
+    for (const auto index : indices) {
+        if (!used[index]) {
+            used[index] = true;
+            usedCount++;
+        }
+    }
+    if (usedCount == 0)
+        return 0.f;
+    return static_cast<float>(getCacheMisses(indices, vertexCount, cacheSize)) / static_cast<float>(usedCount);
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<Index>& indices, std::size_t vertexCount) {
+    const auto triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Triangles using each vertex, the first remainingTriangles[vertex] of each list haven't been added yet
+    std::vector<unsigned int> remainingTriangles(vertexCount, 0);
+    for (std::size_t i = 0; i < triangleCount * 3; i++) {
+        remainingTriangles[indices[i]]++;
+    }
+    std::vector<std::size_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (std::size_t vertex = 0; vertex < vertexCount; vertex++) {
+        adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + remainingTriangles[vertex];
+    }
+    std::vector<Index> adjacency(adjacencyOffsets.back());
+    {
+        std::vector<std::size_t> fill{adjacencyOffsets.begin(), adjacencyOffsets.end() - 1};
+        for (std::size_t i = 0; i < triangleCount * 3; i++) {
+            adjacency[fill[indices[i]]++] = static_cast<Index>(i / 3);
+        }
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (std::size_t vertex = 0; vertex < vertexCount; vertex++) {
+        vertexScores[vertex] = getVertexScore(-1, remainingTriangles[vertex]);
+    }
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> added(triangleCount, false);
+    Index bestTriangle = 0;
+    for (std::size_t triangle = 0; triangle < triangleCount; triangle++) {
+        triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+        if (triangleScores[triangle] > triangleScores[bestTriangle])
+            bestTriangle = static_cast<Index>(triangle);
+    }
+
+    std::vector<Index> cache, nextCache;
+    cache.reserve(SIMULATED_CACHE_SIZE + 3);
+    nextCache.reserve(SIMULATED_CACHE_SIZE + 3);
+    std::vector<Index> out;
+    out.reserve(triangleCount * 3);
+    std::size_t nextUnadded = 0;
+
+    for (std::size_t i = 0; i < triangleCount; i++) {
+        if (bestTriangle == NO_TRIANGLE) {
+            // Nothing in the cache has triangles left, carry on from the first triangle that hasn't been added
+            while (added[nextUnadded])
+                nextUnadded++;
+            bestTriangle = static_cast<Index>(nextUnadded);
+        }
+        added[bestTriangle] = true;
+
+        nextCache.clear();
+        for (std::size_t corner = 0; corner < 3; corner++) {
+            const auto vertex = indices[bestTriangle * 3 + corner];
+            out.push_back(vertex);
+
+            auto* begin = adjacency.data() + adjacencyOffsets[vertex];
+            auto* end = begin + remainingTriangles[vertex];
+            std::iter_swap(std::find(begin, end, bestTriangle), end - 1);
+            remainingTriangles[vertex]--;
+
+            if (std::find(nextCache.begin(), nextCache.end(), vertex) == nextCache.end())
+                nextCache.push_back(vertex);
+        }
+        for (const auto vertex : cache) {
+            if (std::find(nextCache.begin(), nextCache.end(), vertex) == nextCache.end())
+                nextCache.push_back(vertex);
+        }
+
+        // Rescore everything that moved or fell out of the cache, and the triangles using it
+        for (std::size_t position = 0; position < nextCache.size(); position++) {
+            const auto vertex = nextCache[position];
+            cachePositions[vertex] = position < SIMULATED_CACHE_SIZE ? static_cast<int>(position) : -1;
+            const auto score = getVertexScore(cachePositions[vertex], remainingTriangles[vertex]);
+            const auto difference = score - vertexScores[vertex];
+            vertexScores[vertex] = score;
+            for (std::size_t j = 0; j < remainingTriangles[vertex]; j++) {
+                triangleScores[adjacency[adjacencyOffsets[vertex] + j]] += difference;
+            }
+        }
+        if (nextCache.size() > SIMULATED_CACHE_SIZE)
+            nextCache.resize(SIMULATED_CACHE_SIZE);
+        cache.swap(nextCache);
+
+        // The next triangle is the best one using a cached vertex, which is much cheaper than checking all of them
+        bestTriangle = NO_TRIANGLE;
+        float bestScore = 0.f;
+        for (const auto vertex : cache) {
+            for (std::size_t j = 0; j < remainingTriangles[vertex]; j++) {
+                const auto triangle = adjacency[adjacencyOffsets[vertex] + j];
+                if (triangleScores[triangle] > bestScore || (triangleScores[triangle] == bestScore && triangle < bestTriangle)) {
+                    bestScore = triangleScores[triangle];
+                    bestTriangle = triangle;
+                }
+            }
+        }
+    }
+
+    // Leftover indices that don't make a whole triangle stay where they were
+    std::copy(indices.begin() + static_cast<std::ptrdiff_t>(out.size()), indices.end(), std::back_inserter(out));
+    indices.swap(out);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<Index>& indices, const std::vector<Vertex>& vertices, float threshold) {
+    const auto triangleCount = indices.size() / 3;
+    if (triangleCount < 2)
+        return;
+
+    // Split into clusters with a fresh cache each, ending a cluster once it's about as cache friendly as the whole mesh
+    const auto meshACMR = MeshOptimizer::getACMR(indices, vertices.size());
+    std::vector<std::size_t> clusterStarts{0};
+    {
+        constexpr std::size_t cacheSize = 16;
+        std::vector<std::size_t> timestamps(vertices.size(), 0);
+        std::size_t time = cacheSize + 1;
+        std::size_t clusterMisses = 0;
+        for (std::size_t triangle = 0; triangle < triangleCount; triangle++) {
+            for (std::size_t corner = 0; corner < 3; corner++) {
+                const auto vertex = indices[triangle * 3 + corner];
+                if (time - timestamps[vertex] > cacheSize) {
+                    timestamps[vertex] = time++;
+                    clusterMisses++;
+                }
+            }
+            const auto clusterTriangles = triangle + 1 - clusterStarts.back();
+            if (triangle + 1 < triangleCount && static_cast<float>(clusterMisses) <= threshold * meshACMR * static_cast<float>(clusterTriangles)) {
+                clusterStarts.push_back(triangle + 1);
+                // Everything that was cached is forgotten
+                time += cacheSize + 1;
+                clusterMisses = 0;
+            }
+        }
+    }
+    const auto clusterCount = clusterStarts.size();
+    clusterStarts.push_back(triangleCount);
+    if (clusterCount < 2)
+        return;
+
+    glm::vec3 meshCenter{0.f};
+    float meshArea = 0.f;
+    std::vector<glm::vec3> clusterCenters(clusterCount, glm::vec3{0.f});
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3{0.f});
+    for (std::size_t cluster = 0; cluster < clusterCount; cluster++) {
+        float clusterArea = 0.f;
+        for (auto triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; triangle++) {
+            const auto& a = vertices[indices[triangle * 3]].position;
+            const auto& b = vertices[indices[triangle * 3 + 1]].position;
+            const auto& c = vertices[indices[triangle * 3 + 2]].position;
+            // The cross product's length is twice the triangle's area, which weighs everything by area
+            const auto normal = glm::cross(b - a, c - a);
+            const auto area = glm::length(normal);
+            clusterCenters[cluster] += (a + b + c) * (area / 3.f);
+            clusterNormals[cluster] += normal;
+            clusterArea += area;
+        }
+        meshCenter += clusterCenters[cluster];
+        meshArea += clusterArea;
+        if (clusterArea > 0.f)
+            clusterCenters[cluster] /= clusterArea;
+        if (const auto length = glm::length(clusterNormals[cluster]); length > 0.f)
+            clusterNormals[cluster] /= length;
+    }
+    if (meshArea > 0.f)
+        meshCenter /= meshArea;
+
+    // Clusters further out along the direction they face are more likely to be in front of the rest of the mesh
+    std::vector<float> sortKeys(clusterCount);
+    for (std::size_t cluster = 0; cluster < clusterCount; cluster++) {
+        sortKeys[cluster] = glm::dot(clusterCenters[cluster] - meshCenter, clusterNormals[cluster]);
+    }
+    std::vector<std::size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](std::size_t lhs, std::size_t rhs) {
+        return sortKeys[lhs] > sortKeys[rhs];
+    });
+
+    std::vector<Index> out;
+    out.reserve(indices.size());
+    for (const auto cluster : order) {
+        out.insert(out.end(), indices.begin() + static_cast<std::ptrdiff_t>(clusterStarts[cluster] * 3), indices.begin() + static_cast<std::ptrdiff_t>(clusterStarts[cluster + 1] * 3));
+    }
+    std::copy(indices.begin() + static_cast<std::ptrdiff_t>(out.size()), indices.end(), std::back_inserter(out));
+    indices.swap(out);
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<Index>& indices) {
+    constexpr Index unused = ~Index{0};
+    std::vector<Index> remap(vertices.size(), unused);
+    std::vector<Vertex> out;
+    out.reserve(vertices.size());
+    for (auto& index : indices) {
+        if (remap[index] == unused) {
+            remap[index] = static_cast<Index>(out.size());
+            out.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(out);
+}
+
+void MeshOptimizer::optimize(std::vector<Vertex>& vertices, std::vector<Index>& indices) {
+    MeshOptimizer::optimizeVertexCache(indices, vertices.size());
+    MeshOptimizer::optimizeOverdraw(indices, vertices);
+    MeshOptimizer::optimizeVertexFetch(vertices, indices);
+}
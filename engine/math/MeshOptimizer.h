@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "Vertex.h"
+
+/// Reorders triangle lists so the GPU does less work drawing them, without changing what gets drawn.
+/// Everything here is deterministic, the same input always gives the same output.
+namespace chira::MeshOptimizer {
+
+/// Average cache miss ratio: how many vertices get transformed per triangle with a FIFO cache of the given size.
+/// Anywhere from 3 for an unordered mesh down to about 0.5 for a large regular grid.
+[[nodiscard]] float getACMR(const std::vector<Index>& indices, std::size_t vertexCount, std::size_t cacheSize = 16);
+/// Average transformed vertex ratio: how many times each referenced vertex gets transformed, 1 is perfect.
+[[nodiscard]] float getATVR(const std::vector<Index>& indices, std::size_t vertexCount, std::size_t cacheSize = 16);
+
+/// Reorders triangles so vertices that were just transformed are reused, using Tom Forsyth's linear-speed algorithm
+void optimizeVertexCache(std::vector<Index>& indices, std::size_t vertexCount);
+/// Splits the triangles into clusters and draws the clusters facing away from the mesh's center first, so they're
+/// more likely to hide what's behind them. Clusters end once their ACMR is within threshold times the ACMR of the
+/// whole mesh, so the vertex cache order barely suffers. Run this after optimizeVertexCache.
+void optimizeOverdraw(std::vector<Index>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+/// Reorders vertices in the order the triangles first use them and removes unused vertices
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<Index>& indices);
+
+/// Runs all three passes in the right order
+void optimize(std::vector<Vertex>& vertices, std::vector<Index>& indices);
+
+} // namespace chira::MeshOptimizer
@@ -0,0 +1,138 @@
+#include "VertexWelder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace chira;
+
+namespace {
+
+constexpr std::size_t FIELD_COUNT = 11;
+
+void getFields(const Vertex& vertex, float fields[FIELD_COUNT]) {
+    fields[0] = vertex.position.x;
+    fields[1] = vertex.position.y;
+    fields[2] = vertex.position.z;
+    fields[3] = vertex.normal.r;
+    fields[4] = vertex.normal.g;
+    fields[5] = vertex.normal.b;
+    fields[6] = vertex.color.r;
+    fields[7] = vertex.color.g;
+    fields[8] = vertex.color.b;
+    fields[9] = vertex.uv.r;
+    fields[10] = vertex.uv.g;
+}
+
+/// What a field looks like after welding, equal fields always give the same key
+[[nodiscard]] std::uint64_t getFieldKey(float field, float epsilon) {
+    if (epsilon > 0.f)
+        return static_cast<std::uint64_t>(std::llround(field / epsilon));
+    // 0 and -0 compare equal so they need the same key
+    if (field == 0.f)
+        field = 0.f;
+    std::uint32_t bits;
+    std::memcpy(&bits, &field, sizeof(bits));
+    return bits;
+}
+
+} // namespace
+
+VertexWelder::VertexWelder(float epsilon_) : epsilon(epsilon_) {}
+
+Index VertexWelder::weld(const Vertex& vertex, std::vector<Vertex>& vertices) {
+    if (this->slots.empty())
+        this->grow(64);
+    const auto hash = this->getHash(vertex);
+    const auto mask = this->slots.size() - 1;
+    for (auto i = hash & mask;; i = (i + 1) & mask) {
+        const auto& slot = this->slots[i];
+        if (slot.index == EMPTY)
+            break;
+        if (slot.hash == hash && this->matches(vertices[slot.index], vertex))
+            return slot.index;
+    }
+    return this->add(vertex, vertices);
+}
+
+Index VertexWelder::add(const Vertex& vertex, std::vector<Vertex>& vertices) {
+    const auto index = static_cast<Index>(vertices.size());
+    vertices.push_back(vertex);
+    // Keep at most half the slots full so probe sequences stay short
+    if ((this->count + 1) * 2 > this->slots.size())
+        this->grow(std::max<std::size_t>(64, this->slots.size() * 2));
+    this->insert(this->getHash(vertex), index);
+    return index;
+}
+
+void VertexWelder::reserve(std::size_t count_) {
+    auto size = this->slots.empty() ? std::size_t{64} : this->slots.size();
+    while (size < count_ * 2)
+        size *= 2;
+    if (size > this->slots.size())
+        this->grow(size);
+}
+
+void VertexWelder::clear() {
+    this->slots.clear();
+    this->count = 0;
+}
+
+void VertexWelder::rebuild(const std::vector<Vertex>& vertices) {
+    this->clear();
+    this->reserve(vertices.size());
+    for (std::size_t i = 0; i < vertices.size(); i++) {
+        this->insert(this->getHash(vertices[i]), static_cast<Index>(i));
+    }
+}
+
+float VertexWelder::getEpsilon() const {
+    return this->epsilon;
+}
+
+std::uint32_t VertexWelder::getHash(const Vertex& vertex) const {
+    float fields[FIELD_COUNT];
+    getFields(vertex, fields);
+    // FNV-1a over the field keys, folded down to 32 bits at the end
+    std::uint64_t hash = 14695981039346656037ull;
+    for (const auto field : fields) {
+        hash ^= getFieldKey(field, this->epsilon);
+        hash *= 1099511628211ull;
+    }
+    return static_cast<std::uint32_t>(hash ^ (hash >> 32));
+}
+
+bool VertexWelder::matches(const Vertex& lhs, const Vertex& rhs) const {
+    if (this->epsilon <= 0.f)
+        return lhs == rhs;
+    float lhsFields[FIELD_COUNT], rhsFields[FIELD_COUNT];
+    getFields(lhs, lhsFields);
+    getFields(rhs, rhsFields);
+    for (std::size_t i = 0; i < FIELD_COUNT; i++) {
+        if (getFieldKey(lhsFields[i], this->epsilon) != getFieldKey(rhsFields[i], this->epsilon))
+            return false;
+    }
+    return true;
+}
+
+void VertexWelder::insert(std::uint32_t hash, Index index) {
+    const auto mask = this->slots.size() - 1;
+    auto i = hash & mask;
+    while (this->slots[i].index != EMPTY)
+        i = (i + 1) & mask;
+    this->slots[i] = {hash, index};
+    this->count++;
+}
+
+void VertexWelder::grow(std::size_t minimumSlots) {
+    std::size_t size = 64;
+    while (size < minimumSlots)
+        size *= 2;
+    auto oldSlots = std::move(this->slots);
+    this->slots.assign(size, {0, EMPTY});
+    this->count = 0;
+    for (const auto& slot : oldSlots) {
+        if (slot.index != EMPTY)
+            this->insert(slot.hash, slot.index);
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Vertex.h"
+
+namespace chira {
+
+/// Finds vertices that were already added to a vertex list in constant time, so meshes can share them.
+/// With an epsilon above zero every field is rounded to a multiple of it first, and vertices that end
+/// up the same are merged. The vertex list must only grow through this while it's in use.
+class VertexWelder {
+public:
+    explicit VertexWelder(float epsilon_ = 0.f);
+
+    /// Returns the index of a matching vertex, or adds the vertex to the list and returns its new index
+    [[nodiscard]] Index weld(const Vertex& vertex, std::vector<Vertex>& vertices);
+    /// Adds the vertex to the list without looking for a match, later vertices can still be merged with it
+    [[nodiscard]] Index add(const Vertex& vertex, std::vector<Vertex>& vertices);
+    /// Makes room for this many vertices in total
+    void reserve(std::size_t count);
+    /// Call when the vertex list is cleared
+    void clear();
+    /// Forgets every vertex and finds the ones in the given list from now on.
+    /// Call when the list was filled without this welder, or reordered.
+    void rebuild(const std::vector<Vertex>& vertices);
+
+    [[nodiscard]] float getEpsilon() const;
+private:
+    struct Slot {
+        std::uint32_t hash;
+        Index index;
+    };
+    static constexpr Index EMPTY = ~Index{0};
+
+    float epsilon;
+    std::vector<Slot> slots;
+    std::size_t count = 0;
+
+    [[nodiscard]] std::uint32_t getHash(const Vertex& vertex) const;
+    [[nodiscard]] bool matches(const Vertex& lhs, const Vertex& rhs) const;
+    void insert(std::uint32_t hash, Index index);
+    void grow(std::size_t minimumSlots);
+};
+
+} // namespace chira
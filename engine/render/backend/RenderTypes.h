@@ -1,6 +1,7 @@
 #pragma once
 
 #include <concepts>
+#include <cstdint>
 #include <string_view>
 #include <math/Types.h>
 
@@ -100,6 +101,12 @@ enum class MeshCullType {
     NONE,
 };
 
+/// Queued draws are sorted by pass first, so passes are drawn in this order
+enum class RenderPass : std::uint8_t {
+    GEOMETRY,
+    SKYBOX,
+};
+
 [[nodiscard]] MeshDepthFunction getMeshDepthFunctionFromString(std::string_view function);
 [[nodiscard]] MeshCullType getMeshCullTypeFromString(std::string_view type);
 
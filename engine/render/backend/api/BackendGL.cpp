@@ -1,7 +1,10 @@
 #include "BackendGL.h"
 
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <map>
 #include <stack>
 #include <string>
@@ -15,6 +18,8 @@
 #include <glad/gl.h>
 #include <glad/glversion.h>
 
+#include <config/Config.h>
+#include <config/ConEntry.h>
 #include <core/Assertions.h>
 #include <core/Logger.h>
 
@@ -22,6 +27,9 @@ using namespace chira;
 
 CHIRA_CREATE_LOG(GL);
 
+[[maybe_unused]]
+ConVar shader_binary_cache{"shader_binary_cache", true, "Cache linked shader programs on disk to skip compiling them on the next launch.", CON_FLAG_CACHE}; // NOLINT(cert-err58-cpp)
+
 enum class RenderMode {
     CULL_FACE,
     DEPTH_TEST,
@@ -428,32 +436,133 @@ static void destroyShaderModule(Renderer::ShaderModuleHandle handle) {
     glDeleteShader(handle.handle);
 }
 
+/// Program binaries are only valid for the exact driver that produced them, so the driver strings are part of the key
+[[nodiscard]] static std::string getProgramBinaryCacheKey(std::string_view vertex, std::string_view fragment) {
+    std::uint64_t hash = 14695981039346656037ull;
+    const auto hashString = [&hash](std::string_view str) {
+        for (char c : str) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        // Separator so "ab" + "c" and "a" + "bc" hash differently
+        hash ^= 0xff;
+        hash *= 1099511628211ull;
+    };
+    hashString(GL_VERSION_STRING);
+    hashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    hashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    hashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    hashString(vertex);
+    hashString(fragment);
+    return fmt::format("{:016x}", hash);
+}
+
+[[nodiscard]] static std::filesystem::path getProgramBinaryCachePath(std::string_view key) {
+    return std::filesystem::path{Config::getConfigFile("shadercache")} / (std::string{key} + ".bin");
+}
+
+[[nodiscard]] static bool isProgramBinaryCacheSupported() {
+    static const bool supported = [] {
+        int formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }();
+    return supported && shader_binary_cache.getValue<bool>();
+}
+
+/// Returns false if there is no usable binary, e.g. the driver was updated since it was saved
+[[nodiscard]] static bool loadProgramBinary(Renderer::ShaderHandle handle, std::string_view key) {
+    std::ifstream file{getProgramBinaryCachePath(key), std::ios::binary};
+    if (!file)
+        return false;
+
+    std::uint32_t format = 0, length = 0;
+    file.read(reinterpret_cast<char*>(&format), sizeof(format));
+    file.read(reinterpret_cast<char*>(&length), sizeof(length));
+    if (!file || length == 0)
+        return false;
+    std::vector<char> binary(length);
+    if (!file.read(binary.data(), length))
+        return false;
+
+    glProgramBinary(handle.handle, format, binary.data(), static_cast<int>(length));
+    int success = 0;
+    glGetProgramiv(handle.handle, GL_LINK_STATUS, &success);
+    return success;
+}
+
+static void saveProgramBinary(Renderer::ShaderHandle handle, std::string_view key) {
+    int length = 0;
+    glGetProgramiv(handle.handle, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(handle.handle, length, &length, &format, binary.data());
+    if (length <= 0)
+        return;
+
+    std::error_code ec;
+    const auto path = getProgramBinaryCachePath(key);
+    std::filesystem::create_directories(path.parent_path(), ec);
+    // Write to a temporary file first so a crash never leaves a truncated binary behind
+    auto temp = path;
+    temp += ".tmp";
+    {
+        std::ofstream file{temp, std::ios::binary | std::ios::trunc};
+        if (!file)
+            return;
+        const auto format32 = static_cast<std::uint32_t>(format);
+        const auto length32 = static_cast<std::uint32_t>(length);
+        file.write(reinterpret_cast<const char*>(&format32), sizeof(format32));
+        file.write(reinterpret_cast<const char*>(&length32), sizeof(length32));
+        file.write(binary.data(), length);
+        if (!file)
+            return;
+    }
+    std::filesystem::rename(temp, path, ec);
+    if (ec)
+        std::filesystem::remove(temp, ec);
+}
+
 Renderer::ShaderHandle Renderer::createShader(std::string_view vertex, std::string_view fragment) {
     ShaderHandle handle{};
     handle.handle = glCreateProgram();
+
+    std::string cacheKey;
+    if (isProgramBinaryCacheSupported()) {
+        cacheKey = getProgramBinaryCacheKey(vertex, fragment);
+        if (loadProgramBinary(handle, cacheKey))
+            return handle;
+        glProgramParameteri(handle.handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
     handle.vertex = createShaderModule(vertex, handle, ShaderModuleType::VERTEX);
     handle.fragment = createShaderModule(fragment, handle, ShaderModuleType::FRAGMENT);
     glLinkProgram(handle.handle);
 
-#ifdef DEBUG
     int success = 0;
-    char infoLog[512] {0};
     glGetProgramiv(handle.handle, GL_LINK_STATUS, &success);
+#ifdef DEBUG
+    char infoLog[512] {0};
     if (!success) {
         glGetProgramInfoLog(handle.handle, sizeof(infoLog), nullptr, infoLog);
         LOG_GL.error(fmt::format("Shader linking failed: {}", infoLog));
     }
 
-    success = 0;
+    int valid = 0;
     memset(infoLog, 0, sizeof(infoLog));
     glValidateProgram(handle.handle);
-    glGetProgramiv(handle.handle, GL_VALIDATE_STATUS, &success);
-    if (!success) {
+    glGetProgramiv(handle.handle, GL_VALIDATE_STATUS, &valid);
+    if (!valid) {
         glGetProgramInfoLog(handle.handle, sizeof(infoLog), nullptr, infoLog);
         LOG_GL.error(fmt::format("Shader validation failed: {}", infoLog));
     }
 #endif
 
+    if (success && !cacheKey.empty())
+        saveProgramBinary(handle, cacheKey);
+
     return handle;
 }
 
@@ -464,94 +573,215 @@ void Renderer::useShader(Renderer::ShaderHandle handle) {
 
 void Renderer::destroyShader(Renderer::ShaderHandle handle) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    destroyShaderModule(handle.vertex);
-    destroyShaderModule(handle.fragment);
+    // Programs loaded from the binary cache were never built from modules
+    if (handle.vertex)
+        destroyShaderModule(handle.vertex);
+    if (handle.fragment)
+        destroyShaderModule(handle.fragment);
     glDeleteProgram(handle.handle);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, bool value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniform1i(glGetUniformLocation(handle.handle, name.data()), static_cast<int>(value));
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, int value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniform1i(glGetUniformLocation(handle.handle, name.data()), value);
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, unsigned int value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniform1ui(glGetUniformLocation(handle.handle, name.data()), value);
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, float value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniform1f(glGetUniformLocation(handle.handle, name.data()), value);
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, glm::vec2b value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniform2i(glGetUniformLocation(handle.handle, name.data()), static_cast<int>(value.x), static_cast<int>(value.y));
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, glm::vec2ui value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniform2ui(glGetUniformLocation(handle.handle, name.data()), value.x, value.y);
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, glm::vec2i value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniform2i(glGetUniformLocation(handle.handle, name.data()), value.x, value.y);
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, glm::vec2f value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniform2f(glGetUniformLocation(handle.handle, name.data()), value.x, value.y);
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, glm::vec3b value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniform3i(glGetUniformLocation(handle.handle, name.data()), static_cast<int>(value.x), static_cast<int>(value.y), static_cast<int>(value.z));
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, glm::vec3ui value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniform3ui(glGetUniformLocation(handle.handle, name.data()), value.x, value.y, value.z);
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, glm::vec3i value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniform3i(glGetUniformLocation(handle.handle, name.data()), value.x, value.y, value.z);
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, glm::vec3f value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniform3f(glGetUniformLocation(handle.handle, name.data()), value.x, value.y, value.z);
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, glm::vec4b value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniform4i(glGetUniformLocation(handle.handle, name.data()), static_cast<int>(value.x), static_cast<int>(value.y), static_cast<int>(value.z), static_cast<int>(value.w));
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, glm::vec4ui value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniform4ui(glGetUniformLocation(handle.handle, name.data()), value.x, value.y, value.z, value.w);
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, glm::vec4i value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniform4i(glGetUniformLocation(handle.handle, name.data()), value.x, value.y, value.z, value.w);
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, glm::vec4f value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniform4f(glGetUniformLocation(handle.handle, name.data()), value.x, value.y, value.z, value.w);
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
 }
 
 void Renderer::setShaderUniform(Renderer::ShaderHandle handle, std::string_view name, glm::mat4 value) {
     runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
-    glUniformMatrix4fv(glGetUniformLocation(handle.handle, name.data()), 1, GL_FALSE, glm::value_ptr(value));
+    Renderer::setShaderUniform(handle, glGetUniformLocation(handle.handle, name.data()), value);
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, bool value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniform1i(location, static_cast<int>(value));
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, int value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniform1i(location, value);
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, unsigned int value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniform1ui(location, value);
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, float value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniform1f(location, value);
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, glm::vec2b value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniform2i(location, static_cast<int>(value.x), static_cast<int>(value.y));
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, glm::vec2ui value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniform2ui(location, value.x, value.y);
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, glm::vec2i value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniform2i(location, value.x, value.y);
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, glm::vec2f value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniform2f(location, value.x, value.y);
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, glm::vec3b value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniform3i(location, static_cast<int>(value.x), static_cast<int>(value.y), static_cast<int>(value.z));
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, glm::vec3ui value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniform3ui(location, value.x, value.y, value.z);
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, glm::vec3i value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniform3i(location, value.x, value.y, value.z);
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, glm::vec3f value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniform3f(location, value.x, value.y, value.z);
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, glm::vec4b value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniform4i(location, static_cast<int>(value.x), static_cast<int>(value.y), static_cast<int>(value.z), static_cast<int>(value.w));
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, glm::vec4ui value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniform4ui(location, value.x, value.y, value.z, value.w);
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, glm::vec4i value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniform4i(location, value.x, value.y, value.z, value.w);
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, glm::vec4f value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniform4f(location, value.x, value.y, value.z, value.w);
+}
+
+void Renderer::setShaderUniform(Renderer::ShaderHandle handle, int location, glm::mat4 value) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+std::vector<std::pair<std::string, int>> Renderer::getShaderUniforms(Renderer::ShaderHandle handle) {
+    runtime_assert(static_cast<bool>(handle), "Invalid shader handle given to GL renderer");
+    int count = 0, maxLength = 0;
+    glGetProgramiv(handle.handle, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(handle.handle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<std::pair<std::string, int>> uniforms;
+    std::string buffer(maxLength, '\0');
+    for (int i = 0; i < count; i++) {
+        int length = 0, size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(handle.handle, i, maxLength, &length, &size, &type, buffer.data());
+        std::string name = buffer.substr(0, length);
+        // Uniform block members have no location
+        int location = glGetUniformLocation(handle.handle, name.c_str());
+        if (location < 0)
+            continue;
+
+        // Arrays are reported as "name[0]", but can be set through the bare name too
+        if (name.ends_with("[0]")) {
+            const auto base = name.substr(0, name.size() - 3);
+            uniforms.emplace_back(base, location);
+            for (int element = 1; element < size; element++) {
+                auto elementName = fmt::format("{}[{}]", base, element);
+                int elementLocation = glGetUniformLocation(handle.handle, elementName.c_str());
+                uniforms.emplace_back(std::move(elementName), elementLocation);
+            }
+        }
+        uniforms.emplace_back(std::move(name), location);
+    }
+    return uniforms;
 }
 
 Renderer::UniformBufferHandle Renderer::createUniformBuffer(std::ptrdiff_t size) {
@@ -639,6 +869,23 @@ void Renderer::destroyUniformBuffer(Renderer::UniformBufferHandle handle) {
     return GL_BACK;
 }
 
+/// Per-instance model matrices, shared by every mesh and refilled for each instanced draw
+static unsigned int INSTANCE_BUFFER = 0;
+static std::size_t INSTANCE_BUFFER_CAPACITY = 0;
+
+static void bindInstanceBuffer() {
+    if (!INSTANCE_BUFFER) {
+        // Start with an identity matrix so meshes drawn without instancing never read an empty buffer
+        const glm::mat4 identity{1.f};
+        glGenBuffers(1, &INSTANCE_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, INSTANCE_BUFFER);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4), glm::value_ptr(identity), GL_STREAM_DRAW);
+        INSTANCE_BUFFER_CAPACITY = 1;
+        return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, INSTANCE_BUFFER);
+}
+
 Renderer::MeshHandle Renderer::createMesh(const std::vector<Vertex>& vertices, const std::vector<Index>& indices, MeshDrawMode drawMode) {
     MeshHandle handle{};
     glGenVertexArrays(1, &handle.vaoHandle);
@@ -666,6 +913,13 @@ Renderer::MeshHandle Renderer::createMesh(const std::vector<Vertex>& vertices, c
     // texture coord attribute
     glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, uv)));
     glEnableVertexAttribArray(3);
+    // instance model matrix attribute, one column per location
+    bindInstanceBuffer();
+    for (int column = 0; column < 4; column++) {
+        glVertexAttribPointer(4 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<void*>(column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(4 + column);
+        glVertexAttribDivisor(4 + column, 1);
+    }
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
@@ -691,6 +945,47 @@ void Renderer::drawMesh(MeshHandle handle, const std::vector<Index>& indices, Me
     popState(RenderMode::CULL_FACE);
 }
 
+void Renderer::beginMeshDraws() {
+    pushState(RenderMode::CULL_FACE, true);
+}
+
+void Renderer::setMeshDepthFunction(MeshDepthFunction depthFunction) {
+    glDepthFunc(getMeshDepthFunctionGL(depthFunction));
+}
+
+void Renderer::setMeshCullType(MeshCullType cullType) {
+    glCullFace(getMeshCullTypeGL(cullType));
+}
+
+void Renderer::drawMeshElements(MeshHandle handle, std::size_t indexCount) {
+    runtime_assert(static_cast<bool>(handle), "Invalid mesh handle given to GL renderer");
+    glBindVertexArray(handle.vaoHandle);
+    glDrawElements(GL_TRIANGLES, static_cast<GLint>(indexCount), GL_UNSIGNED_INT, nullptr);
+}
+
+void Renderer::drawMeshInstanced(MeshHandle handle, std::size_t indexCount, const std::vector<glm::mat4>& transforms) {
+    runtime_assert(static_cast<bool>(handle), "Invalid mesh handle given to GL renderer");
+    if (transforms.empty())
+        return;
+    bindInstanceBuffer();
+    const auto size = static_cast<GLsizeiptr>(transforms.size() * sizeof(glm::mat4));
+    if (transforms.size() > INSTANCE_BUFFER_CAPACITY) {
+        glBufferData(GL_ARRAY_BUFFER, size, transforms.data(), GL_STREAM_DRAW);
+        INSTANCE_BUFFER_CAPACITY = transforms.size();
+    } else {
+        // Orphan the old storage so the driver doesn't wait on draws still reading it
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(INSTANCE_BUFFER_CAPACITY * sizeof(glm::mat4)), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, transforms.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(handle.vaoHandle);
+    glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLint>(indexCount), GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(transforms.size()));
+}
+
+void Renderer::endMeshDraws() {
+    popState(RenderMode::CULL_FACE);
+}
+
 void Renderer::destroyMesh(MeshHandle handle) {
     runtime_assert(static_cast<bool>(handle), "Invalid mesh handle given to GL renderer");
     glDeleteVertexArrays(1, &handle.vaoHandle);
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <cstddef>
+#include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 #include <loader/image/Image.h>
 #include <math/Color.h>
@@ -44,11 +46,12 @@ struct ShaderModuleHandle {
 
 struct ShaderHandle {
     int handle = 0;
+    /// Empty when the program was loaded from the program binary cache
     ShaderModuleHandle vertex{};
     ShaderModuleHandle fragment{};
 
-    explicit inline operator bool() const { return handle && vertex && fragment; }
-    inline bool operator!() const { return !handle || !vertex || !fragment; }
+    explicit inline operator bool() const { return handle; }
+    inline bool operator!() const { return !handle; }
 };
 
 struct UniformBufferHandle {
@@ -112,6 +115,27 @@ void setShaderUniform(ShaderHandle handle, std::string_view name, glm::vec4i val
 void setShaderUniform(ShaderHandle handle, std::string_view name, glm::vec4f value);
 void setShaderUniform(ShaderHandle handle, std::string_view name, glm::mat4 value);
 
+void setShaderUniform(ShaderHandle handle, int location, bool value);
+void setShaderUniform(ShaderHandle handle, int location, unsigned int value);
+void setShaderUniform(ShaderHandle handle, int location, int value);
+void setShaderUniform(ShaderHandle handle, int location, float value);
+void setShaderUniform(ShaderHandle handle, int location, glm::vec2b value);
+void setShaderUniform(ShaderHandle handle, int location, glm::vec2ui value);
+void setShaderUniform(ShaderHandle handle, int location, glm::vec2i value);
+void setShaderUniform(ShaderHandle handle, int location, glm::vec2f value);
+void setShaderUniform(ShaderHandle handle, int location, glm::vec3b value);
+void setShaderUniform(ShaderHandle handle, int location, glm::vec3ui value);
+void setShaderUniform(ShaderHandle handle, int location, glm::vec3i value);
+void setShaderUniform(ShaderHandle handle, int location, glm::vec3f value);
+void setShaderUniform(ShaderHandle handle, int location, glm::vec4b value);
+void setShaderUniform(ShaderHandle handle, int location, glm::vec4ui value);
+void setShaderUniform(ShaderHandle handle, int location, glm::vec4i value);
+void setShaderUniform(ShaderHandle handle, int location, glm::vec4f value);
+void setShaderUniform(ShaderHandle handle, int location, glm::mat4 value);
+
+/// Active uniforms of a linked program and their locations, uniform block members are not included
+[[nodiscard]] std::vector<std::pair<std::string, int>> getShaderUniforms(ShaderHandle handle);
+
 [[nodiscard]] UniformBufferHandle createUniformBuffer(std::ptrdiff_t size);
 void bindUniformBufferToShader(ShaderHandle shaderHandle, UniformBufferHandle uniformBufferHandle, std::string_view name);
 void updateUniformBuffer(UniformBufferHandle handle, const void* buffer, std::ptrdiff_t length);
@@ -121,6 +145,14 @@ void destroyUniformBuffer(UniformBufferHandle handle);
 [[nodiscard]] MeshHandle createMesh(const std::vector<Vertex>& vertices, const std::vector<Index>& indices, MeshDrawMode drawMode);
 void updateMesh(MeshHandle handle, const std::vector<Vertex>& vertices, const std::vector<Index>& indices, MeshDrawMode drawMode);
 void drawMesh(MeshHandle handle, const std::vector<Index>& indices, MeshDepthFunction depthFunction, MeshCullType cullType);
+/// Draws meshes in a row without resetting state in between, the depth function and cull type stay set until changed
+void beginMeshDraws();
+void setMeshDepthFunction(MeshDepthFunction depthFunction);
+void setMeshCullType(MeshCullType cullType);
+void drawMeshElements(MeshHandle handle, std::size_t indexCount);
+/// Draws the mesh once per transform, the shader reads each transform from the instance attribute at locations 4-7
+void drawMeshInstanced(MeshHandle handle, std::size_t indexCount, const std::vector<glm::mat4>& transforms);
+void endMeshDraws();
 void destroyMesh(MeshHandle handle);
 
 void initImGui(SDL_Window* window, void* context);
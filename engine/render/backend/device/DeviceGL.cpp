@@ -14,6 +14,7 @@
 #include <resource/provider/FilesystemResourceProvider.h>
 #include <render/material/MaterialFramebuffer.h>
 #include <render/material/MaterialTextured.h>
+#include <render/queue/RenderQueue.h>
 #include <ui/Font.h>
 #include <ui/IPanel.h>
 
@@ -158,7 +159,7 @@ void Device::refresh() {
     Renderer::startImGuiFrame(this->window);
 
     this->frame.update();
-    this->frame.render(glm::identity<glm::mat4>());
+    this->frame.render();
     glViewport(0, 0, this->width, this->height);
 
     for (auto& [uuid, panel] : this->panels) {
@@ -176,6 +177,7 @@ void Device::refresh() {
     glEnable(GL_DEPTH_TEST);
 
     SDL_GL_SwapWindow(this->window);
+    RenderQueue::endFrame();
 }
 
 Device::~Device() {
@@ -8,8 +8,7 @@ void MaterialCubemap::compile(const nlohmann::json& properties) {
     Serialize::fromJSON(this, properties);
 }
 
-void MaterialCubemap::use() const {
-    IMaterial::use();
+void MaterialCubemap::useProperties() const {
     this->cubemap->use();
 }
 
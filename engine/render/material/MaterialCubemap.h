@@ -9,7 +9,7 @@ class MaterialCubemap final : public IMaterial {
 public:
     explicit MaterialCubemap(std::string identifier_) : IMaterial(std::move(identifier_)) {}
     void compile(const nlohmann::json& properties) override;
-    void use() const override;
+    void useProperties() const override;
     [[nodiscard]] SharedPointer<TextureCubemap> getTextureCubemap() const;
     void setTextureCubemap(std::string path);
 protected:
@@ -10,6 +10,7 @@ void IMaterial::compile(const nlohmann::json& properties) {
 
 void IMaterial::use() const {
     this->shader->use();
+    this->useProperties();
 }
 
 SharedPointer<Shader> IMaterial::getShader() const {
@@ -12,7 +12,11 @@ class IMaterial : public PropertiesResource {
 public:
     explicit IMaterial(std::string identifier_);
     void compile(const nlohmann::json& properties) override;
-    virtual void use() const;
+    /// Binds the shader, then everything in useProperties().
+    void use() const;
+    /// Binds the material's textures and sets its uniforms, the shader must already be bound.
+    /// Render queues call this directly when the previous material used the same shader.
+    virtual void useProperties() const {}
     [[nodiscard]] SharedPointer<Shader> getShader() const;
     void setShader(std::string path);
 protected:
@@ -10,7 +10,6 @@ void MaterialFramebuffer::compile(const nlohmann::json& properties) {
     this->shader->setUniform("texture0", 0);
 }
 
-void MaterialFramebuffer::use() const {
-    IMaterial::use();
+void MaterialFramebuffer::useProperties() const {
     this->frame->useFrameBufferTexture();
 }
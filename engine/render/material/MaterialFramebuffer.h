@@ -12,7 +12,7 @@ public:
         : IMaterial(std::move(identifier_))
         , frame(frame_) {}
     void compile(const nlohmann::json& properties) override;
-    void use() const override;
+    void useProperties() const override;
 protected:
     Frame* frame;
 public:
@@ -4,16 +4,20 @@
 
 using namespace chira;
 
+static const auto DIFFUSE_UNIFORM = Shader::getUniform<int>("material.diffuse"); // NOLINT(cert-err58-cpp)
+static const auto SPECULAR_UNIFORM = Shader::getUniform<int>("material.specular"); // NOLINT(cert-err58-cpp)
+static const auto SHININESS_UNIFORM = Shader::getUniform<float>("material.shininess"); // NOLINT(cert-err58-cpp)
+static const auto LAMBERT_FACTOR_UNIFORM = Shader::getUniform<float>("material.lambertFactor"); // NOLINT(cert-err58-cpp)
+
 void MaterialPhong::compile(const nlohmann::json& properties) {
     Serialize::fromJSON(this, properties);
 }
 
-void MaterialPhong::use() const {
-    IMaterial::use();
+void MaterialPhong::useProperties() const {
     this->diffuse->use(TextureUnit::G0);
     this->specular->use(TextureUnit::G1);
-    this->shader->setUniform("material.shininess", this->shininess);
-    this->shader->setUniform("material.lambertFactor", this->lambertFactor);
+    this->shader->setUniform(SHININESS_UNIFORM, this->shininess);
+    this->shader->setUniform(LAMBERT_FACTOR_UNIFORM, this->lambertFactor);
 }
 
 SharedPointer<Texture> MaterialPhong::getTextureDiffuse() const {
@@ -24,7 +28,7 @@ void MaterialPhong::setTextureDiffuse(std::string path) {
     this->diffusePath = std::move(path);
     this->diffuse = Resource::getResource<Texture>(this->diffusePath);
     this->shader->use();
-    this->shader->setUniform("material.diffuse", 0);
+    this->shader->setUniform(DIFFUSE_UNIFORM, 0);
 }
 
 SharedPointer<Texture> MaterialPhong::getTextureSpecular() const {
@@ -35,7 +39,7 @@ void MaterialPhong::setTextureSpecular(std::string path) {
     this->specularPath = std::move(path);
     this->specular = Resource::getResource<Texture>(this->specularPath);
     this->shader->use();
-    this->shader->setUniform("material.specular", 1);
+    this->shader->setUniform(SPECULAR_UNIFORM, 1);
 }
 
 float MaterialPhong::getShininess() const {
@@ -45,7 +49,7 @@ float MaterialPhong::getShininess() const {
 void MaterialPhong::setShininess(float shininess_) {
     this->shininess = shininess_;
     this->shader->use();
-    this->shader->setUniform("material.shininess", this->shininess);
+    this->shader->setUniform(SHININESS_UNIFORM, this->shininess);
 }
 
 float MaterialPhong::getLambertFactor() const {
@@ -55,5 +59,5 @@ float MaterialPhong::getLambertFactor() const {
 void MaterialPhong::setLambertFactor(float lambertFactor_) {
     this->lambertFactor = lambertFactor_;
     this->shader->use();
-    this->shader->setUniform("material.lambertFactor", this->lambertFactor);
+    this->shader->setUniform(LAMBERT_FACTOR_UNIFORM, this->lambertFactor);
 }
@@ -9,7 +9,7 @@ class MaterialPhong final : public IMaterial {
 public:
     explicit MaterialPhong(std::string identifier_) : IMaterial(std::move(identifier_)) {}
     void compile(const nlohmann::json& properties) override;
-    void use() const override;
+    void useProperties() const override;
     [[nodiscard]] SharedPointer<Texture> getTextureDiffuse() const;
     void setTextureDiffuse(std::string path);
     [[nodiscard]] SharedPointer<Texture> getTextureSpecular() const;
@@ -6,8 +6,7 @@ void MaterialTextured::compile(const nlohmann::json& properties) {
     Serialize::fromJSON(this, properties);
 }
 
-void MaterialTextured::use() const {
-    IMaterial::use();
+void MaterialTextured::useProperties() const {
     this->texture->use();
 }
 
@@ -9,7 +9,7 @@ class MaterialTextured final : public IMaterial {
 public:
     explicit MaterialTextured(std::string identifier_) : IMaterial(std::move(identifier_)) {}
     void compile(const nlohmann::json& properties) override;
-    void use() const override;
+    void useProperties() const override;
     [[nodiscard]] SharedPointer<Texture> getTexture() const;
     void setTexture(std::string path);
 protected:
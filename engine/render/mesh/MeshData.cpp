@@ -4,29 +4,47 @@
 #include <string>
 #include <config/ConEntry.h>
 #include <math/Matrix.h>
+#include <math/MeshOptimizer.h>
+#include <render/queue/RenderQueue.h>
 
 using namespace chira;
 
 void MeshData::setupForRendering() {
     this->handle = Renderer::createMesh(this->vertices, this->indices, MeshDrawMode::STATIC);
     this->initialized = true;
+    this->updateBounds();
 }
 
 void MeshData::updateMeshData() {
     if (!this->initialized)
         return;
     Renderer::updateMesh(this->handle, this->vertices, this->indices, this->drawMode);
+    this->updateBounds();
 }
 
 void MeshData::render(glm::mat4 model) {
     if (!this->initialized)
         this->setupForRendering();
-    if (this->material) {
-        this->material->use();
-        if (this->material->getShader()->usesModelMatrix())
-            this->material->getShader()->setUniform("m", model);
+
+    auto* queue = RenderQueue::getActive();
+    // The skybox is drawn around the camera wherever it is, it can't be culled
+    if (queue && this->renderPass == RenderPass::GEOMETRY && queue->cull(this->bounds.transform(model)))
+        return;
+
+    DrawPacket packet{
+        .mesh = this->handle,
+        .indexCount = this->indices.size(),
+        .material = this->material.get(),
+        .shader = this->material ? this->material->getShader().get() : nullptr,
+        .model = model,
+        .depthFunction = this->depthFunction,
+        .cullType = this->cullType,
+    };
+    if (queue) {
+        queue->submit(this->renderPass, packet);
+    } else {
+        RenderQueue::drawImmediately(packet);
     }
-    Renderer::drawMesh(this->handle, this->indices, this->depthFunction, this->cullType);
 }
 
 MeshData::~MeshData() {
@@ -59,6 +77,26 @@ void MeshData::setCullType(MeshCullType type) {
     this->cullType = type;
 }
 
+RenderPass MeshData::getRenderPass() const {
+    return this->renderPass;
+}
+
+void MeshData::setRenderPass(RenderPass pass) {
+    this->renderPass = pass;
+}
+
+const AABB& MeshData::getBounds() const {
+    return this->bounds;
+}
+
+const std::vector<Vertex>& MeshData::getVertices() const {
+    return this->vertices;
+}
+
+const std::vector<Index>& MeshData::getIndices() const {
+    return this->indices;
+}
+
 std::vector<byte> MeshData::getMeshData(const std::string& meshLoader) const {
     return IMeshLoader::getMeshLoader(meshLoader)->createMesh(this->vertices, this->indices);
 }
@@ -67,7 +105,19 @@ void MeshData::appendMeshData(const std::string& loader, const std::string& iden
     IMeshLoader::getMeshLoader(loader)->loadMesh(identifier, this->vertices, this->indices);
 }
 
+void MeshData::optimize() {
+    MeshOptimizer::optimize(this->vertices, this->indices);
+    this->updateMeshData();
+}
+
 void MeshData::clearMeshData() {
     this->vertices.clear();
     this->indices.clear();
 }
+
+void MeshData::updateBounds() {
+    this->bounds = {};
+    for (const auto& vertex : this->vertices) {
+        this->bounds.expand(vertex.position);
+    }
+}
@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <loader/mesh/IMeshLoader.h>
+#include <math/Bounds.h>
 #include <render/backend/RenderTypes.h>
 #include <render/material/MaterialFactory.h>
 
@@ -11,6 +12,8 @@ namespace chira {
 class MeshData {
 public:
     MeshData() = default;
+    /// Submits the mesh to the active render queue, or draws it immediately if there isn't one.
+    /// Meshes outside the active queue's frustum are skipped.
     void render(glm::mat4 model);
     virtual ~MeshData();
     [[nodiscard]] SharedPointer<IMaterial> getMaterial() const;
@@ -19,23 +22,35 @@ public:
     void setDepthFunction(MeshDepthFunction function);
     [[nodiscard]] MeshCullType getCullType() const;
     void setCullType(MeshCullType type);
+    [[nodiscard]] RenderPass getRenderPass() const;
+    void setRenderPass(RenderPass pass);
+    /// Local space bounds of the vertices, recalculated whenever the vertex buffers are updated
+    [[nodiscard]] const AABB& getBounds() const;
+    [[nodiscard]] const std::vector<Vertex>& getVertices() const;
+    [[nodiscard]] const std::vector<Index>& getIndices() const;
     [[nodiscard]] std::vector<byte> getMeshData(const std::string& meshLoader) const;
     void appendMeshData(const std::string& loader, const std::string& identifier);
+    /// Reorders the triangles and vertices to draw faster without changing how the mesh looks, see MeshOptimizer.
+    /// Mesh resources are shared, to save an optimized copy of one use ChiraMeshOptions::optimize instead.
+    virtual void optimize();
 protected:
     bool initialized = false;
     Renderer::MeshHandle handle{};
     MeshDrawMode drawMode = MeshDrawMode::STATIC;
     MeshDepthFunction depthFunction = MeshDepthFunction::LEQUAL;
     MeshCullType cullType = MeshCullType::BACK;
+    RenderPass renderPass = RenderPass::GEOMETRY;
     SharedPointer<IMaterial> material;
     std::vector<Vertex> vertices;
     std::vector<Index> indices;
+    AABB bounds;
     /// Establishes the vertex buffers and copies the current mesh data into them.
     void setupForRendering();
     /// Updates the vertex buffers with the current mesh data.
     void updateMeshData();
     /// Does not call updateMeshData().
     void clearMeshData();
+    void updateBounds();
 };
 
 } // namespace chira
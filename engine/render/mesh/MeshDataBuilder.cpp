@@ -1,25 +1,13 @@
 #include "MeshDataBuilder.h"
 
-#include <algorithm>
-
 using namespace chira;
 
 MeshDataBuilder::MeshDataBuilder() : MeshData() {
     this->drawMode = MeshDrawMode::DYNAMIC;
 }
 
-void MeshDataBuilder::addVertex(Vertex vertex, bool addDuplicate) { // NOLINT(misc-no-recursion)
-    if (addDuplicate) {
-        this->vertices.push_back(vertex);
-        this->indices.push_back(this->currentIndex);
-        this->currentIndex += 1;
-        return;
-    }
-    if (auto position = std::find(this->vertices.begin(), this->vertices.end(), vertex); position != this->vertices.end()) {
-        this->indices.push_back(static_cast<Index>(position - this->vertices.begin()));
-    } else {
-        this->addVertex(vertex, true);
-    }
+void MeshDataBuilder::addVertex(Vertex vertex, bool addDuplicate) {
+    this->indices.push_back(addDuplicate ? this->welder.add(vertex, this->vertices) : this->welder.weld(vertex, this->vertices));
 }
 
 void MeshDataBuilder::addTriangle(Vertex v1, Vertex v2, Vertex v3, bool addDuplicate) {
@@ -200,6 +188,13 @@ void MeshDataBuilder::update() {
     this->updateMeshData();
 }
 
+void MeshDataBuilder::optimize() {
+    MeshData::optimize();
+    // The welder still points at where the vertices were before they moved
+    this->welder.rebuild(this->vertices);
+}
+
 void MeshDataBuilder::clear() {
     this->clearMeshData();
+    this->welder.clear();
 }
@@ -2,6 +2,7 @@
 
 #include <render/mesh/MeshData.h>
 #include <math/Axis.h>
+#include <math/VertexWelder.h>
 
 namespace chira {
 
@@ -16,9 +17,11 @@ public:
     void update();
     /// Does not call update().
     void clear();
+    /// Vertices can still be added afterwards, and are shared with the optimized ones.
+    void optimize() override;
 protected:
-    Index currentIndex = 0;
-    /// Pass true to addDuplicate if you don't want to scan the entire vertex vector to calculate the index.
+    VertexWelder welder;
+    /// Pass true to addDuplicate if you don't want to look for an existing vertex to share.
     /// This will make a duplicate vertex if one already exists.
     void addVertex(Vertex vertex, bool addDuplicate = false);
 };
@@ -14,10 +14,41 @@ void MeshDataResource::compile(const nlohmann::json& properties) {
     if (!this->materialSetInCode) {
         this->material = CHIRA_GET_MATERIAL(this->materialType, this->materialPath);
     }
-    this->appendMeshData(this->modelLoader, this->modelPath);
+    // Already loaded by prepareAsync() if the mesh was loaded asynchronously
+    if (!this->meshDataPrepared) {
+        this->appendMeshData(this->modelLoader, this->modelPath);
+    }
+    this->meshDataPrepared = false;
     this->setupForRendering();
 }
 
+void MeshDataResource::prepareAsync(const nlohmann::json& properties) {
+    // Materials need the renderer, they're left for compile()
+    Serialize::fromJSON(this, properties);
+    this->appendMeshData(this->modelLoader, this->modelPath);
+    this->meshDataPrepared = true;
+}
+
+bool MeshDataResource::unloadForReload() {
+    if (this->initialized) {
+        Renderer::destroyMesh(this->handle);
+        this->handle = {};
+        this->initialized = false;
+    }
+    this->clearMeshData();
+    return true;
+}
+
+std::size_t MeshDataResource::getCPUMemoryUsage() const {
+    return PropertiesResource::getCPUMemoryUsage() + this->vertices.capacity() * sizeof(Vertex) + this->indices.capacity() * sizeof(Index);
+}
+
+std::size_t MeshDataResource::getGPUMemoryUsage() const {
+    if (!this->initialized)
+        return 0;
+    return this->vertices.size() * sizeof(Vertex) + this->indices.size() * sizeof(Index);
+}
+
 void MeshDataResource::setDepthFunction(std::string depthFuncStr_) {
     this->depthFuncStr = std::move(depthFuncStr_);
     this->depthFunction = getMeshDepthFunctionFromString(this->depthFuncStr);
@@ -10,9 +10,15 @@ class MeshDataResource : public PropertiesResource, public MeshData {
 public:
     explicit MeshDataResource(std::string identifier_) : PropertiesResource(std::move(identifier_)), MeshData() {}
     void compile(const nlohmann::json& properties) override;
+    /// Loads the model, so compile() only has to set up the material and upload the mesh.
+    void prepareAsync(const nlohmann::json& properties) override;
+    bool unloadForReload() override;
+    [[nodiscard]] std::size_t getCPUMemoryUsage() const override;
+    [[nodiscard]] std::size_t getGPUMemoryUsage() const override;
     void setDepthFunction(std::string depthFuncStr_);
     void setCullType(std::string cullTypeStr_);
 private:
+    bool meshDataPrepared = false;
     bool materialSetInCode = false;
     std::string materialType{"MaterialTextured"};
     std::string materialPath{"file://materials/unlitTextured.json"};
@@ -0,0 +1,187 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <bit>
+#include <config/ConEntry.h>
+#include <core/Assertions.h>
+#include <core/Logger.h>
+#include <i18n/TranslationManager.h>
+#include <render/material/MaterialFactory.h>
+#include <render/shader/Shader.h>
+
+using namespace chira;
+
+CHIRA_CREATE_LOG(RENDERQUEUE);
+
+[[maybe_unused]]
+ConVar render_frustum_culling{"render_frustum_culling", true, "Skip drawing meshes that are outside the camera's view."}; // NOLINT(cert-err58-cpp)
+
+static const auto MODEL_MATRIX_UNIFORM = Shader::getUniform<glm::mat4>("m"); // NOLINT(cert-err58-cpp)
+
+[[maybe_unused]]
+ConCommand render_stats{"render_stats", "Prints how many draws and state changes the last frame took.", [] { // NOLINT(cert-err58-cpp)
+    const auto stats = RenderQueue::getLastFrameStatistics();
+    LOG_RENDERQUEUE.info(TRF("info.render_queue.statistics", stats.draws, stats.instances, stats.culled, stats.shaderChanges, stats.materialChanges, stats.stateChanges));
+}};
+
+/// Fibonacci hashing, the top bits of the product are the best mixed
+[[nodiscard]] static std::uint64_t hashPointer(const void* pointer, int bits) {
+    return (static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(pointer)) * 11400714819323198485ull) >> (64 - bits);
+}
+
+void RenderQueue::begin(glm::vec3 viewPosition_, std::optional<Frustum> frustum_) {
+    this->viewPosition = viewPosition_;
+    this->frustum = frustum_;
+    RenderQueue::activeQueues.push_back(this);
+}
+
+bool RenderQueue::cull(const AABB& worldBounds) {
+    if (!this->frustum || !render_frustum_culling.getValue<bool>() || this->frustum->intersects(worldBounds))
+        return false;
+    RenderQueue::currentFrame.culled++;
+    return true;
+}
+
+void RenderQueue::submit(RenderPass pass, DrawPacket packet) {
+    const float depth = glm::length(glm::vec3{packet.model[3]} - this->viewPosition);
+    packet.sortKey = RenderQueue::getSortKey(pass, packet.shader, packet.material, packet.mesh, depth);
+    this->packets.push_back(packet);
+}
+
+void RenderQueue::sort() {
+    std::sort(this->packets.begin(), this->packets.end(), [](const DrawPacket& lhs, const DrawPacket& rhs) {
+        return lhs.sortKey < rhs.sortKey;
+    });
+}
+
+void RenderQueue::execute() {
+    runtime_assert(!RenderQueue::activeQueues.empty() && RenderQueue::activeQueues.back() == this,
+                   "Render queues must be executed in the reverse order they were begun in");
+    RenderQueue::activeQueues.pop_back();
+    this->sort();
+
+    Renderer::beginMeshDraws();
+    const IMaterial* material = nullptr;
+    const Shader* shader = nullptr;
+    auto depthFunction = MeshDepthFunction::LEQUAL;
+    auto cullType = MeshCullType::BACK;
+    bool first = true;
+    for (std::size_t i = 0; i < this->packets.size();) {
+        const auto& packet = this->packets[i];
+        // Hash collisions in the sort key only cost extra changes, the comparisons here use the real pointers
+        const bool shaderChanged = first || packet.shader != shader;
+        if (shaderChanged) {
+            shader = packet.shader;
+            if (shader)
+                shader->use();
+            RenderQueue::currentFrame.shaderChanges++;
+        }
+        // Material uniforms belong to the shader, so they're set again whenever it changes
+        if (shaderChanged || packet.material != material) {
+            material = packet.material;
+            if (material)
+                material->useProperties();
+            RenderQueue::currentFrame.materialChanges++;
+        }
+        if (first || packet.depthFunction != depthFunction) {
+            depthFunction = packet.depthFunction;
+            Renderer::setMeshDepthFunction(depthFunction);
+            RenderQueue::currentFrame.stateChanges++;
+        }
+        if (first || packet.cullType != cullType) {
+            cullType = packet.cullType;
+            Renderer::setMeshCullType(cullType);
+            RenderQueue::currentFrame.stateChanges++;
+        }
+        first = false;
+
+        if (packet.shader && packet.shader->isInstanced()) {
+            const auto batchEnd = this->getBatchEnd(i);
+            this->instanceTransforms.clear();
+            for (std::size_t j = i; j < batchEnd; j++)
+                this->instanceTransforms.push_back(this->packets[j].model);
+            Renderer::drawMeshInstanced(packet.mesh, packet.indexCount, this->instanceTransforms);
+            RenderQueue::currentFrame.instances += batchEnd - i;
+            i = batchEnd;
+        } else {
+            if (packet.shader && packet.shader->usesModelMatrix())
+                packet.shader->setUniform(MODEL_MATRIX_UNIFORM, packet.model);
+            Renderer::drawMeshElements(packet.mesh, packet.indexCount);
+            RenderQueue::currentFrame.instances++;
+            i++;
+        }
+        RenderQueue::currentFrame.draws++;
+    }
+    Renderer::endMeshDraws();
+
+    this->packets.clear();
+}
+
+std::size_t RenderQueue::getBatchEnd(std::size_t begin) const {
+    const auto& first = this->packets[begin];
+    std::size_t end = begin + 1;
+    while (end < this->packets.size() && RenderQueue::canBatch(first, this->packets[end]))
+        end++;
+    return end;
+}
+
+const std::vector<DrawPacket>& RenderQueue::getPackets() const {
+    return this->packets;
+}
+
+RenderQueue* RenderQueue::getActive() {
+    if (RenderQueue::activeQueues.empty())
+        return nullptr;
+    return RenderQueue::activeQueues.back();
+}
+
+void RenderQueue::drawImmediately(const DrawPacket& packet) {
+    if (packet.material)
+        packet.material->use();
+    if (packet.shader && packet.shader->usesModelMatrix())
+        packet.shader->setUniform(MODEL_MATRIX_UNIFORM, packet.model);
+    Renderer::beginMeshDraws();
+    Renderer::setMeshDepthFunction(packet.depthFunction);
+    Renderer::setMeshCullType(packet.cullType);
+    if (packet.shader && packet.shader->isInstanced()) {
+        Renderer::drawMeshInstanced(packet.mesh, packet.indexCount, {packet.model});
+    } else {
+        Renderer::drawMeshElements(packet.mesh, packet.indexCount);
+    }
+    Renderer::endMeshDraws();
+
+    RenderQueue::currentFrame.draws++;
+    RenderQueue::currentFrame.instances++;
+    RenderQueue::currentFrame.materialChanges++;
+    RenderQueue::currentFrame.shaderChanges++;
+    RenderQueue::currentFrame.stateChanges += 2;
+}
+
+std::uint64_t RenderQueue::getSortKey(RenderPass pass, const Shader* shader, const IMaterial* material, Renderer::MeshHandle mesh, float depth) {
+    // Positive floats sort the same way as their bits, the top 12 bits are the exponent and 3 bits of mantissa
+    const std::uint64_t depthBits = depth > 0.f ? std::bit_cast<std::uint32_t>(depth) >> 20 : 0;
+    const std::uint64_t meshBits = (static_cast<std::uint64_t>(mesh.vaoHandle) * 11400714819323198485ull) >> 52;
+    return (static_cast<std::uint64_t>(pass) << 60) |
+           (hashPointer(shader, 16) << 44) |
+           (hashPointer(material, 20) << 24) |
+           (meshBits << 12) |
+           depthBits;
+}
+
+bool RenderQueue::canBatch(const DrawPacket& lhs, const DrawPacket& rhs) {
+    return lhs.mesh.vaoHandle == rhs.mesh.vaoHandle &&
+           lhs.indexCount == rhs.indexCount &&
+           lhs.material == rhs.material &&
+           lhs.shader == rhs.shader &&
+           lhs.depthFunction == rhs.depthFunction &&
+           lhs.cullType == rhs.cullType;
+}
+
+void RenderQueue::endFrame() {
+    RenderQueue::lastFrame = RenderQueue::currentFrame;
+    RenderQueue::currentFrame = {};
+}
+
+RenderStatistics RenderQueue::getLastFrameStatistics() {
+    return RenderQueue::lastFrame;
+}
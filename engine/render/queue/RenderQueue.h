@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include <glm/glm.hpp>
+#include <math/Bounds.h>
+#include <render/backend/RenderBackend.h>
+
+namespace chira {
+
+class IMaterial;
+class Shader;
+
+/// Everything needed to draw a mesh, the material and shader must outlive the frame the packet is drawn in
+struct DrawPacket {
+    std::uint64_t sortKey = 0;
+    Renderer::MeshHandle mesh{};
+    std::size_t indexCount = 0;
+    IMaterial* material = nullptr;
+    Shader* shader = nullptr;
+    glm::mat4 model{1.f};
+    MeshDepthFunction depthFunction = MeshDepthFunction::LEQUAL;
+    MeshCullType cullType = MeshCullType::BACK;
+};
+
+struct RenderStatistics {
+    /// Draw calls, an instanced draw counts once
+    std::size_t draws = 0;
+    /// Meshes drawn, including every instance of an instanced draw
+    std::size_t instances = 0;
+    /// Meshes skipped because they were outside the frustum
+    std::size_t culled = 0;
+    std::size_t shaderChanges = 0;
+    std::size_t materialChanges = 0;
+    /// Depth function and cull type changes
+    std::size_t stateChanges = 0;
+};
+
+/// Collects the draws of a frame and sorts them by pass, shader, material and depth before drawing them,
+/// so state is only changed when it differs from the previous draw.
+/// Neighbouring draws of the same mesh and material with an instanced shader are drawn in a single call.
+/// Meshes rendered while a queue is active are submitted to it instead of being drawn immediately.
+class RenderQueue {
+public:
+    /// Makes this the active queue until execute() is called, queues can be nested.
+    /// The view position is used to sort draws front to back, nothing is culled if there's no frustum.
+    void begin(glm::vec3 viewPosition_, std::optional<Frustum> frustum_ = std::nullopt);
+    /// Returns true if the world space bounds are outside the frustum and shouldn't be submitted
+    [[nodiscard]] bool cull(const AABB& worldBounds);
+    void submit(RenderPass pass, DrawPacket packet);
+    void sort();
+    /// Sorts, draws and clears the queued packets, then reactivates the queue that was active before begin().
+    void execute();
+    [[nodiscard]] const std::vector<DrawPacket>& getPackets() const;
+
+    /// Returns nullptr if meshes should be drawn immediately
+    [[nodiscard]] static RenderQueue* getActive();
+    static void drawImmediately(const DrawPacket& packet);
+
+    /// Pass in the top 4 bits, then 16 bits for the shader, 20 for the material, 12 for the mesh and 12 for the depth
+    [[nodiscard]] static std::uint64_t getSortKey(RenderPass pass, const Shader* shader, const IMaterial* material, Renderer::MeshHandle mesh, float depth);
+    /// True if both packets can be drawn in the same instanced draw
+    [[nodiscard]] static bool canBatch(const DrawPacket& lhs, const DrawPacket& rhs);
+
+    /// Call once after everything in the frame has been drawn
+    static void endFrame();
+    [[nodiscard]] static RenderStatistics getLastFrameStatistics();
+private:
+    /// Returns one past the last packet that can be drawn together with the packet at begin
+    [[nodiscard]] std::size_t getBatchEnd(std::size_t begin) const;
+
+    std::vector<DrawPacket> packets;
+    /// Reused between batches to avoid allocating every frame
+    std::vector<glm::mat4> instanceTransforms;
+    glm::vec3 viewPosition{};
+    std::optional<Frustum> frustum;
+
+    static inline std::vector<RenderQueue*> activeQueues;
+    static inline RenderStatistics currentFrame;
+    static inline RenderStatistics lastFrame;
+};
+
+} // namespace chira
@@ -1,27 +1,53 @@
 #include "Shader.h"
 
-#include <regex>
+#include <shared_mutex>
+#include <unordered_map>
 #include <core/Logger.h>
 #include <i18n/TranslationManager.h>
 #include <resource/StringResource.h>
-#include <utility/String.h>
 #include "UBO.h"
 
 using namespace chira;
 
 CHIRA_CREATE_LOG(SHADER);
 
+/// Every uniform name any shader has used, shared so one UniformHandle works with every shader
+struct ShaderUniformRegistry {
+    struct NameHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view name) const {
+            return std::hash<std::string_view>{}(name);
+        }
+    };
+
+    std::shared_mutex mutex;
+    std::unordered_map<std::string, int, NameHash, std::equal_to<>> indices;
+};
+
+static ShaderUniformRegistry& getUniformRegistry() {
+    static ShaderUniformRegistry registry;
+    return registry;
+}
+
 Shader::Shader(std::string identifier_) : PropertiesResource(std::move(identifier_)) {}
 
 void Shader::compile(const nlohmann::json& properties) {
     Serialize::fromJSON(this, properties);
 
     const auto shaderModuleVertString = Resource::getUniqueUncachedResource<StringResource>(this->vertexPath);
-    const auto shaderModuleVertData = replaceMacros(shaderModuleVertString->getIdentifier().data(), shaderModuleVertString->getString());
+    const auto shaderModuleVertData = preprocess(shaderModuleVertString->getIdentifier(), shaderModuleVertString->getString());
     const auto shaderModuleFragString = Resource::getUniqueUncachedResource<StringResource>(this->fragmentPath);
-    const auto shaderModuleFragData = replaceMacros(shaderModuleFragString->getIdentifier().data(), shaderModuleFragString->getString());
+    const auto shaderModuleFragData = preprocess(shaderModuleFragString->getIdentifier(), shaderModuleFragString->getString());
     this->handle = Renderer::createShader(shaderModuleVertData, shaderModuleFragData);
 
+    this->uniformLocations.clear();
+    for (const auto& [name, location] : Renderer::getShaderUniforms(this->handle)) {
+        const auto index = static_cast<std::size_t>(Shader::getUniformIndex(name));
+        if (index >= this->uniformLocations.size())
+            this->uniformLocations.resize(index + 1, -1);
+        this->uniformLocations[index] = location;
+    }
+
     if (this->usesPV) {
         PerspectiveViewUBO::get().bindToShader(this->handle);
     }
@@ -30,6 +56,13 @@ void Shader::compile(const nlohmann::json& properties) {
     }
 }
 
+bool Shader::unloadForReload() {
+    Renderer::destroyShader(this->handle);
+    this->handle = {};
+    Shader::getPreprocessor().clearIncludeCache();
+    return true;
+}
+
 void Shader::use() const {
     Renderer::useShader(this->handle);
 }
@@ -39,45 +72,48 @@ Shader::~Shader() {
 }
 
 void Shader::addPreprocessorSymbol(const std::string& name, const std::string& value) {
-    if (!Shader::preprocessorSymbols.contains(name)) {
-        Shader::preprocessorSymbols.insert(std::pair<std::string, std::string>{name, value});
-    } else {
-        Shader::preprocessorSymbols[name] = value;
-    }
+    Shader::getPreprocessor().setSymbol(name, value);
 }
 
 void Shader::setPreprocessorPrefix(const std::string& prefix) {
-    Shader::preprocessorPrefix = prefix;
+    Shader::getPreprocessor().setPrefix(prefix);
 }
 
 void Shader::setPreprocessorSuffix(const std::string& suffix) {
-    Shader::preprocessorSuffix = suffix;
+    Shader::getPreprocessor().setSuffix(suffix);
 }
 
-std::string Shader::replaceMacros(const std::string& ignoredInclude, const std::string& data) { // NOLINT(misc-no-recursion)
-    // WARNING: The following code is HYPER SENSITIVE
-    // If you change ANYTHING it will BREAK HORRIBLY
-    // TEST ALL CHANGES
-
-    // Includes
-    static const std::regex includes{Shader::preprocessorPrefix + "(include[ \t]+([a-z:\\/.]+))" + Shader::preprocessorSuffix,
-                                     std::regex_constants::icase | std::regex_constants::optimize};
-    // Add the include as a macro to be expanded
-    // This has the positive side effect of caching previously used includes
-    for (std::sregex_iterator it{data.begin(), data.end(), includes}; it != std::sregex_iterator{}; it++) {
-        if (it->str(2) != ignoredInclude && !Shader::preprocessorSymbols.count(it->str(2))) {
-            auto contents = Resource::getUniqueUncachedResource<StringResource>(it->str(2));
-            Shader::addPreprocessorSymbol(it->str(1), replaceMacros(it->str(2), contents->getString()));
-        }
-    }
+int Shader::getUniformIndex(std::string_view name) {
+    auto& registry = getUniformRegistry();
+    if (int index = Shader::findUniformIndex(name); index >= 0)
+        return index;
+    std::unique_lock lock{registry.mutex};
+    return registry.indices.try_emplace(std::string{name}, static_cast<int>(registry.indices.size())).first->second;
+}
+
+int Shader::findUniformIndex(std::string_view name) {
+    auto& registry = getUniformRegistry();
+    std::shared_lock lock{registry.mutex};
+    if (auto index = registry.indices.find(name); index != registry.indices.end())
+        return index->second;
+    return -1;
+}
+
+ShaderPreprocessor& Shader::getPreprocessor() {
+    static ShaderPreprocessor preprocessor{[](const std::string& identifier) {
+        if (auto contents = Resource::getUniqueUncachedResource<StringResource>(identifier))
+            return contents->getString();
+        return std::string{};
+    }};
+    return preprocessor;
+}
 
-    // Macros
-    std::string out = data;
-    for (const auto& [macro, contents] : Shader::preprocessorSymbols) {
-        std::string fullKey = Shader::preprocessorPrefix;
-        fullKey += macro;
-        fullKey += Shader::preprocessorSuffix;
-        String::replace(out, fullKey, contents);
+std::string Shader::preprocess(std::string_view identifier, std::string_view data) {
+    std::vector<std::string> includes;
+    auto out = Shader::getPreprocessor().preprocess(data, identifier, &includes);
+    // Includes loaded just now were already recorded when they were read, cached ones were not
+    for (const auto& include : includes) {
+        Resource::addDependency(include);
     }
     return out;
 }
@@ -1,24 +1,52 @@
 #pragma once
 
+#include <cstddef>
+#include <type_traits>
+#include <vector>
 #include <glm/glm.hpp>
 #include <math/Types.h>
 #include <render/backend/RenderBackend.h>
 #include <resource/PropertiesResource.h>
+#include "ShaderPreprocessor.h"
 
 namespace chira {
 
-constexpr std::string_view SHADER_PREPROCESSOR_DEFAULT_PREFIX = "#";
-constexpr std::string_view SHADER_PREPROCESSOR_DEFAULT_SUFFIX = "#";
+/// Names a uniform in every shader at once, setting it through a handle is an array lookup instead of a driver call.
+/// Handles stay valid when shaders are reloaded, so they can be created once and kept around.
+template<ShaderUniformValueTypes T>
+struct UniformHandle {
+    int index = -1;
+
+    explicit inline operator bool() const { return index >= 0; }
+    inline bool operator!() const { return index < 0; }
+};
 
 class Shader : public PropertiesResource {
 public:
     explicit Shader(std::string identifier_);
     void compile(const nlohmann::json& properties) override;
+    /// Also forgets every cached include, one of them might be the file that changed.
+    bool unloadForReload() override;
     void use() const;
     ~Shader() override;
 
+    template<ShaderUniformValueTypes T>
+    [[nodiscard]] static UniformHandle<T> getUniform(std::string_view name) {
+        return {Shader::getUniformIndex(name)};
+    }
+
+    template<ShaderUniformValueTypes T>
+    inline void setUniform(UniformHandle<T> uniform, std::type_identity_t<T> value) {
+        // Uniforms this shader doesn't have are skipped, like GL does for location -1
+        if (static_cast<std::size_t>(uniform.index) < this->uniformLocations.size())
+            Renderer::setShaderUniform(this->handle, this->uniformLocations[uniform.index], value);
+    }
+
+    /// Prefer setting uniforms through a UniformHandle in code that runs every frame.
     inline void setUniform(std::string_view name, ShaderUniformValueTypes auto value) {
-        Renderer::setShaderUniform(this->handle, name, value);
+        const auto index = static_cast<std::size_t>(Shader::findUniformIndex(name));
+        if (index < this->uniformLocations.size())
+            Renderer::setShaderUniform(this->handle, this->uniformLocations[index], value);
     }
 
     [[nodiscard]] inline bool usesPVMatrices() const {
@@ -30,21 +58,30 @@ public:
     [[nodiscard]] inline bool isLit() const {
         return this->lit;
     }
+    /// Instanced shaders read the model matrix from a vertex attribute, so meshes sharing a material can be drawn together
+    [[nodiscard]] inline bool isInstanced() const {
+        return this->instanced;
+    }
 
     static void addPreprocessorSymbol(const std::string& name, const std::string& value);
     static void setPreprocessorPrefix(const std::string& prefix);
     static void setPreprocessorSuffix(const std::string& suffix);
 private:
-    static inline std::unordered_map<std::string, std::string> preprocessorSymbols;
-    static inline std::string preprocessorPrefix = std::string{SHADER_PREPROCESSOR_DEFAULT_PREFIX}; // NOLINT(cert-err58-cpp)
-    static inline std::string preprocessorSuffix = std::string{SHADER_PREPROCESSOR_DEFAULT_SUFFIX}; // NOLINT(cert-err58-cpp)
-
-    static std::string replaceMacros(const std::string&, const std::string&);
+    /// Registers the name if it hasn't been seen yet
+    static int getUniformIndex(std::string_view name);
+    /// Returns -1 if no shader has a uniform with this name
+    static int findUniformIndex(std::string_view name);
+    static ShaderPreprocessor& getPreprocessor();
+    /// Records every include as a dependency of the shader being compiled
+    static std::string preprocess(std::string_view identifier, std::string_view data);
 
     Renderer::ShaderHandle handle{};
+    /// Uniform locations in this shader, indexed by UniformHandle::index
+    std::vector<int> uniformLocations;
     bool usesPV = true;
     bool usesM = true;
     bool lit = true;
+    bool instanced = false;
     std::string vertexPath{"file://shaders/unlitTextured.vsh"};
     std::string fragmentPath{"file://shaders/unlitTextured.fsh"};
 public:
@@ -52,6 +89,7 @@ public:
             CHIRA_PROP(Shader, usesPV),
             CHIRA_PROP(Shader, usesM),
             CHIRA_PROP(Shader, lit),
+            CHIRA_PROP(Shader, instanced),
             CHIRA_PROP_NAMED(Shader, vertexPath, vertex),
             CHIRA_PROP_NAMED(Shader, fragmentPath, fragment)
     );
@@ -0,0 +1,163 @@
+#include "ShaderPreprocessor.h"
+
+#include <algorithm>
+#include <core/Logger.h>
+#include <i18n/TranslationManager.h>
+
+using namespace chira;
+
+CHIRA_GET_LOG(SHADER);
+
+[[nodiscard]] static constexpr bool isSpace(char c) {
+    return c == ' ' || c == '\t';
+}
+
+[[nodiscard]] static std::string_view trim(std::string_view str) {
+    while (!str.empty() && isSpace(str.front()))
+        str.remove_prefix(1);
+    while (!str.empty() && (isSpace(str.back()) || str.back() == '\r'))
+        str.remove_suffix(1);
+    return str;
+}
+
+/// Returns the argument if the body is the given directive followed by whitespace and an argument, or an empty view
+[[nodiscard]] static std::string_view getDirectiveArgument(std::string_view body, std::string_view directive) {
+    if (body.size() <= directive.size() || !body.starts_with(directive) || !isSpace(body[directive.size()]))
+        return {};
+    return trim(body.substr(directive.size()));
+}
+
+ShaderPreprocessor::ShaderPreprocessor(IncludeLoader loader_) : loader(std::move(loader_)) {}
+
+void ShaderPreprocessor::setSymbol(const std::string& name, const std::string& value) {
+    if (auto symbol = this->symbols.find(name); symbol != this->symbols.end()) {
+        if (symbol->second == value)
+            return;
+        symbol->second = value;
+    } else {
+        this->symbols.emplace(name, value);
+    }
+    this->clearIncludeCache();
+}
+
+bool ShaderPreprocessor::hasSymbol(std::string_view name) const {
+    return this->symbols.find(name) != this->symbols.end();
+}
+
+void ShaderPreprocessor::setPrefix(std::string_view prefix_) {
+    this->prefix = prefix_;
+    this->clearIncludeCache();
+}
+
+void ShaderPreprocessor::setSuffix(std::string_view suffix_) {
+    this->suffix = suffix_;
+    this->clearIncludeCache();
+}
+
+std::string ShaderPreprocessor::preprocess(std::string_view source, std::string_view identifier, std::vector<std::string>* includes) { // NOLINT(misc-no-recursion)
+    struct Conditional {
+        bool parentActive;
+        bool taken;
+        bool seenElse;
+    };
+    std::vector<Conditional> conditionals;
+    bool active = true;
+
+    std::string out;
+    out.reserve(source.size());
+    std::size_t copyFrom = 0;
+    std::size_t pos = 0;
+
+    while ((pos = source.find(this->prefix, pos)) != std::string_view::npos) {
+        const std::size_t found = pos;
+        // Tokens never span lines, which also keeps a stray prefix from scanning the rest of the file
+        std::size_t bodyEnd = found + this->prefix.size();
+        while (bodyEnd < source.size() && source[bodyEnd] != '\n' && !source.substr(bodyEnd).starts_with(this->suffix))
+            bodyEnd++;
+        if (bodyEnd >= source.size() || source[bodyEnd] == '\n' || this->suffix.empty()) {
+            pos = found + 1;
+            continue;
+        }
+        const auto body = source.substr(found + this->prefix.size(), bodyEnd - found - this->prefix.size());
+        const std::size_t tokenEnd = bodyEnd + this->suffix.size();
+
+        const auto flush = [&] {
+            if (active)
+                out.append(source.substr(copyFrom, found - copyFrom));
+            copyFrom = pos = tokenEnd;
+        };
+
+        if (auto name = getDirectiveArgument(body, "ifdef"); !name.empty()) {
+            flush();
+            const bool taken = this->hasSymbol(name);
+            conditionals.push_back({active, taken, false});
+            active = active && taken;
+        } else if (auto notName = getDirectiveArgument(body, "ifndef"); !notName.empty()) {
+            flush();
+            const bool taken = !this->hasSymbol(notName);
+            conditionals.push_back({active, taken, false});
+            active = active && taken;
+        } else if (trim(body) == "else") {
+            flush();
+            if (conditionals.empty() || conditionals.back().seenElse) {
+                LOG_SHADER.error(TRF("error.shader.unmatched_conditional", "else", identifier));
+                continue;
+            }
+            conditionals.back().seenElse = true;
+            active = conditionals.back().parentActive && !conditionals.back().taken;
+        } else if (trim(body) == "endif") {
+            flush();
+            if (conditionals.empty()) {
+                LOG_SHADER.error(TRF("error.shader.unmatched_conditional", "endif", identifier));
+                continue;
+            }
+            active = conditionals.back().parentActive;
+            conditionals.pop_back();
+        } else if (auto path = getDirectiveArgument(body, "include"); !path.empty()) {
+            flush();
+            if (!active)
+                continue;
+            const std::string pathString{path};
+            if (includes)
+                includes->push_back(pathString);
+            if (const auto* include = this->getInclude(pathString)) {
+                out.append(include->contents);
+                if (includes)
+                    includes->insert(includes->end(), include->includes.begin(), include->includes.end());
+            }
+        } else if (auto symbol = this->symbols.find(body); symbol != this->symbols.end()) {
+            flush();
+            if (active)
+                out.append(symbol->second);
+        } else {
+            // Not ours, copy it through and look for a directive starting inside it
+            pos = found + 1;
+        }
+    }
+    if (active)
+        out.append(source.substr(copyFrom));
+
+    if (!conditionals.empty())
+        LOG_SHADER.error(TRF("error.shader.unterminated_conditional", identifier));
+    return out;
+}
+
+void ShaderPreprocessor::clearIncludeCache() {
+    this->includeCache.clear();
+}
+
+const ShaderPreprocessor::CachedInclude* ShaderPreprocessor::getInclude(const std::string& identifier) { // NOLINT(misc-no-recursion)
+    if (auto cached = this->includeCache.find(identifier); cached != this->includeCache.end())
+        return &cached->second;
+    if (std::find(this->includeStack.begin(), this->includeStack.end(), identifier) != this->includeStack.end()) {
+        LOG_SHADER.error(TRF("error.shader.include_cycle", identifier));
+        return nullptr;
+    }
+
+    this->includeStack.push_back(identifier);
+    CachedInclude include;
+    include.contents = this->preprocess(this->loader(identifier), identifier, &include.includes);
+    this->includeStack.pop_back();
+    // Element pointers stay valid when an unordered_map rehashes
+    return &this->includeCache.insert_or_assign(identifier, std::move(include)).first->second;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace chira {
+
+constexpr std::string_view SHADER_PREPROCESSOR_DEFAULT_PREFIX = "#";
+constexpr std::string_view SHADER_PREPROCESSOR_DEFAULT_SUFFIX = "#";
+
+/// Expands engine directives in shader sources in a single pass, every directive is wrapped in the prefix and suffix:
+///   #NAME#              - replaced with the value of the symbol, left alone if the symbol is unknown
+///   #include PATH#      - replaced with the preprocessed contents of the resource at PATH
+///   #ifdef NAME#, #ifndef NAME#, #else#, #endif# - keep or drop text depending on whether a symbol is defined
+/// Anything that doesn't parse as a directive is copied through, so regular GLSL directives are unaffected.
+class ShaderPreprocessor {
+public:
+    /// Returns the raw contents of the include with the given identifier
+    using IncludeLoader = std::function<std::string(const std::string& identifier)>;
+
+    explicit ShaderPreprocessor(IncludeLoader loader);
+
+    /// Changing a symbol forgets cached includes, their contents might depend on it
+    void setSymbol(const std::string& name, const std::string& value);
+    [[nodiscard]] bool hasSymbol(std::string_view name) const;
+    void setPrefix(std::string_view prefix);
+    void setSuffix(std::string_view suffix);
+
+    /// Identifiers of every include reached, including ones already cached, are appended to includes if given.
+    [[nodiscard]] std::string preprocess(std::string_view source, std::string_view identifier, std::vector<std::string>* includes = nullptr);
+    void clearIncludeCache();
+private:
+    struct StringHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view str) const {
+            return std::hash<std::string_view>{}(str);
+        }
+    };
+    struct CachedInclude {
+        std::string contents;
+        /// Includes reached from this include, so dependencies can be recorded on a cache hit
+        std::vector<std::string> includes;
+    };
+
+    IncludeLoader loader;
+    std::unordered_map<std::string, std::string, StringHash, std::equal_to<>> symbols;
+    std::unordered_map<std::string, CachedInclude, StringHash, std::equal_to<>> includeCache;
+    /// Includes currently being expanded, used to catch cycles
+    std::vector<std::string> includeStack;
+    std::string prefix{SHADER_PREPROCESSOR_DEFAULT_PREFIX};
+    std::string suffix{SHADER_PREPROCESSOR_DEFAULT_SUFFIX};
+
+    const CachedInclude* getInclude(const std::string& identifier);
+};
+
+} // namespace chira
@@ -14,8 +14,18 @@ public:
 
     virtual void use() const = 0;
     virtual void use(TextureUnit activeTextureUnit) const = 0;
+    [[nodiscard]] std::size_t getGPUMemoryUsage() const override {
+        return this->gpuMemoryUsage;
+    }
 protected:
     Renderer::TextureHandle handle{};
+    std::size_t gpuMemoryUsage = 0;
+
+    /// Mipmaps take up to another third of the base image.
+    [[nodiscard]] static std::size_t getUploadedSize(const Image& image, bool mipmaps) {
+        std::size_t size = static_cast<std::size_t>(image.getWidth()) * image.getHeight() * image.getBitDepth();
+        return mipmaps ? size + size / 3 : size;
+    }
 };
 
 } // namespace chira
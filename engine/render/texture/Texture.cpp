@@ -19,15 +19,31 @@ Texture::~Texture() {
 void Texture::compile(const nlohmann::json& properties) {
     Serialize::fromJSON(this, properties);
 
-    auto imageFile = Resource::getResource<Image>(this->filePath, this->verticalFlip);
+    // Already decoded by prepareAsync() if the texture was loaded asynchronously
+    auto imageFile = this->file ? std::move(this->file) : Resource::getResource<Image>(this->filePath, this->verticalFlip);
 
     this->handle = Renderer::createTexture2D(*imageFile, this->wrapModeS, this->wrapModeT, this->filterMode,
                                              this->mipmaps, TextureUnit::G0);
+    this->gpuMemoryUsage = ITexture::getUploadedSize(*imageFile, this->mipmaps);
     if (this->cache) {
         this->file = imageFile;
     }
 }
 
+void Texture::prepareAsync(const nlohmann::json& properties) {
+    Serialize::fromJSON(this, properties);
+    this->file = Resource::getResource<Image>(this->filePath, this->verticalFlip);
+}
+
+bool Texture::unloadForReload() {
+    if (this->handle)
+        Renderer::destroyTexture(this->handle);
+    this->handle = {};
+    this->gpuMemoryUsage = 0;
+    this->file = SharedPointer<Image>{};
+    return true;
+}
+
 void Texture::use() const {
     Renderer::useTexture(this->handle, TextureUnit::G0);
 }
@@ -10,6 +10,9 @@ public:
     explicit Texture(std::string identifier_, bool cacheTexture = true);
     ~Texture() override;
     void compile(const nlohmann::json& properties) override;
+    /// Decodes the image, so compile() only has to upload it.
+    void prepareAsync(const nlohmann::json& properties) override;
+    bool unloadForReload() override;
     void use() const override;
     void use(TextureUnit activeTextureUnit) const override;
 protected:
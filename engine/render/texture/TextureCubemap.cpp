@@ -29,6 +29,17 @@ void TextureCubemap::compile(const nlohmann::json& properties) {
     this->handle = Renderer::createTextureCubemap(*fileRT, *fileLT, *fileUP, *fileDN, *fileFD, *fileBK,
                                                   this->wrapModeS, this->wrapModeT, this->wrapModeR, this->filterMode,
                                                   this->mipmaps, TextureUnit::G0);
+    this->gpuMemoryUsage = 0;
+    for (const auto* face : {&fileRT, &fileLT, &fileUP, &fileDN, &fileFD, &fileBK})
+        this->gpuMemoryUsage += ITexture::getUploadedSize(**face, this->mipmaps);
+}
+
+bool TextureCubemap::unloadForReload() {
+    if (this->handle)
+        Renderer::destroyTexture(this->handle);
+    this->handle = {};
+    this->gpuMemoryUsage = 0;
+    return true;
 }
 
 void TextureCubemap::use() const {
@@ -10,6 +10,7 @@ public:
     explicit TextureCubemap(std::string identifier_);
     ~TextureCubemap() override;
     void compile(const nlohmann::json& properties) override;
+    bool unloadForReload() override;
     void use() const override;
     void use(TextureUnit activeTextureUnit) const override;
 protected:
@@ -10,11 +10,32 @@ void BinaryResource::compile(const byte buffer[], std::size_t bufferLength) {
     std::memcpy(this->buffer_, buffer, this->bufferLength_);
 }
 
+void BinaryResource::compileMapped(const std::shared_ptr<const MappedFile>& file) {
+    this->bufferLength_ = file->getSize();
+    if (file->isPersistent()) {
+        this->mappedFile = file;
+        return;
+    }
+    // The file might be overwritten later, only read from the mapping while compiling
+    this->buffer_ = new byte[this->bufferLength_];
+    std::memcpy(this->buffer_, file->getData(), this->bufferLength_);
+}
+
+bool BinaryResource::unloadForReload() {
+    delete[] this->buffer_;
+    this->buffer_ = nullptr;
+    this->bufferLength_ = 0;
+    this->mappedFile.reset();
+    return true;
+}
+
 BinaryResource::~BinaryResource() {
     delete[] this->buffer_;
 }
 
 const byte* BinaryResource::getBuffer() const {
+    if (this->mappedFile)
+        return this->mappedFile->getData();
     return this->buffer_;
 }
 
@@ -8,12 +8,23 @@ class BinaryResource : public Resource {
 public:
     explicit BinaryResource(std::string identifier_) : Resource(std::move(identifier_)) {}
     void compile(const byte buffer[], std::size_t bufferLength) override;
+    /// Keeps the mapping alive instead of copying it, if the file is persistent.
+    void compileMapped(const std::shared_ptr<const MappedFile>& file) override;
+    [[nodiscard]] bool canCompileAsync() const override {
+        return true;
+    }
+    bool unloadForReload() override;
+    /// Mapped pages are clean, the OS can drop them and read them again, so they aren't counted.
+    [[nodiscard]] std::size_t getCPUMemoryUsage() const override {
+        return Resource::getCPUMemoryUsage() + (this->mappedFile ? 0 : this->bufferLength_);
+    }
     ~BinaryResource() override;
     [[nodiscard]] const byte* getBuffer() const;
     [[nodiscard]] std::size_t getBufferLength() const;
 protected:
     byte* buffer_ = nullptr;
     std::size_t bufferLength_ = 0;
+    std::shared_ptr<const MappedFile> mappedFile;
 };
 
 } // namespace chira
@@ -8,11 +8,26 @@ using namespace chira;
 CHIRA_CREATE_LOG(PROPERTIESRESOURCE);
 
 void PropertiesResource::compile(const byte buffer[], std::size_t bufferLength) {
+    if (this->preparedProperties) {
+        auto props = std::move(*this->preparedProperties);
+        this->preparedProperties.reset();
+        this->compile(props);
+        return;
+    }
+    this->compile(this->parseProperties(buffer, bufferLength));
+}
+
+void PropertiesResource::prepareAsync(const byte buffer[], std::size_t bufferLength) {
+    this->preparedProperties = this->parseProperties(buffer, bufferLength);
+    this->prepareAsync(*this->preparedProperties);
+}
+
+nlohmann::json PropertiesResource::parseProperties(const byte buffer[], std::size_t bufferLength) const {
     nlohmann::json props;
     try {
         props = nlohmann::json::parse(std::string{reinterpret_cast<const char*>(buffer), bufferLength});
     } catch (const nlohmann::json::exception&) {
         LOG_PROPERTIESRESOURCE.error(TRF("error.properties_resource.invalid_json", this->identifier));
     }
-    this->compile(props);
+    return props;
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <optional>
 #include "Properties.h"
 #include "Resource.h"
 
@@ -10,6 +11,10 @@ public:
     explicit PropertiesResource(std::string identifier_) : Resource(std::move(identifier_)) {}
     void compile(const byte buffer[], std::size_t bufferLength) final;
     virtual void compile(const nlohmann::json& properties) = 0;
+    /// Parses the properties on the resource loader thread, so compile() doesn't have to parse them again.
+    void prepareAsync(const byte buffer[], std::size_t bufferLength) final;
+    /// Called on a resource loader thread before compile() when loading asynchronously, see Resource::prepareAsync().
+    virtual void prepareAsync(const nlohmann::json& /*properties*/) {}
 
     template<typename T>
     [[nodiscard]] static inline T getProperty(const nlohmann::json& properties, const std::string& key, T defaultValue) {
@@ -18,6 +23,10 @@ public:
         }
         return defaultValue;
     }
+private:
+    std::optional<nlohmann::json> preparedProperties;
+
+    [[nodiscard]] nlohmann::json parseProperties(const byte buffer[], std::size_t bufferLength) const;
 };
 
 } // namespace chira
@@ -1,5 +1,7 @@
 #include "Resource.h"
 
+#include <cstring>
+#include <config/ConEntry.h>
 #include <core/Logger.h>
 #include <i18n/TranslationManager.h>
 
@@ -7,8 +9,26 @@ using namespace chira;
 
 CHIRA_CREATE_LOG(RESOURCE);
 
+[[maybe_unused]]
+ConVar resource_hot_reload{"resource_hot_reload", true, "Reload cached resources when their files change on disk."}; // NOLINT(cert-err58-cpp)
+
+[[maybe_unused]]
+ConVar resource_cache_budget{"resource_cache_budget", 256, "Megabytes of unused resources to keep loaded in case they're needed again.", CON_FLAG_NONE, [](ConVar::CallbackArg newValue) { // NOLINT(cert-err58-cpp)
+    Resource::setUnusedResourceBudget(static_cast<std::size_t>(std::max(std::stoi(newValue.data()), 0)) * 1024 * 1024);
+}};
+
 Resource::~Resource() {
-    Resource::removeResource(this->identifier);
+    // Cached resources are normally deleted after they leave the cache, but one that was cached without
+    // going through cacheLoadingResource() can be deleted while the cache still points to it
+    // Resources that were never cached (or lost a race to be cached) must not remove the cached copy
+    Resource::resources.erase(ResourceKey{this->identifier}, this);
+}
+
+void Resource::compileMapped(const std::shared_ptr<const MappedFile>& file) {
+    std::vector<byte> buffer(file->getSize() + 1);
+    std::memcpy(buffer.data(), file->getData(), file->getSize());
+    buffer[file->getSize()] = '\0';
+    this->compile(buffer.data(), buffer.size());
 }
 
 //
@@ -16,25 +36,34 @@ Resource::~Resource() {
 //
 
 void Resource::addResourceProvider(IResourceProvider* provider) {
-    std::string providerName{provider->getName().data()};
-    if (Resource::providers.find(providerName) == Resource::providers.end()) {
-        Resource::providers[providerName] = std::vector<std::unique_ptr<IResourceProvider>>{};
-    }
-    Resource::providers[providerName].emplace_back(provider);
+    std::unique_lock lock{Resource::providersMutex};
+    Resource::providers[std::string{provider->getName()}].emplace_back(provider);
 }
 
 IResourceProvider* Resource::getLatestResourceProvider(const std::string& provider) {
-    return Resource::providers[provider][Resource::providers[provider].size() - 1].get();
+    std::shared_lock lock{Resource::providersMutex};
+    if (auto providers = Resource::providers.find(provider); providers != Resource::providers.end() && !providers->second.empty())
+        return providers->second.back().get();
+    return nullptr;
 }
 
 IResourceProvider* Resource::getResourceProviderWithResource(const std::string& identifier) {
-    auto id = Resource::splitResourceIdentifier(identifier);
-    const std::string& provider = id.first, name = id.second;
-    for (auto i = Resource::providers[provider].rbegin(); i < Resource::providers[provider].rend(); i++) {
-        if (i->get()->hasResource(name))
+    auto [provider, name] = Resource::splitResourceIdentifierView(identifier);
+    if (auto* resourceProvider = Resource::findResourceProvider(provider, name))
+        return resourceProvider;
+    LOG_RESOURCE.error(TRF("error.resource.resource_not_found", identifier));
+    return nullptr;
+}
+
+IResourceProvider* Resource::findResourceProvider(std::string_view provider, std::string_view name) {
+    std::shared_lock lock{Resource::providersMutex};
+    auto providers = Resource::providers.find(provider);
+    if (providers == Resource::providers.end())
+        return nullptr;
+    for (auto i = providers->second.rbegin(); i != providers->second.rend(); i++) {
+        if ((*i)->hasResource(name))
             return i->get();
     }
-    LOG_RESOURCE.error(TRF("error.resource.resource_not_found", identifier));
     return nullptr;
 }
 
@@ -50,50 +79,333 @@ std::pair<std::string, std::string> Resource::splitResourceIdentifier(const std:
     return out;
 }
 
+std::pair<std::string_view, std::string_view> Resource::splitResourceIdentifierView(std::string_view identifier) {
+    size_t pos = identifier.find(RESOURCE_ID_SEPARATOR);
+    if (pos == std::string_view::npos) {
+        LOG_RESOURCE.error(TRF("error.resource.cannot_split_identifier", identifier));
+        return {};
+    }
+    return {identifier.substr(0, pos), identifier.substr(pos + RESOURCE_ID_SEPARATOR.length())};
+}
+
 const std::vector<std::unique_ptr<IResourceProvider>>& Resource::getResourceProviders(const std::string& providerName) {
+    std::shared_lock lock{Resource::providersMutex};
     return Resource::providers.at(providerName);
 }
 
 bool Resource::hasResource(const std::string& identifier) {
-    auto id = Resource::splitResourceIdentifier(identifier);
-    const std::string& provider = id.first, name = id.second;
-    for (auto i = Resource::providers[provider].rbegin(); i != Resource::providers[provider].rend(); i++) {
-        if (i->get()->hasResource(name))
-            return true;
-    }
-    return false;
+    auto [provider, name] = Resource::splitResourceIdentifierView(identifier);
+    return Resource::findResourceProvider(provider, name) != nullptr;
 }
 
 void Resource::removeResource(const std::string& identifier) {
-    auto id = Resource::splitResourceIdentifier(identifier);
-    const std::string& provider = id.first, name = id.second;
     // If the count is 2, then it's being held by the resource manager and the object requesting its removal.
     // Anything below 2 means it should be already deleted everywhere except the resource manager.
-    if (Resource::resources[provider].count(name) > 0 && Resource::resources[provider][name].useCount() <= 2)
-        Resource::garbageResources.push_back(identifier);
+    // The unused resource list doesn't hold a handle, so it doesn't matter if the resource is in it.
+    auto resource = Resource::resources.get(ResourceKey{identifier});
+    // Counting the handle we just took
+    if (resource && resource.useCount() <= 3) {
+        std::scoped_lock lock{Resource::garbageResourcesMutex};
+        Resource::garbageResources.push_back(std::move(resource));
+    }
 }
 
 void Resource::cleanup() {
-    for (const auto& name : Resource::garbageResources) {
-        auto id = Resource::splitResourceIdentifier(name);
-        Resource::resources[id.first].erase(id.second);
+    std::vector<SharedPointer<Resource>> garbage;
+    {
+        std::scoped_lock lock{Resource::garbageResourcesMutex};
+        if (!Resource::garbageResources.empty())
+            std::swap(garbage, Resource::garbageResources);
+    }
+    for (const auto& resource : garbage) {
+        // It might have been replaced in the cache since it was marked
+        if (Resource::resources.erase(ResourceKey{resource->getIdentifier()}, resource.get()))
+            Resource::clearDependencies(std::string{resource->getIdentifier()});
+    }
+    // Dropping the handles deletes anything nobody else is holding
+    garbage.clear();
+    if (auto budget = Resource::unusedResourceBudget.load(std::memory_order_relaxed); Resource::resources.getUnusedSize() > budget) {
+        Resource::evictUnusedResources(budget);
     }
-    Resource::garbageResources.clear();
+}
+
+Resource::CacheStatistics Resource::getCacheStatistics() {
+    return {
+        .hits = Resource::cacheHits.load(std::memory_order_relaxed),
+        .misses = Resource::cacheMisses.load(std::memory_order_relaxed),
+        .evictions = Resource::cacheEvictions.load(std::memory_order_relaxed),
+        .unusedResources = Resource::resources.getUnusedCount(),
+        .unusedBytes = Resource::resources.getUnusedSize(),
+        .budgetBytes = Resource::unusedResourceBudget.load(std::memory_order_relaxed),
+    };
+}
+
+void Resource::setUnusedResourceBudget(std::size_t bytes) {
+    Resource::unusedResourceBudget.store(bytes, std::memory_order_relaxed);
+}
+
+void Resource::evictUnusedResources(std::size_t budget) {
+    // Deleting a resource can make the resources it held unused, so go until nothing new shows up
+    while (Resource::resources.getUnusedSize() > budget) {
+        SharedPointer<Resource> evicted;
+        if (!Resource::resources.popUnused(evicted))
+            break;
+        if (evicted) {
+            Resource::clearDependencies(std::string{evicted->getIdentifier()});
+            Resource::cacheEvictions.fetch_add(1, std::memory_order_relaxed);
+        }
+        // Dropping the handle deletes the resource, which can call back into onResourceUnused()
+    }
+}
+
+std::pair<SharedPointer<Resource>, bool> Resource::cacheLoadingResource(const ResourceKey& key, SharedPointer<Resource>&& resource, bool replace) {
+    resource.setLastHolderCallback(&Resource::onResourceUnused, resource.get());
+    return Resource::resources.insertLoading(key, std::move(resource), replace);
+}
+
+bool Resource::onResourceUnused(void* resource, SharedPointerMetadata* /*data*/) {
+    auto* unused = static_cast<Resource*>(resource);
+    // The cache's handle keeps it alive until it's evicted. If it's picked up again before the registry
+    // gets to it, this is called again when that handle is dropped
+    Resource::resources.markUnused(ResourceKey{unused->getIdentifier()}, unused, unused->getCPUMemoryUsage() + unused->getGPUMemoryUsage());
+    return true;
+}
+
+void Resource::processAsyncLoads() {
+    std::vector<std::shared_ptr<AsyncLoad>> finished;
+    {
+        std::scoped_lock lock{Resource::finishedAsyncLoadsMutex};
+        std::swap(finished, Resource::finishedAsyncLoads);
+    }
+    for (const auto& load : finished) {
+        Resource::pendingAsyncResources.erase(load->identifier);
+        if (!load->error.empty()) {
+            LOG_RESOURCE.error(TRF("error.resource.async_load_failed", load->identifier, load->error));
+        }
+        if (!load->found || !load->error.empty()) {
+            if (!load->found) {
+                Resource::logResourceError("error.resource.resource_not_found", load->identifier);
+            }
+            // Make sure the resource is deleted here, the loader thread might still hold a reference to the load
+            load->resource.reset();
+            load->onLoaded(SharedPointer<Resource>{});
+            continue;
+        }
+        if (!load->compiled) {
+            CompileScope scope{load->resource.get()};
+            load->resource->compile(load->buffer.data(), load->buffer.size());
+            load->buffer.clear();
+        }
+
+        // If it was loaded synchronously while we were busy, prefer the copy that's already out there
+        const ResourceKey key{load->identifier};
+        auto [resource, loading] = Resource::cacheLoadingResource(key, SharedPointer<Resource>(load->resource.release()), false);
+        if (loading) {
+            Resource::resources.finishLoading(key, resource.get());
+        }
+        load->onLoaded(resource);
+        Events::createEvent("chira::resource::loaded", load->identifier);
+    }
+}
+
+void Resource::queueAsyncLoad(const std::string& identifier, Resource* resource, std::function<void(const SharedPointer<Resource>&)> onLoaded) {
+    auto [providerName, name] = Resource::splitResourceIdentifierView(identifier);
+    auto load = std::make_shared<AsyncLoad>();
+    load->identifier = identifier;
+    load->name = name;
+    load->resource.reset(resource);
+    load->onLoaded = std::move(onLoaded);
+    // Providers are only removed in discardAll(), so a snapshot is safe to use until then
+    {
+        std::shared_lock lock{Resource::providersMutex};
+        if (auto providers = Resource::providers.find(providerName); providers != Resource::providers.end()) {
+            for (const auto& provider : providers->second) {
+                load->providers.push_back(provider.get());
+            }
+        }
+    }
+
+    if (!Resource::loaderPool) {
+        Resource::loaderPool = std::make_unique<ThreadPool>();
+    }
+    Resource::loaderPool->push([load] {
+        Resource::onLoaderThread = true;
+        try {
+            for (auto i = load->providers.rbegin(); i != load->providers.rend(); i++) {
+                if (!(*i)->hasResource(load->name))
+                    continue;
+                if (load->resource->canCompileAsync()) {
+                    Resource::compileFromProvider(*i, load->name, load->resource.get());
+                    load->compiled = true;
+                } else {
+                    load->buffer = (*i)->readResource(load->name);
+                    CompileScope scope{load->resource.get()};
+                    load->resource->prepareAsync(load->buffer.data(), load->buffer.size());
+                }
+                load->found = true;
+                break;
+            }
+        } catch (const std::exception& e) {
+            load->error = e.what();
+        }
+        std::scoped_lock lock{Resource::finishedAsyncLoadsMutex};
+        Resource::finishedAsyncLoads.push_back(load);
+    });
+}
+
+void Resource::addDependency(const std::string& identifier) {
+    if (Resource::compilingResources.empty())
+        return;
+    const std::string& dependent = *Resource::compilingResources.back();
+    if (dependent == identifier)
+        return;
+    std::scoped_lock lock{Resource::dependenciesMutex};
+    Resource::dependencies[dependent].insert(identifier);
+    Resource::dependents[identifier].insert(dependent);
+}
+
+std::vector<std::string> Resource::getDependents(const std::string& identifier) {
+    std::scoped_lock lock{Resource::dependenciesMutex};
+    std::vector<std::string> out;
+    std::unordered_set<std::string> visited{identifier};
+    std::vector<const std::string*> toVisit{&identifier};
+    while (!toVisit.empty()) {
+        auto edges = Resource::dependents.find(*toVisit.back());
+        toVisit.pop_back();
+        if (edges == Resource::dependents.end())
+            continue;
+        for (const auto& dependent : edges->second) {
+            if (visited.insert(dependent).second) {
+                out.push_back(dependent);
+                toVisit.push_back(&dependent);
+            }
+        }
+    }
+    return out;
+}
+
+void Resource::markChanged(const std::string& identifier) {
+    std::scoped_lock lock{Resource::changedResourcesMutex};
+    Resource::changedResources.insert(identifier);
+}
+
+void Resource::processReloads() {
+    std::unordered_set<std::string> changed;
+    {
+        std::scoped_lock lock{Resource::changedResourcesMutex};
+        if (Resource::changedResources.empty())
+            return;
+        std::swap(changed, Resource::changedResources);
+    }
+    if (!resource_hot_reload.getValue<bool>())
+        return;
+
+    std::unordered_set<std::string> affected = changed;
+    for (const auto& identifier : changed) {
+        for (auto& dependent : Resource::getDependents(identifier)) {
+            affected.insert(std::move(dependent));
+        }
+    }
+
+    // Depth-first over the dependencies, so every resource is reloaded after the ones it loads
+    std::vector<std::string> order;
+    {
+        std::scoped_lock lock{Resource::dependenciesMutex};
+        std::unordered_set<std::string> visited;
+        std::function<void(const std::string&)> visit = [&](const std::string& identifier) {
+            if (!visited.insert(identifier).second)
+                return;
+            if (auto edges = Resource::dependencies.find(identifier); edges != Resource::dependencies.end()) {
+                for (const auto& dependency : edges->second) {
+                    if (affected.contains(dependency))
+                        visit(dependency);
+                }
+            }
+            order.push_back(identifier);
+        };
+        for (const auto& identifier : affected) {
+            visit(identifier);
+        }
+    }
+
+    for (const auto& identifier : order) {
+        Resource::reloadResource(identifier);
+    }
+}
+
+void Resource::clearDependencies(const std::string& identifier) {
+    std::scoped_lock lock{Resource::dependenciesMutex};
+    auto edges = Resource::dependencies.find(identifier);
+    if (edges == Resource::dependencies.end())
+        return;
+    for (const auto& dependency : edges->second) {
+        if (auto reverse = Resource::dependents.find(dependency); reverse != Resource::dependents.end()) {
+            reverse->second.erase(identifier);
+            if (reverse->second.empty())
+                Resource::dependents.erase(reverse);
+        }
+    }
+    Resource::dependencies.erase(edges);
+}
+
+void Resource::reloadResource(const std::string& identifier) {
+    // Only cached resources can be swapped in place, anything else (like shader sources) is just a dependency
+    // Don't take a handle here: if the registry is the only holder, dropping it would delete the resource
+    auto* resource = Resource::resources.getUnowned(ResourceKey{identifier});
+    if (!resource)
+        return;
+
+    auto [provider, name] = Resource::splitResourceIdentifierView(identifier);
+    auto* resourceProvider = Resource::findResourceProvider(provider, name);
+    if (!resourceProvider) {
+        Resource::logResourceError("error.resource.resource_not_found", identifier);
+        return;
+    }
+    if (!resource->unloadForReload()) {
+        LOG_RESOURCE.warning(TRF("warn.resource.cannot_reload", identifier));
+        return;
+    }
+    // Dependencies are recorded again while compiling, they might have changed
+    Resource::clearDependencies(identifier);
+    try {
+        Resource::compileFromProvider(resourceProvider, name, resource);
+    } catch (const std::exception& e) {
+        LOG_RESOURCE.error(TRF("error.resource.reload_failed", identifier, e.what()));
+        return;
+    }
+    LOG_RESOURCE.info(TRF("debug.resource.reloaded", identifier));
+    Events::createEvent("chira::resource::reloaded", identifier);
 }
 
 void Resource::discardAll() {
+    // Wait for the loader threads to finish, then throw away anything that hasn't been picked up yet
+    Resource::loaderPool.reset();
+    for (const auto& load : Resource::finishedAsyncLoads) {
+        load->resource.reset();
+    }
+    Resource::finishedAsyncLoads.clear();
+    Resource::pendingAsyncResources.clear();
+
     Resource::defaultResources.clear();
     Resource::cleanup();
-    for (const auto& [providerName, resourceMap] : Resource::resources) {
-        for (const auto& [name, resource] : resourceMap) {
-            // This really shouldn't happen, but it should work out if it does, hence the warning
-            LOG_RESOURCE.warning() << TRF("warn.resource.deleting_resource_at_exit",
-                                          Resource::resources[providerName].at(name)->getIdentifier(),
-                                          Resource::resources[providerName].at(name).useCount());
-        }
-    }
+    Resource::evictUnusedResources(0);
+    Resource::resources.forEach([](std::string_view identifier, const SharedPointer<Resource>& resource) {
+        // This really shouldn't happen, but it should work out if it does, hence the warning
+        LOG_RESOURCE.warning() << TRF("warn.resource.deleting_resource_at_exit", identifier, resource.useCount());
+    });
     Resource::resources.clear();
-    Resource::providers.clear();
+    {
+        std::unique_lock lock{Resource::providersMutex};
+        Resource::providers.clear();
+    }
+
+    {
+        std::scoped_lock lock{Resource::dependenciesMutex};
+        Resource::dependencies.clear();
+        Resource::dependents.clear();
+    }
+    std::scoped_lock lock{Resource::changedResourcesMutex};
+    Resource::changedResources.clear();
 }
 
 void Resource::logResourceError(const std::string& identifier, const std::string& resourceName) {
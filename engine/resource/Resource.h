@@ -1,16 +1,28 @@
 #pragma once
 
+#include <any>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <nlohmann/json.hpp>
+#include <core/Assertions.h>
 #include <core/Logger.h>
+#include <core/ThreadPool.h>
 #include <event/Events.h>
 #include <math/Types.h>
+#include <utility/MappedFile.h>
 #include <utility/SharedPointer.h>
 #include <utility/Types.h>
 #include "provider/IResourceProvider.h"
+#include "ResourceRegistry.h"
 
 namespace chira {
 
@@ -24,6 +36,33 @@ public:
     explicit Resource(std::string identifier_) : identifier(std::move(identifier_)) {}
     virtual ~Resource();
     virtual void compile(const byte /*buffer*/[], std::size_t /*bufferLength*/) {}
+    /// Called instead of compile() when the provider mapped the resource into memory.
+    /// By default the mapping is copied into a null-terminated buffer for compile(), but resources
+    /// that don't need the null terminator can read from the mapping directly, or even keep it.
+    virtual void compileMapped(const std::shared_ptr<const MappedFile>& file);
+    /// Return true if compile() only touches this resource, so it can be run on a resource loader thread.
+    /// Anything that uses the renderer or loads other resources must compile on the main thread.
+    [[nodiscard]] virtual bool canCompileAsync() const {
+        return false;
+    }
+    /// Called on a resource loader thread before compile() runs on the main thread, for resources that can't compile asynchronously.
+    /// Load other resources and decode data here, so compile() only has to hand the results to the renderer.
+    /// Only resources that can compile asynchronously can be loaded here. If another thread is loading the same one, this waits for it.
+    virtual void prepareAsync(const byte /*buffer*/[], std::size_t /*bufferLength*/) {}
+    /// Called before the hot reloader compiles the resource again in place, because its file or one of
+    /// its dependencies changed. Free anything compile() allocated, then compile() runs on this same object.
+    /// Return false if the resource can't be rebuilt at runtime.
+    virtual bool unloadForReload() {
+        return true;
+    }
+    /// Approximate bytes of system memory held by this resource, used to budget the unused resource cache.
+    [[nodiscard]] virtual std::size_t getCPUMemoryUsage() const {
+        return sizeof(Resource) + this->identifier.capacity();
+    }
+    /// Approximate bytes of video memory held by this resource, used to budget the unused resource cache.
+    [[nodiscard]] virtual std::size_t getGPUMemoryUsage() const {
+        return 0;
+    }
     [[nodiscard]] std::string_view getIdentifier() const {
         return this->identifier;
     }
@@ -42,41 +81,29 @@ public:
 
     template<typename ResourceType, typename... Params>
     static SharedPointer<ResourceType> getResource(const std::string& identifier, Params... params) {
-        Resource::cleanup();
-        auto id = Resource::splitResourceIdentifier(identifier);
-        const std::string& provider = id.first, name = id.second;
-        if (Resource::resources[provider].count(name) > 0) {
-            return Resource::resources[provider][name].castAssert<ResourceType>();
+        Resource::addDependency(identifier);
+        if (auto resource = Resource::resources.get(ResourceKey{identifier})) {
+            Resource::cacheHits.fetch_add(1, std::memory_order_relaxed);
+            return resource.castAssert<ResourceType>();
         }
-        return Resource::getUniqueResource<ResourceType>(identifier, std::forward<Params>(params)...);
+        Resource::cacheMisses.fetch_add(1, std::memory_order_relaxed);
+        return Resource::loadResource<ResourceType>(identifier, false, std::forward<Params>(params)...);
     }
 
     template<typename ResourceType, typename... Params>
     static void precacheResource(const std::string& identifier, Params... params) {
-        Resource::cleanup();
-        auto id = Resource::splitResourceIdentifier(identifier);
-        const std::string& provider = id.first, name = id.second;
-        if (Resource::resources[provider].count(name) > 0) {
-            return; // Already in cache
-        }
-
-        for (auto i = Resource::providers[provider].rbegin(); i != Resource::providers[provider].rend(); i++) {
-            if ((*i)->hasResource(name)) {
-                Resource::resources[provider][name] = SharedPointer<Resource>(new ResourceType{identifier, std::forward<Params>(params)...});
-                (*i)->compileResource(name, Resource::resources[provider][name].get());
-                return; // Precached!
-            }
+        Resource::addDependency(identifier);
+        if (Resource::resources.contains(ResourceKey{identifier})) {
+            return; // Already in cache, or being loaded
         }
-        Resource::logResourceError("error.resource.resource_not_found", identifier);
+        Resource::loadResource<ResourceType>(identifier, false, std::forward<Params>(params)...);
     }
 
     template<typename ResourceType>
     static SharedPointer<ResourceType> getCachedResource(const std::string& identifier) {
-        Resource::cleanup();
-        auto id = Resource::splitResourceIdentifier(identifier);
-        const std::string& provider = id.first, name = id.second;
-        if (Resource::resources[provider].count(name) > 0) {
-            return Resource::resources[provider][name].castAssert<ResourceType>();
+        Resource::addDependency(identifier);
+        if (auto resource = Resource::resources.get(ResourceKey{identifier})) {
+            return resource.castAssert<ResourceType>();
         }
         Resource::logResourceError("error.resource.cached_resource_not_found", identifier);
         if (Resource::hasDefaultResource<ResourceType>())
@@ -84,34 +111,52 @@ public:
         return SharedPointer<ResourceType>{};
     }
 
+    /// Loads the resource again even if it's cached, and replaces the cached copy once it's compiled.
     template<typename ResourceType, typename... Params>
     static SharedPointer<ResourceType> getUniqueResource(const std::string& identifier, Params... params) {
-        auto id = Resource::splitResourceIdentifier(identifier);
-        const std::string& provider = id.first, name = id.second;
-        for (auto i = Resource::providers[provider].rbegin(); i != Resource::providers[provider].rend(); i++) {
-            if ((*i)->hasResource(name)) {
-                Resource::resources[provider][name] = SharedPointer<Resource>(new ResourceType{identifier, std::forward<Params>(params)...});
-                (*i)->compileResource(name, Resource::resources[provider][name].get());
-                return Resource::resources[provider][name].castAssert<ResourceType>();
-            }
+        Resource::addDependency(identifier);
+        return Resource::loadResource<ResourceType>(identifier, true, std::forward<Params>(params)...);
+    }
+
+    /// Loads the resource on a resource loader thread. The future is fulfilled on the main thread in
+    /// processAsyncLoads(), right before the "chira::resource::loaded" event is fired with the identifier.
+    /// If the resource is already cached (or already loading) no new load is started.
+    template<typename ResourceType, typename... Params>
+    static std::shared_future<SharedPointer<ResourceType>> getResourceAsync(const std::string& identifier, Params... params) {
+        Resource::addDependency(identifier);
+        if (auto resource = Resource::resources.get(ResourceKey{identifier})) {
+            Resource::cacheHits.fetch_add(1, std::memory_order_relaxed);
+            std::promise<SharedPointer<ResourceType>> cached;
+            cached.set_value(resource.castAssert<ResourceType>());
+            return cached.get_future().share();
         }
-        Resource::logResourceError("error.resource.resource_not_found", identifier);
-        if (Resource::hasDefaultResource<ResourceType>())
-            return Resource::getDefaultResource<ResourceType>();
-        return SharedPointer<ResourceType>{};
+        if (auto pending = Resource::pendingAsyncResources.find(identifier); pending != Resource::pendingAsyncResources.end()) {
+            if (auto* future = std::any_cast<std::shared_future<SharedPointer<ResourceType>>>(&pending->second))
+                return *future;
+        }
+
+        Resource::cacheMisses.fetch_add(1, std::memory_order_relaxed);
+        auto promise = std::make_shared<std::promise<SharedPointer<ResourceType>>>();
+        auto future = promise->get_future().share();
+        Resource::pendingAsyncResources[identifier] = future;
+        Resource::queueAsyncLoad(identifier, new ResourceType{identifier, std::forward<Params>(params)...}, [promise](const SharedPointer<Resource>& resource) {
+            if (!resource && Resource::hasDefaultResource<ResourceType>())
+                promise->set_value(Resource::getDefaultResource<ResourceType>());
+            else
+                promise->set_value(resource.template castAssert<ResourceType>());
+        });
+        return future;
     }
 
     /// You might want to use this sparingly as it defeats the entire point of a cached, shared resource system.
     template<typename ResourceType, typename... Params>
     static std::unique_ptr<ResourceType> getUniqueUncachedResource(const std::string& identifier, Params... params) {
-        auto id = Resource::splitResourceIdentifier(identifier);
-        const std::string& provider = id.first, name = id.second;
-        for (auto i = Resource::providers[provider].rbegin(); i != Resource::providers[provider].rend(); i++) {
-            if ((*i)->hasResource(name)) {
-                auto resource = std::make_unique<ResourceType>(identifier, std::forward<Params>(params)...);
-                (*i)->compileResource(name, resource.get());
-                return resource;
-            }
+        Resource::addDependency(identifier);
+        auto [provider, name] = Resource::splitResourceIdentifierView(identifier);
+        if (auto* resourceProvider = Resource::findResourceProvider(provider, name)) {
+            auto resource = std::make_unique<ResourceType>(identifier, std::forward<Params>(params)...);
+            Resource::compileFromProvider(resourceProvider, name, resource.get());
+            return resource;
         }
         Resource::logResourceError("error.resource.resource_not_found", identifier);
         return nullptr;
@@ -128,16 +173,55 @@ public:
 
     static std::pair<std::string, std::string> splitResourceIdentifier(const std::string& identifier);
 
+    /// Same as splitResourceIdentifier(), but both halves point into the given identifier instead of being copied.
+    static std::pair<std::string_view, std::string_view> splitResourceIdentifierView(std::string_view identifier);
+
     static const std::vector<std::unique_ptr<IResourceProvider>>& getResourceProviders(const std::string& providerName);
 
     static bool hasResource(const std::string& identifier);
 
-    /// If resource is present in the cache and has a reference count less than or equal to 2, mark it for removal.
+    /// If the resource is cached and nothing but the cache and the caller hold it, mark it for removal.
     static void removeResource(const std::string& identifier);
 
-    /// Delete all resources marked for removal.
+    /// Delete all resources marked for removal, and evict unused resources if they're over budget.
+    /// Called once per frame on the main thread, lookups don't clean up after themselves.
     static void cleanup();
 
+    struct CacheStatistics {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::uint64_t evictions;
+        std::size_t unusedResources;
+        std::size_t unusedBytes;
+        std::size_t budgetBytes;
+    };
+    [[nodiscard]] static CacheStatistics getCacheStatistics();
+
+    /// Resources nothing uses anymore stay cached until they take up more than this many bytes,
+    /// then the least recently used ones are deleted. Set by the resource_cache_budget convar.
+    static void setUnusedResourceBudget(std::size_t bytes);
+
+    /// Deletes unused resources, least recently used first, until they take up at most this many bytes.
+    static void evictUnusedResources(std::size_t budget);
+
+    /// Finishes asynchronous loads that are done on the loader threads. Called once per frame on the main thread.
+    static void processAsyncLoads();
+
+    /// Records that the resource being compiled on this thread depends on the given resource or file.
+    /// Anything loaded through this class while compiling is recorded automatically.
+    static void addDependency(const std::string& identifier);
+
+    /// Returns every identifier that was compiled using the given one, directly or not.
+    static std::vector<std::string> getDependents(const std::string& identifier);
+
+    /// Queues the resource and everything depending on it to be reloaded by processReloads().
+    /// Filesystem providers call this when a file changes. Safe to call from any thread.
+    static void markChanged(const std::string& identifier);
+
+    /// Compiles changed cached resources again in place, dependencies first, so existing holders see the new data.
+    /// Fires the "chira::resource::reloaded" event for each of them. Called once per frame on the main thread.
+    static void processReloads();
+
     /// Deletes ALL resources and providers. Should only ever be called once, when the program closes.
     static void discardAll();
 
@@ -159,10 +243,110 @@ public:
     }
 
 protected:
-    static inline std::unordered_map<std::string, std::vector<std::unique_ptr<IResourceProvider>>> providers;
-    static inline std::unordered_map<std::string, std::unordered_map<std::string, SharedPointer<Resource>>> resources;
+    struct ProviderNameHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view name) const {
+            return std::hash<std::string_view>{}(name);
+        }
+    };
+    /// Providers are only added on the main thread, but they're looked up from any thread.
+    /// They aren't removed until discardAll(), so a provider can be used after unlocking.
+    static inline std::unordered_map<std::string, std::vector<std::unique_ptr<IResourceProvider>>, ProviderNameHash, std::equal_to<>> providers;
+    static inline std::shared_mutex providersMutex;
+    /// Returns the most recently added provider with the given name that has the resource, or nullptr.
+    static IResourceProvider* findResourceProvider(std::string_view provider, std::string_view name);
+    static inline ResourceRegistry resources;
     static inline std::unordered_map<std::size_t, SharedPointer<Resource>> defaultResources;
-    static inline std::vector<std::string> garbageResources;
+    /// Handles keep the resources alive until they are removed from the cache
+    static inline std::vector<SharedPointer<Resource>> garbageResources;
+    static inline std::mutex garbageResourcesMutex;
+
+    struct AsyncLoad {
+        std::string identifier;
+        std::string name;
+        std::unique_ptr<Resource> resource;
+        std::vector<IResourceProvider*> providers;
+        std::vector<byte> buffer;
+        std::string error;
+        bool found = false;
+        bool compiled = false;
+        std::function<void(const SharedPointer<Resource>&)> onLoaded;
+    };
+    static inline std::unique_ptr<ThreadPool> loaderPool;
+    /// True on the resource loader threads
+    static inline thread_local bool onLoaderThread = false;
+    static inline std::unordered_map<std::string, std::any> pendingAsyncResources;
+    static inline std::vector<std::shared_ptr<AsyncLoad>> finishedAsyncLoads;
+    static inline std::mutex finishedAsyncLoadsMutex;
+
+    static void queueAsyncLoad(const std::string& identifier, Resource* resource, std::function<void(const SharedPointer<Resource>&)> onLoaded);
+
+    static inline std::atomic_size_t unusedResourceBudget = 256 * 1024 * 1024;
+    static inline std::atomic_uint64_t cacheHits = 0;
+    static inline std::atomic_uint64_t cacheMisses = 0;
+    static inline std::atomic_uint64_t cacheEvictions = 0;
+
+    /// Adds the resource to the cache as being loaded, and marks it unused in the registry when the last handle outside the cache is dropped.
+    /// See ResourceRegistry::insertLoading().
+    static std::pair<SharedPointer<Resource>, bool> cacheLoadingResource(const ResourceKey& key, SharedPointer<Resource>&& resource, bool replace);
+
+    static bool onResourceUnused(void* resource, SharedPointerMetadata* data);
+
+    /// Compiles the resource and caches it. Other threads looking it up in the meantime wait until it's compiled.
+    /// Unless replace is true, a resource that was cached first (or is being compiled on another thread) is returned instead.
+    template<typename ResourceType, typename... Params>
+    static SharedPointer<ResourceType> loadResource(const std::string& identifier, bool replace, Params... params) {
+        auto [provider, name] = Resource::splitResourceIdentifierView(identifier);
+        if (auto* resourceProvider = Resource::findResourceProvider(provider, name)) {
+            const ResourceKey key{identifier};
+            auto [resource, loading] = Resource::cacheLoadingResource(key, SharedPointer<ResourceType>::make(identifier, std::forward<Params>(params)...), replace);
+            if (loading) {
+                runtime_assert(!Resource::onLoaderThread || resource->canCompileAsync(),
+                               "Only resources that can compile asynchronously can be loaded on a resource loader thread!");
+                try {
+                    Resource::compileFromProvider(resourceProvider, name, resource.get());
+                } catch (...) {
+                    // Don't leave anybody waiting on it
+                    Resource::resources.finishLoading(key, resource.get());
+                    throw;
+                }
+                Resource::resources.finishLoading(key, resource.get());
+            }
+            return resource.template castAssert<ResourceType>();
+        }
+        Resource::logResourceError("error.resource.resource_not_found", identifier);
+        if (Resource::hasDefaultResource<ResourceType>())
+            return Resource::getDefaultResource<ResourceType>();
+        return SharedPointer<ResourceType>{};
+    }
+
+    /// Identifier -> everything it loaded while compiling
+    static inline std::unordered_map<std::string, std::unordered_set<std::string>> dependencies;
+    /// Identifier -> everything that loaded it while compiling
+    static inline std::unordered_map<std::string, std::unordered_set<std::string>> dependents;
+    static inline std::mutex dependenciesMutex;
+    /// The resources being compiled on this thread, innermost last
+    static inline thread_local std::vector<const std::string*> compilingResources;
+    static inline std::unordered_set<std::string> changedResources;
+    static inline std::mutex changedResourcesMutex;
+
+    /// Marks the resource as being compiled on this thread, so anything it loads is recorded as a dependency.
+    struct CompileScope {
+        explicit CompileScope(const Resource* resource) {
+            Resource::compilingResources.push_back(&resource->identifier);
+        }
+        ~CompileScope() {
+            Resource::compilingResources.pop_back();
+        }
+        CompileScope(const CompileScope& other) = delete;
+        CompileScope& operator=(const CompileScope& other) = delete;
+    };
+    static void compileFromProvider(IResourceProvider* provider, std::string_view name, Resource* resource) {
+        CompileScope scope{resource};
+        provider->compileResource(name, resource);
+    }
+    static void clearDependencies(const std::string& identifier);
+    static void reloadResource(const std::string& identifier);
 
     /// We do a few predeclaration workarounds
     static void logResourceError(const std::string& identifier, const std::string& resourceName);
@@ -0,0 +1,247 @@
+#include "ResourceRegistry.h"
+
+#include "Resource.h"
+
+using namespace chira;
+
+ResourceRegistry::~ResourceRegistry() = default;
+
+// The thread compiling the resource sees it, in case it's looked up again while compiling
+static bool isLoadingElsewhere(std::thread::id loadingThread) {
+    return loadingThread != std::thread::id{} && loadingThread != std::this_thread::get_id();
+}
+
+SharedPointer<Resource> ResourceRegistry::get(const ResourceKey& key) const {
+    const auto& stripe = this->getStripe(key);
+    std::shared_lock lock{stripe.mutex};
+    auto entry = stripe.resources.find(key);
+    while (entry != stripe.resources.end() && isLoadingElsewhere(entry->second.loadingThread)) {
+        stripe.loaded.wait(lock);
+        entry = stripe.resources.find(key);
+    }
+    if (entry == stripe.resources.end())
+        return SharedPointer<Resource>{};
+    // Take the handle first, so it can't be marked unused again until it's dropped
+    auto resource = entry->second.resource;
+    this->removeUnused(entry->second);
+    return resource;
+}
+
+Resource* ResourceRegistry::getUnowned(const ResourceKey& key) const {
+    const auto& stripe = this->getStripe(key);
+    std::shared_lock lock{stripe.mutex};
+    if (auto entry = stripe.resources.find(key); entry != stripe.resources.end() && !isLoadingElsewhere(entry->second.loadingThread))
+        return entry->second.resource.get();
+    return nullptr;
+}
+
+bool ResourceRegistry::contains(const ResourceKey& key) const {
+    const auto& stripe = this->getStripe(key);
+    std::shared_lock lock{stripe.mutex};
+    return stripe.resources.find(key) != stripe.resources.end();
+}
+
+bool ResourceRegistry::contains(const ResourceKey& key, const Resource* resource) const {
+    const auto& stripe = this->getStripe(key);
+    std::shared_lock lock{stripe.mutex};
+    auto entry = stripe.resources.find(key);
+    return entry != stripe.resources.end() && entry->second.resource.get() == resource;
+}
+
+unsigned int ResourceRegistry::getUseCount(const ResourceKey& key) const {
+    const auto& stripe = this->getStripe(key);
+    std::shared_lock lock{stripe.mutex};
+    if (auto entry = stripe.resources.find(key); entry != stripe.resources.end())
+        return entry->second.resource.useCount();
+    return 0;
+}
+
+// Replaced and removed resources are declared before the lock, so they are released after the stripe
+// is unlocked: deleting a resource looks it up in the cache again
+
+// A resource with a last holder callback is still alive, and nothing will call back for it anymore
+static void detach(const SharedPointer<Resource>& resource) {
+    if (resource.hasLastHolderCallback()) {
+        resource.setLastHolderCallback(nullptr, nullptr);
+        resource.setHolderAmountForDelete(0);
+    }
+}
+
+void ResourceRegistry::set(const ResourceKey& key, SharedPointer<Resource>&& resource) {
+    auto& stripe = this->getStripe(key);
+    SharedPointer<Resource> replaced;
+    std::unique_lock lock{stripe.mutex};
+    if (auto entry = stripe.resources.find(key); entry != stripe.resources.end()) {
+        this->removeUnused(entry->second);
+        replaced = std::move(entry->second.resource);
+        detach(replaced);
+        entry->second.resource = std::move(resource);
+    } else {
+        stripe.resources.try_emplace(std::string{key.identifier}).first->second.resource = std::move(resource);
+    }
+}
+
+std::pair<SharedPointer<Resource>, bool> ResourceRegistry::insertLoading(const ResourceKey& key, SharedPointer<Resource>&& resource, bool replace) {
+    auto& stripe = this->getStripe(key);
+    SharedPointer<Resource> given = std::move(resource);
+    SharedPointer<Resource> replaced;
+    std::unique_lock lock{stripe.mutex};
+    auto entry = stripe.resources.find(key);
+    while (entry != stripe.resources.end() && isLoadingElsewhere(entry->second.loadingThread)) {
+        stripe.loaded.wait(lock);
+        entry = stripe.resources.find(key);
+    }
+    if (entry != stripe.resources.end() && !replace) {
+        // Somebody else got there first, the given resource is dropped after unlocking
+        this->removeUnused(entry->second);
+        detach(given);
+        return {entry->second.resource, false};
+    }
+    if (entry != stripe.resources.end()) {
+        this->removeUnused(entry->second);
+        replaced = std::move(entry->second.resource);
+        detach(replaced);
+    } else {
+        entry = stripe.resources.try_emplace(std::string{key.identifier}).first;
+    }
+    entry->second.resource = given;
+    entry->second.loadingThread = std::this_thread::get_id();
+    return {std::move(given), true};
+}
+
+void ResourceRegistry::finishLoading(const ResourceKey& key, const Resource* resource) {
+    auto& stripe = this->getStripe(key);
+    {
+        std::unique_lock lock{stripe.mutex};
+        auto entry = stripe.resources.find(key);
+        if (entry == stripe.resources.end() || entry->second.resource.get() != resource)
+            return;
+        entry->second.loadingThread = std::thread::id{};
+    }
+    stripe.loaded.notify_all();
+}
+
+bool ResourceRegistry::erase(const ResourceKey& key) {
+    auto& stripe = this->getStripe(key);
+    SharedPointer<Resource> removed;
+    std::unique_lock lock{stripe.mutex};
+    if (auto entry = stripe.resources.find(key); entry != stripe.resources.end()) {
+        this->removeUnused(entry->second);
+        removed = std::move(entry->second.resource);
+        detach(removed);
+        // Anybody waiting for it to finish compiling will find it's gone
+        if (entry->second.loadingThread != std::thread::id{})
+            stripe.loaded.notify_all();
+        stripe.resources.erase(entry);
+        return true;
+    }
+    return false;
+}
+
+bool ResourceRegistry::erase(const ResourceKey& key, const Resource* resource) {
+    auto& stripe = this->getStripe(key);
+    SharedPointer<Resource> removed;
+    std::unique_lock lock{stripe.mutex};
+    if (auto entry = stripe.resources.find(key); entry != stripe.resources.end() && entry->second.resource.get() == resource) {
+        this->removeUnused(entry->second);
+        removed = std::move(entry->second.resource);
+        detach(removed);
+        // Anybody waiting for it to finish compiling will find it's gone
+        if (entry->second.loadingThread != std::thread::id{})
+            stripe.loaded.notify_all();
+        stripe.resources.erase(entry);
+        return true;
+    }
+    return false;
+}
+
+void ResourceRegistry::clear() {
+    for (auto& stripe : this->stripes) {
+        decltype(stripe.resources) removed;
+        std::unique_lock lock{stripe.mutex};
+        for (const auto& [identifier, entry] : stripe.resources) {
+            this->removeUnused(entry);
+            detach(entry.resource);
+        }
+        std::swap(removed, stripe.resources);
+        stripe.loaded.notify_all();
+    }
+}
+
+std::size_t ResourceRegistry::size() const {
+    std::size_t out = 0;
+    for (const auto& stripe : this->stripes) {
+        std::shared_lock lock{stripe.mutex};
+        out += stripe.resources.size();
+    }
+    return out;
+}
+
+void ResourceRegistry::forEach(const std::function<void(std::string_view, const SharedPointer<Resource>&)>& callback) const {
+    for (const auto& stripe : this->stripes) {
+        std::shared_lock lock{stripe.mutex};
+        for (const auto& [identifier, entry] : stripe.resources) {
+            callback(identifier, entry.resource);
+        }
+    }
+}
+
+void ResourceRegistry::markUnused(const ResourceKey& key, const Resource* resource, std::size_t size) {
+    auto& stripe = this->getStripe(key);
+    // Exclusive, so nobody can take a handle while we check that nobody has one
+    std::unique_lock lock{stripe.mutex};
+    auto entry = stripe.resources.find(key);
+    if (entry == stripe.resources.end() || entry->second.resource.get() != resource || entry->second.resource.useCount() != 1)
+        return;
+    std::scoped_lock unusedLock{this->unusedMutex};
+    if (entry->second.isUnused.load(std::memory_order_relaxed))
+        return;
+    entry->second.unused = this->unused.emplace(this->unused.end(), UnusedResource{entry->first, size});
+    entry->second.isUnused.store(true, std::memory_order_relaxed);
+    this->unusedSize.fetch_add(size, std::memory_order_relaxed);
+}
+
+bool ResourceRegistry::popUnused(SharedPointer<Resource>& evicted) {
+    std::string identifier;
+    {
+        std::scoped_lock unusedLock{this->unusedMutex};
+        if (this->unused.empty())
+            return false;
+        // Copied, the entry might be removed as soon as the list is unlocked
+        identifier = this->unused.front().identifier;
+    }
+
+    const ResourceKey key{identifier};
+    auto& stripe = this->getStripe(key);
+    std::unique_lock lock{stripe.mutex};
+    auto entry = stripe.resources.find(key);
+    if (entry == stripe.resources.end() || !entry->second.isUnused.load(std::memory_order_relaxed)) {
+        // Picked up or removed in the meantime, it's not in the list anymore
+        return true;
+    }
+    this->removeUnused(entry->second);
+    // Somebody might have copied a handle they got from forEach(), it will come back here once they're done with it
+    if (entry->second.resource.useCount() == 1) {
+        evicted = std::move(entry->second.resource);
+        detach(evicted);
+        stripe.resources.erase(entry);
+    }
+    return true;
+}
+
+std::size_t ResourceRegistry::getUnusedCount() const {
+    std::scoped_lock unusedLock{this->unusedMutex};
+    return this->unused.size();
+}
+
+void ResourceRegistry::removeUnused(const Entry& entry) const {
+    // Marking happens under the stripe's exclusive lock, so a set flag is always visible here
+    if (!entry.isUnused.load(std::memory_order_relaxed))
+        return;
+    std::scoped_lock unusedLock{this->unusedMutex};
+    if (!entry.isUnused.load(std::memory_order_relaxed))
+        return;
+    this->unusedSize.fetch_sub(entry.unused->size, std::memory_order_relaxed);
+    this->unused.erase(entry.unused);
+    entry.isUnused.store(false, std::memory_order_relaxed);
+}
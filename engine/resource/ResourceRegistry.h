@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility/SharedPointer.h>
+
+namespace chira {
+
+class Resource;
+
+/// A resource identifier with its hash computed up front, so it can be looked up
+/// in a ResourceRegistry without allocating or hashing it more than once.
+struct ResourceKey {
+    explicit ResourceKey(std::string_view identifier_)
+        : identifier(identifier_)
+        , hash(std::hash<std::string_view>{}(identifier_)) {}
+    std::string_view identifier;
+    std::size_t hash;
+};
+
+/// The resource cache. Entries are spread over several independently locked stripes,
+/// so lookups from different threads rarely wait on each other, and never wait on each other at all
+/// unless somebody is adding or removing a resource from the same stripe.
+/// Resources nothing outside the registry holds are also kept in a least recently used list, so they can be evicted.
+class ResourceRegistry {
+    struct KeyHash {
+        using is_transparent = void;
+        std::size_t operator()(const ResourceKey& key) const {
+            return key.hash;
+        }
+        std::size_t operator()(std::string_view identifier) const {
+            return std::hash<std::string_view>{}(identifier);
+        }
+    };
+    struct KeyEqual {
+        using is_transparent = void;
+        bool operator()(std::string_view lhs, std::string_view rhs) const {
+            return lhs == rhs;
+        }
+        bool operator()(const ResourceKey& lhs, std::string_view rhs) const {
+            return lhs.identifier == rhs;
+        }
+        bool operator()(std::string_view lhs, const ResourceKey& rhs) const {
+            return lhs == rhs.identifier;
+        }
+    };
+    struct UnusedResource {
+        /// Points to the key of the resource's entry, which outlives this
+        std::string_view identifier;
+        std::size_t size;
+    };
+    struct Entry {
+        SharedPointer<Resource> resource;
+        /// Only changed while holding unusedMutex, lookups change them while only holding the stripe's shared lock.
+        /// The flag can be checked without it, so lookups of resources in use don't wait on each other.
+        mutable std::atomic_bool isUnused = false;
+        mutable std::list<UnusedResource>::iterator unused;
+        /// The thread compiling the resource, if it's still being compiled.
+        /// Only that thread can see the resource until then, everybody else waits for it.
+        std::thread::id loadingThread;
+    };
+    struct Stripe {
+        mutable std::shared_mutex mutex;
+        /// Notified when a resource in this stripe is done compiling
+        mutable std::condition_variable_any loaded;
+        std::unordered_map<std::string, Entry, KeyHash, KeyEqual> resources;
+    };
+public:
+    ResourceRegistry() = default;
+    ~ResourceRegistry();
+    ResourceRegistry(const ResourceRegistry& other) = delete;
+    ResourceRegistry& operator=(const ResourceRegistry& other) = delete;
+    ResourceRegistry(ResourceRegistry&& other) noexcept = delete;
+    ResourceRegistry& operator=(ResourceRegistry&& other) noexcept = delete;
+
+    /// Returns a new handle to the resource, or an empty pointer if it is not cached.
+    /// If the resource was unused, it is taken out of the unused list.
+    /// If another thread is still compiling the resource, waits until it's done.
+    [[nodiscard]] SharedPointer<Resource> get(const ResourceKey& key) const;
+    /// Returns the resource without adding a reference, or nullptr if it is not cached or another thread is still compiling it.
+    /// Dropping a handle to a resource that only the registry holds deletes it, this doesn't.
+    [[nodiscard]] Resource* getUnowned(const ResourceKey& key) const;
+    [[nodiscard]] bool contains(const ResourceKey& key) const;
+    /// Check if this exact resource is the one cached under the key.
+    [[nodiscard]] bool contains(const ResourceKey& key, const Resource* resource) const;
+    /// Returns 0 if the resource is not cached.
+    [[nodiscard]] unsigned int getUseCount(const ResourceKey& key) const;
+    /// Caches the resource, replacing any resource already cached under the key.
+    /// Removed resources that were kept alive by a last holder callback live on until nothing holds them.
+    void set(const ResourceKey& key, SharedPointer<Resource>&& resource);
+    /// Caches a resource that is about to be compiled, unless replace is false and the key is already cached.
+    /// Other threads looking up the key wait until finishLoading() is called, the calling thread can see it right away.
+    /// Returns the cached resource, and true if it's the given one, which the caller must then compile and finish loading.
+    /// If another thread is compiling the resource already, this waits for it and returns its resource.
+    [[nodiscard]] std::pair<SharedPointer<Resource>, bool> insertLoading(const ResourceKey& key, SharedPointer<Resource>&& resource, bool replace);
+    /// Makes the resource visible to every thread, if it is this exact resource.
+    void finishLoading(const ResourceKey& key, const Resource* resource);
+    bool erase(const ResourceKey& key);
+    /// Removes the resource only if it is this exact resource.
+    bool erase(const ResourceKey& key, const Resource* resource);
+    void clear();
+    [[nodiscard]] std::size_t size() const;
+
+    /// Puts the resource at the back of the unused list, if it is this exact resource and the registry holds the only handle.
+    /// Does nothing if it's already in the list, or if somebody picked it up again.
+    void markUnused(const ResourceKey& key, const Resource* resource, std::size_t size);
+    /// Takes the least recently used resource out of the unused list, and removes it from the registry if nothing picked it up since.
+    /// The removed resource is moved into evicted, so it can be dropped after this returns.
+    /// Returns false if the unused list is empty.
+    bool popUnused(SharedPointer<Resource>& evicted);
+    [[nodiscard]] std::size_t getUnusedCount() const;
+    /// The sum of the sizes given to markUnused() for every resource in the unused list.
+    [[nodiscard]] std::size_t getUnusedSize() const {
+        return this->unusedSize.load(std::memory_order_relaxed);
+    }
+
+    /// Locks each stripe in turn, so the callback must not add or remove resources.
+    void forEach(const std::function<void(std::string_view identifier, const SharedPointer<Resource>& resource)>& callback) const;
+
+    static constexpr inline std::size_t STRIPE_COUNT = 16;
+private:
+    std::array<Stripe, STRIPE_COUNT> stripes;
+    /// Always locked after a stripe, never before
+    mutable std::mutex unusedMutex;
+    /// Least recently used first
+    mutable std::list<UnusedResource> unused;
+    mutable std::atomic_size_t unusedSize = 0;
+
+    /// The stripe containing the entry must be locked.
+    void removeUnused(const Entry& entry) const;
+
+    [[nodiscard]] Stripe& getStripe(const ResourceKey& key) {
+        return this->stripes[key.hash % STRIPE_COUNT];
+    }
+    [[nodiscard]] const Stripe& getStripe(const ResourceKey& key) const {
+        return this->stripes[key.hash % STRIPE_COUNT];
+    }
+};
+
+} // namespace chira
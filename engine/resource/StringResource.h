@@ -8,6 +8,12 @@ class StringResource : public Resource {
 public:
     explicit StringResource(std::string identifier_) : Resource(std::move(identifier_)) {}
     void compile(const byte buffer[], std::size_t bufferLength) override;
+    [[nodiscard]] bool canCompileAsync() const override {
+        return true;
+    }
+    [[nodiscard]] std::size_t getCPUMemoryUsage() const override {
+        return Resource::getCPUMemoryUsage() + this->data.capacity();
+    }
     [[nodiscard]] const std::string& getString() const;
 protected:
     std::string data;
@@ -0,0 +1,211 @@
+#include "ArchiveResourceProvider.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <core/Logger.h>
+#include <i18n/TranslationManager.h>
+#include <resource/Resource.h>
+#include <utility/LZ4.h>
+
+using namespace chira;
+
+CHIRA_CREATE_LOG(ARCHIVE);
+
+ArchiveResourceProvider::ArchiveResourceProvider(const std::string& archivePath, bool isPathAbsolute, const std::string& name_)
+    : IResourceProvider(name_) {
+    std::string path = isPathAbsolute ? archivePath : FILESYSTEM_ROOT_FOLDER + '/' + archivePath;
+    // Archives aren't rewritten while they're mounted, so resources can keep pointing into them
+    this->archive = std::make_shared<const MappedFile>(path, true);
+    if (!this->archive->isOpen()) {
+        LOG_ARCHIVE.error(TRF("error.archive_provider.invalid_archive", path));
+        return;
+    }
+
+    const byte* data = this->archive->getData();
+    const std::size_t size = this->archive->getSize();
+    ArchiveHeader header;
+    bool valid = size >= sizeof(ArchiveHeader);
+    if (valid) {
+        std::memcpy(&header, data, sizeof(ArchiveHeader));
+        valid = std::memcmp(header.signature, ArchiveHeader{}.signature, sizeof(header.signature)) == 0 &&
+                header.version == ArchiveHeader{}.version &&
+                header.tocOffset <= size && header.tocOffset % alignof(ArchiveEntry) == 0 &&
+                header.entryCount <= (size - header.tocOffset) / sizeof(ArchiveEntry) &&
+                header.namesOffset <= size;
+    }
+    if (!valid) {
+        LOG_ARCHIVE.error(TRF("error.archive_provider.invalid_archive", path));
+        this->archive.reset();
+        return;
+    }
+
+    // The table of contents is used in place, straight out of the mapping
+    const auto* entries = reinterpret_cast<const ArchiveEntry*>(data + header.tocOffset);
+    const auto* entryNames = reinterpret_cast<const char*>(data + header.namesOffset);
+    for (std::uint32_t i = 0; i < header.entryCount; i++) {
+        const auto& entry = entries[i];
+        // Lookups binary search by hash, so the hashes have to be right and in order
+        if (!ArchiveResourceProvider::isValidEntry(entry, size, size - header.namesOffset) ||
+            entry.nameHash != ArchiveResourceProvider::getNameHash({entryNames + entry.nameOffset, entry.nameLength}) ||
+            (i > 0 && entries[i - 1].nameHash > entry.nameHash)) {
+            LOG_ARCHIVE.error(TRF("error.archive_provider.invalid_archive", path));
+            this->archive.reset();
+            return;
+        }
+    }
+    this->toc = entries;
+    this->names = entryNames;
+    this->entryCount = header.entryCount;
+}
+
+bool ArchiveResourceProvider::hasResource(std::string_view name) const {
+    return this->findEntry(name) != nullptr;
+}
+
+void ArchiveResourceProvider::compileResource(std::string_view name, Resource* resource) const {
+    // Uncompressed entries don't need to be copied out of the archive
+    if (const auto* entry = this->findEntry(name); entry && entry->compression == ArchiveCompression::NONE && entry->size > 0) {
+        resource->compileMapped(std::make_shared<const MappedFile>(this->archive, entry->dataOffset, entry->size));
+        return;
+    }
+    auto bytes = this->readResource(name);
+    resource->compile(bytes.data(), bytes.size());
+}
+
+std::vector<byte> ArchiveResourceProvider::readResource(std::string_view name) const {
+    const auto* entry = this->findEntry(name);
+    if (!entry)
+        return {'\0'};
+    const ArchiveEntry& info = *entry;
+    const byte* stored = this->archive->getData() + info.dataOffset;
+
+    std::vector<byte> bytes(info.size + 1);
+    switch (info.compression) {
+        case ArchiveCompression::NONE:
+            // Validated to be the same as the stored size when the archive was opened
+            std::memcpy(bytes.data(), stored, info.size);
+            break;
+        case ArchiveCompression::LZ4:
+            if (!LZ4::decompress(stored, info.storedSize, bytes.data(), info.size)) {
+                LOG_ARCHIVE.error(TRF("error.archive_provider.corrupt_entry", name));
+                return {'\0'};
+            }
+            break;
+    }
+    bytes[info.size] = '\0';
+    return bytes;
+}
+
+const ArchiveEntry* ArchiveResourceProvider::findEntry(std::string_view name) const {
+    const auto hash = ArchiveResourceProvider::getNameHash(name);
+    const auto* end = this->toc + this->entryCount;
+    const auto* entry = std::lower_bound(this->toc, end, hash, [](const ArchiveEntry& lhs, std::uint64_t rhs) {
+        return lhs.nameHash < rhs;
+    });
+    // Names with the same hash are next to each other
+    for (; entry != end && entry->nameHash == hash; entry++) {
+        if (std::string_view{this->names + entry->nameOffset, entry->nameLength} == name)
+            return entry;
+    }
+    return nullptr;
+}
+
+bool ArchiveResourceProvider::isValidEntry(const ArchiveEntry& entry, std::size_t archiveSize, std::size_t namesSize) {
+    // Written so none of the checks can overflow
+    if (entry.nameOffset > namesSize || entry.nameLength > namesSize - entry.nameOffset)
+        return false;
+    if (entry.dataOffset > archiveSize || entry.storedSize > archiveSize - entry.dataOffset)
+        return false;
+    switch (entry.compression) {
+        case ArchiveCompression::NONE:
+            return entry.storedSize == entry.size;
+        case ArchiveCompression::LZ4:
+            // LZ4 can't expand anything more than 255 times, don't trust a size that would need more
+            return entry.size / 255 <= entry.storedSize;
+    }
+    return false;
+}
+
+bool ArchiveResourceProvider::createArchive(const std::string& folder, const std::string& archivePath, bool compress) {
+    std::error_code error;
+    if (!std::filesystem::is_directory(folder, error))
+        return false;
+
+    std::vector<std::filesystem::path> files;
+    for (const auto& file : std::filesystem::recursive_directory_iterator{folder, error}) {
+        if (file.is_regular_file())
+            files.push_back(file.path());
+    }
+    // Pack in a stable order, so packing the same folder twice gives the same archive
+    std::sort(files.begin(), files.end());
+
+    std::ofstream out{archivePath, std::ios::binary | std::ios::trunc};
+    if (!out)
+        return false;
+
+    ArchiveHeader header;
+    std::vector<ArchiveEntry> toc;
+    std::string names;
+    std::uint64_t offset = sizeof(ArchiveHeader);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(ArchiveHeader));
+
+    const auto pad = [&out, &offset](std::uint64_t alignment) {
+        static constexpr char zeroes[64]{};
+        const auto padding = (alignment - offset % alignment) % alignment;
+        out.write(zeroes, static_cast<std::streamsize>(padding));
+        offset += padding;
+    };
+
+    for (const auto& file : files) {
+        std::string name = std::filesystem::relative(file, folder).generic_string();
+        std::ifstream in{file, std::ios::binary};
+        std::vector<byte> contents{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+
+        ArchiveEntry entry;
+        entry.nameHash = ArchiveResourceProvider::getNameHash(name);
+        entry.nameOffset = static_cast<std::uint32_t>(names.size());
+        entry.nameLength = static_cast<std::uint32_t>(name.size());
+        entry.size = contents.size();
+        names += name;
+
+        std::vector<byte> compressed;
+        if (compress && !contents.empty()) {
+            compressed = LZ4::compress(contents.data(), contents.size());
+            if (compressed.size() < contents.size())
+                entry.compression = ArchiveCompression::LZ4;
+        }
+        const auto& stored = entry.compression == ArchiveCompression::LZ4 ? compressed : contents;
+        pad(header.alignment);
+        entry.dataOffset = offset;
+        entry.storedSize = stored.size();
+        out.write(reinterpret_cast<const char*>(stored.data()), static_cast<std::streamsize>(stored.size()));
+        offset += stored.size();
+        toc.push_back(entry);
+    }
+
+    std::sort(toc.begin(), toc.end(), [](const ArchiveEntry& lhs, const ArchiveEntry& rhs) {
+        return lhs.nameHash < rhs.nameHash;
+    });
+    pad(alignof(ArchiveEntry));
+    header.tocOffset = offset;
+    header.entryCount = static_cast<std::uint32_t>(toc.size());
+    out.write(reinterpret_cast<const char*>(toc.data()), static_cast<std::streamsize>(toc.size() * sizeof(ArchiveEntry)));
+    offset += toc.size() * sizeof(ArchiveEntry);
+    header.namesOffset = offset;
+    out.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(ArchiveHeader));
+    return out.good();
+}
+
+std::uint64_t ArchiveResourceProvider::getNameHash(std::string_view name) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (char c : name) {
+        hash ^= static_cast<byte>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
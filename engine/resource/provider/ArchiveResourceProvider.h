@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility/MappedFile.h>
+#include "FilesystemResourceProvider.h"
+
+namespace chira {
+
+const std::string ARCHIVE_FILE_EXTENSION = ".cpak"; // NOLINT(cert-err58-cpp)
+
+enum class ArchiveCompression : std::uint32_t {
+    NONE = 0,
+    LZ4 = 1,
+};
+
+/// Archive layout: the header, then each entry's data (aligned), then the table of contents
+/// sorted by name hash, then the entry names, back to back and not null-terminated.
+/// Uncompressed entries are stored with the same stored size and size.
+struct ArchiveHeader {
+    char signature[4] = {'C', 'P', 'A', 'K'};
+    std::uint32_t version = 1;
+    std::uint32_t entryCount = 0;
+    std::uint32_t alignment = 16;
+    std::uint64_t tocOffset = 0;
+    std::uint64_t namesOffset = 0;
+};
+
+struct ArchiveEntry {
+    /// FNV-1a, so it's the same on every platform
+    std::uint64_t nameHash = 0;
+    /// Relative to ArchiveHeader::namesOffset
+    std::uint32_t nameOffset = 0;
+    std::uint32_t nameLength = 0;
+    std::uint64_t dataOffset = 0;
+    std::uint64_t storedSize = 0;
+    std::uint64_t size = 0;
+    ArchiveCompression compression = ArchiveCompression::NONE;
+    std::uint32_t reserved = 0;
+};
+
+/// Serves resources out of a single packed archive, see ArchiveResourceProvider::createArchive.
+/// The archive is mapped into memory once and validated when the provider is created. Lookups binary search
+/// the table of contents in place, and uncompressed entries are compiled straight out of the mapping.
+class ArchiveResourceProvider : public IResourceProvider {
+public:
+    /// Relative paths are relative to the resources folder, like FilesystemResourceProvider.
+    explicit ArchiveResourceProvider(const std::string& archivePath, bool isPathAbsolute = false, const std::string& name_ = FILESYSTEM_PROVIDER_NAME);
+    [[nodiscard]] bool hasResource(std::string_view name) const override;
+    void compileResource(std::string_view name, Resource* resource) const override;
+    [[nodiscard]] std::vector<byte> readResource(std::string_view name) const override;
+    [[nodiscard]] bool isOpen() const {
+        return this->archive && this->archive->isOpen();
+    }
+    [[nodiscard]] std::size_t getResourceCount() const {
+        return this->entryCount;
+    }
+
+    /// Packs every file in a folder (recursively) into an archive.
+    /// Entries that get smaller with LZ4 are stored compressed if compress is true.
+    static bool createArchive(const std::string& folder, const std::string& archivePath, bool compress = true);
+
+    [[nodiscard]] static std::uint64_t getNameHash(std::string_view name);
+private:
+    std::shared_ptr<const MappedFile> archive;
+    const ArchiveEntry* toc = nullptr;
+    const char* names = nullptr;
+    std::uint32_t entryCount = 0;
+
+    [[nodiscard]] const ArchiveEntry* findEntry(std::string_view name) const;
+    [[nodiscard]] static bool isValidEntry(const ArchiveEntry& entry, std::size_t archiveSize, std::size_t namesSize);
+};
+
+} // namespace chira
@@ -1,10 +1,12 @@
 #include "FilesystemResourceProvider.h"
 
+#include <algorithm>
 #include <fstream>
 #include <filesystem>
 #include <utility>
 #include <core/Platform.h>
 #include <resource/Resource.h>
+#include <utility/MappedFile.h>
 
 #ifdef CHIRA_PLATFORM_APPLE
     #include "CoreFoundation/CoreFoundation.h"
@@ -69,29 +71,137 @@ FilesystemResourceProvider::FilesystemResourceProvider(std::string path_, bool i
     this->path = FILESYSTEM_ROOT_FOLDER + '/' + this->path;
 #endif
     }
+
+    // Start watching before the first scan so nothing created in between is missed
+    this->watcher = std::make_unique<FileWatcher>(this->getRootPath().string(), [this](FileWatcher::Event event, std::string_view name, bool isDirectory) {
+        this->onFileChanged(event, name, isDirectory);
+    });
+    if (this->watcher->isWatching())
+        this->refreshIndex();
+}
+
+// Most names are already normalized, so they can be looked up without copying them
+static bool isNormalized(std::string_view name) {
+    if (name.empty() || name == "." || name.starts_with("./") || name.ends_with('/') || name.ends_with("/.") || name.ends_with("/.."))
+        return false;
+    if (name.find('\\') != std::string_view::npos || name.find("//") != std::string_view::npos || name.find("/./") != std::string_view::npos || name.find("../") != std::string_view::npos)
+        return false;
+#if defined(CHIRA_PLATFORM_WINDOWS) || defined(CHIRA_PLATFORM_APPLE)
+    if (std::any_of(name.begin(), name.end(), [](char c) { return c >= 'A' && c <= 'Z'; }))
+        return false;
+#endif
+    return true;
 }
 
 bool FilesystemResourceProvider::hasResource(std::string_view name) const {
-    if (this->absolute)
-        return std::filesystem::exists(std::filesystem::path{this->path}.append(name));
-    else
-        return std::filesystem::exists(std::filesystem::current_path().append(this->path).append(name));
+    if (this->isIndexed()) {
+        if (isNormalized(name)) {
+            std::shared_lock lock{this->indexMutex};
+            return this->index.contains(name);
+        }
+        const auto normalized = FilesystemResourceProvider::normalizeName(name);
+        std::shared_lock lock{this->indexMutex};
+        return this->index.contains(normalized);
+    }
+    return std::filesystem::exists(this->getResourcePath(name));
 }
 
 void FilesystemResourceProvider::compileResource(std::string_view name, Resource* resource) const {
-    std::filesystem::path resourcePath;
-    if (this->absolute)
-        resourcePath = std::filesystem::path{this->path}.append(name);
-    else
-        resourcePath = std::filesystem::current_path().append(this->path).append(name);
+    auto resourcePath = this->getResourcePath(name);
+    if (std::filesystem::file_size(resourcePath) >= FilesystemResourceProvider::MAPPED_FILE_MIN_SIZE) {
+        if (auto file = std::make_shared<const MappedFile>(resourcePath.string()); file->isOpen()) {
+            resource->compileMapped(file);
+            return;
+        }
+    }
+    auto bytes = this->readResource(name);
+    resource->compile(bytes.data(), bytes.size());
+}
+
+std::vector<byte> FilesystemResourceProvider::readResource(std::string_view name) const {
+    auto resourcePath = this->getResourcePath(name);
     std::uintmax_t fileSize = std::filesystem::file_size(resourcePath);
     std::ifstream ifs(resourcePath.string().c_str(), std::ios::in | std::ios::binary);
     ifs.seekg(0, std::ios::beg);
-    auto* bytes = new byte[(std::size_t) fileSize + 1];
-    ifs.read(reinterpret_cast<char*>(bytes), static_cast<std::streamsize>(fileSize));
+    std::vector<byte> bytes((std::size_t) fileSize + 1);
+    ifs.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(fileSize));
     bytes[fileSize] = '\0';
-    resource->compile(bytes, (std::size_t) fileSize + 1);
-    delete[] bytes;
+    return bytes;
+}
+
+std::filesystem::path FilesystemResourceProvider::getResourcePath(std::string_view name) const {
+    if (isNormalized(name))
+        return this->getRootPath().append(name);
+    return this->getRootPath().append(FilesystemResourceProvider::normalizeName(name));
+}
+
+std::filesystem::path FilesystemResourceProvider::getRootPath() const {
+    if (this->absolute)
+        return std::filesystem::path{this->path};
+    else
+        return std::filesystem::current_path().append(this->path);
+}
+
+void FilesystemResourceProvider::refreshIndex() {
+    std::scoped_lock refreshLock{this->refreshMutex};
+    {
+        std::unique_lock lock{this->indexMutex};
+        this->refreshing = true;
+    }
+    Index newIndex;
+    std::error_code ec;
+    auto root = this->getRootPath();
+    for (auto it = std::filesystem::recursive_directory_iterator{root, ec}; !ec && it != std::filesystem::recursive_directory_iterator{}; it.increment(ec)) {
+        newIndex.insert(FilesystemResourceProvider::normalizeName(it->path().lexically_relative(root).generic_string()));
+    }
+    std::unique_lock lock{this->indexMutex};
+    // The scan might have passed a folder before or after it changed, replaying the changes in order fixes either case
+    for (const auto& change : this->changesDuringRefresh) {
+        FilesystemResourceProvider::applyIndexChange(newIndex, change);
+    }
+    this->changesDuringRefresh.clear();
+    this->refreshing = false;
+    this->index.swap(newIndex);
+}
+
+void FilesystemResourceProvider::applyIndexChange(Index& index, const IndexChange& change) {
+    if (change.added) {
+        index.insert(change.name);
+        return;
+    }
+    if (auto it = index.find(change.name); it != index.end())
+        index.erase(it);
+    if (change.isDirectory) {
+        std::string prefix = change.name + '/';
+        std::erase_if(index, [&prefix](const std::string& entry) {
+            return entry.starts_with(prefix);
+        });
+    }
+}
+
+void FilesystemResourceProvider::onFileChanged(FileWatcher::Event event, std::string_view name, bool isDirectory) {
+    switch (event) {
+        case FileWatcher::Event::ADDED:
+        case FileWatcher::Event::REMOVED: {
+            IndexChange change{event == FileWatcher::Event::ADDED, FilesystemResourceProvider::normalizeName(name), isDirectory};
+            {
+                std::unique_lock lock{this->indexMutex};
+                FilesystemResourceProvider::applyIndexChange(this->index, change);
+                if (this->refreshing)
+                    this->changesDuringRefresh.push_back(std::move(change));
+            }
+            // Editors often save by moving a new file over the old one
+            if (event == FileWatcher::Event::ADDED && !isDirectory)
+                Resource::markChanged(std::string{this->getName()}.append(RESOURCE_ID_SEPARATOR).append(name));
+            break;
+        }
+        case FileWatcher::Event::OVERFLOWED:
+            this->refreshIndex();
+            break;
+        case FileWatcher::Event::MODIFIED:
+            Resource::markChanged(std::string{this->getName()}.append(RESOURCE_ID_SEPARATOR).append(name));
+            break;
+    }
 }
 
 std::string FilesystemResourceProvider::getFolder() const {
@@ -103,7 +213,7 @@ std::string FilesystemResourceProvider::getLocalResourceAbsolutePath(const std::
     auto name = Resource::splitResourceIdentifier(identifier).second;
     if (!this->hasResource(name))
         return "";
-    auto absPath = (this->absolute ? std::filesystem::path{this->path} : std::filesystem::current_path().append(this->path)).append(name).string();
+    auto absPath = this->getResourcePath(name).string();
     // Replace cringe Windows-style backslashes
     FilesystemResourceProvider::nixifyPath(absPath);
     return absPath;
@@ -113,6 +223,19 @@ void FilesystemResourceProvider::nixifyPath(std::string& path) {
     std::replace(path.begin(), path.end(), '\\', '/');
 }
 
+std::string FilesystemResourceProvider::normalizeName(std::string_view name) {
+    std::string normalized{name};
+    FilesystemResourceProvider::nixifyPath(normalized);
+    normalized = std::filesystem::path{normalized}.lexically_normal().generic_string();
+    normalized = String::stripRight(normalized, '/');
+    if (normalized == ".")
+        normalized.clear();
+#if defined(CHIRA_PLATFORM_WINDOWS) || defined(CHIRA_PLATFORM_APPLE)
+    normalized = String::toLower(normalized);
+#endif
+    return normalized;
+}
+
 std::string FilesystemResourceProvider::getResourceIdentifier(std::string_view absolutePath) {
     // Add the resource provider prefix
     if (auto path = FilesystemResourceProvider::getResourceFolderPath(absolutePath); !path.empty())
@@ -1,5 +1,12 @@
 #pragma once
 
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+#include <vector>
+#include <utility/FileWatcher.h>
 #include <utility/String.h>
 #include "IResourceProvider.h"
 
@@ -11,8 +18,13 @@ const std::string FILESYSTEM_PROVIDER_NAME = "file"; // NOLINT(cert-err58-cpp)
 class FilesystemResourceProvider : public IResourceProvider {
 public:
     explicit FilesystemResourceProvider(std::string path_, bool isPathAbsolute = false, const std::string& name_ = FILESYSTEM_PROVIDER_NAME);
+    /// Answered from an in-memory index of the folder while it is being watched for changes,
+    /// otherwise (or on platforms without a file watcher) the filesystem is checked directly.
+    /// The index is updated asynchronously, call refreshIndex() if a file was just created.
+    /// Names are normalized first, so "./a//b" finds "a/b" (and "A/B" too, on case-insensitive platforms).
     [[nodiscard]] bool hasResource(std::string_view name) const override;
     void compileResource(std::string_view name, Resource* resource) const override;
+    [[nodiscard]] std::vector<byte> readResource(std::string_view name) const override;
     [[nodiscard]] std::string_view getPath() const {
         return this->path;
     }
@@ -21,9 +33,17 @@ public:
     }
     [[nodiscard]] std::string getFolder() const;
     [[nodiscard]] std::string getLocalResourceAbsolutePath(const std::string& identifier) const;
+    /// Rescans the whole folder. Only needed when a change must be visible immediately.
+    void refreshIndex();
+    [[nodiscard]] bool isIndexed() const {
+        return this->watcher && this->watcher->isWatching();
+    }
 
     /// Converts all backslashes in a string to forward slashes.
     static void nixifyPath(std::string& path);
+    /// Resolves a resource name the way the filesystem would: backslashes become forward slashes, "." and empty parts
+    /// are dropped, and there's no trailing slash. On case-insensitive platforms the name is also made lowercase.
+    [[nodiscard]] static std::string normalizeName(std::string_view name);
     /// Takes an absolute path of a resource file and converts it to a resource identifier.
     /// Does not check if the resource identifier actually points to a valid resource.
     static std::string getResourceIdentifier(std::string_view absolutePath);
@@ -35,9 +55,40 @@ public:
     static std::string getResourceAbsolutePath(const std::string& identifier);
 
     static constexpr inline short FILEPATH_MAX_LENGTH = 1024;
+    /// Files at least this big are mapped into memory instead of being read into a buffer.
+    static constexpr inline std::uintmax_t MAPPED_FILE_MIN_SIZE = 64 * 1024;
 private:
     std::string path;
     bool absolute;
+
+    struct IndexHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view name) const noexcept {
+            return std::hash<std::string_view>{}(name);
+        }
+    };
+    using Index = std::unordered_set<std::string, IndexHash, std::equal_to<>>;
+    /// Normalized relative paths of every file and folder inside the provider's folder.
+    Index index;
+    mutable std::shared_mutex indexMutex;
+    /// Only one rescan at a time. Locked before indexMutex, never after
+    std::mutex refreshMutex;
+    struct IndexChange {
+        bool added;
+        std::string name;
+        bool isDirectory;
+    };
+    /// Changes the watcher made to the index while it was being rescanned, the rescan might have missed them.
+    /// Guarded by indexMutex.
+    std::vector<IndexChange> changesDuringRefresh;
+    bool refreshing = false;
+    /// Declared last so it stops before the index is destroyed.
+    std::unique_ptr<FileWatcher> watcher;
+
+    [[nodiscard]] std::filesystem::path getResourcePath(std::string_view name) const;
+    [[nodiscard]] std::filesystem::path getRootPath() const;
+    void onFileChanged(FileWatcher::Event event, std::string_view name, bool isDirectory);
+    static void applyIndexChange(Index& index, const IndexChange& change);
 };
 
 } // namespace chira
@@ -2,6 +2,8 @@
 
 #include <string>
 #include <string_view>
+#include <vector>
+#include <math/Types.h>
 
 namespace chira {
 
@@ -16,6 +18,9 @@ public:
     }
     [[nodiscard]] virtual bool hasResource(std::string_view name) const = 0;
     virtual void compileResource(std::string_view name, Resource* resource) const = 0;
+    /// Returns the contents of a resource exactly as compileResource would pass them to Resource::compile.
+    /// This is called from resource loader threads, so it must not touch anything shared without locking.
+    [[nodiscard]] virtual std::vector<byte> readResource(std::string_view name) const = 0;
 protected:
     std::string providerName;
 };
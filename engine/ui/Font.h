@@ -12,6 +12,10 @@ class Font : public PropertiesResource {
 public:
     explicit Font(const std::string& identifier_) : PropertiesResource(identifier_) {}
     void compile(const nlohmann::json& properties) override;
+    /// Fonts are baked into the ImGui font atlas when the engine starts.
+    bool unloadForReload() override {
+        return false;
+    }
     [[nodiscard]] ImFont* getFont() const;
     [[nodiscard]] const std::string& getName() const;
     [[nodiscard]] float getSize() const;
@@ -7,6 +7,12 @@ using namespace chira;
 ResourceUsageTrackerPanel::ResourceUsageTrackerPanel(ImVec2 windowSize) : IPanel(TR("ui.resource_usage_tracker.title"), false, windowSize) {}
 
 void ResourceUsageTrackerPanel::renderContents() {
+    const auto statistics = Resource::getCacheStatistics();
+    ImGui::TextUnformatted(TRF("ui.resource_usage_tracker.cache_statistics", statistics.hits, statistics.misses, statistics.evictions).c_str());
+    ImGui::TextUnformatted(TRF("ui.resource_usage_tracker.unused_resources", statistics.unusedResources,
+                               static_cast<double>(statistics.unusedBytes) / (1024.0 * 1024.0),
+                               static_cast<double>(statistics.budgetBytes) / (1024.0 * 1024.0)).c_str());
+    ImGui::Separator();
     if (ImGui::BeginTable("Default Resources", 2)) {
         for (const auto& [resourceHash, resource]: Resource::defaultResources) {
             ImGui::TableNextRow();
@@ -18,18 +24,23 @@ void ResourceUsageTrackerPanel::renderContents() {
         ImGui::EndTable();
     }
     ImGui::Separator();
-    if (ImGui::BeginTable("Resources", 3)) {
-        for (const auto& [providerName, resourceMap] : Resource::resources) {
-            for (const auto& [resourceName, resource] : resourceMap) {
-                ImGui::TableNextRow();
-                ImGui::TableSetColumnIndex(0);
-                ImGui::Text("%s", providerName.c_str());
-                ImGui::TableSetColumnIndex(1);
-                ImGui::Text("%s", resourceName.c_str());
-                ImGui::TableSetColumnIndex(2);
-                ImGui::Text("%d", resource.useCount());
-            }
-        }
+    if (ImGui::BeginTable("Resources", 5)) {
+        Resource::resources.forEach([](std::string_view identifier, const SharedPointer<Resource>& resource) {
+            auto separator = identifier.find(RESOURCE_ID_SEPARATOR);
+            auto providerName = identifier.substr(0, separator);
+            auto resourceName = separator == std::string_view::npos ? identifier : identifier.substr(separator + RESOURCE_ID_SEPARATOR.length());
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%.*s", static_cast<int>(providerName.length()), providerName.data());
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.*s", static_cast<int>(resourceName.length()), resourceName.data());
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%d", resource.useCount());
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%.1f KB", static_cast<double>(resource->getCPUMemoryUsage()) / 1024.0);
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%.1f KB", static_cast<double>(resource->getGPUMemoryUsage()) / 1024.0);
+        });
         ImGui::EndTable();
     }
 }
@@ -0,0 +1,135 @@
+#include "FileWatcher.h"
+
+#include <filesystem>
+#include <vector>
+
+#ifdef CHIRA_PLATFORM_LINUX
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+using namespace chira;
+
+#ifdef CHIRA_PLATFORM_LINUX
+
+static constexpr std::uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ONLYDIR;
+
+FileWatcher::FileWatcher(std::string root_, Callback callback_)
+    : root(std::move(root_))
+    , callback(std::move(callback_)) {
+    this->inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (this->inotifyFD < 0)
+        return;
+    if (pipe(this->wakeFDs) != 0) {
+        close(this->inotifyFD);
+        this->inotifyFD = -1;
+        return;
+    }
+    this->watchFolder("", false);
+    if (this->watchedFolders.empty()) {
+        // The root folder doesn't exist (or we can't watch it)
+        close(this->inotifyFD);
+        close(this->wakeFDs[0]);
+        close(this->wakeFDs[1]);
+        this->inotifyFD = -1;
+        return;
+    }
+    this->watching = true;
+    this->thread = std::thread{&FileWatcher::run, this};
+}
+
+FileWatcher::~FileWatcher() {
+    if (!this->watching)
+        return;
+    [[maybe_unused]] auto written = write(this->wakeFDs[1], "", 1);
+    this->thread.join();
+    close(this->inotifyFD);
+    close(this->wakeFDs[0]);
+    close(this->wakeFDs[1]);
+}
+
+void FileWatcher::run() {
+    alignas(inotify_event) char buffer[16 * 1024];
+    pollfd fds[2] = {
+            {this->inotifyFD, POLLIN, 0},
+            {this->wakeFDs[0], POLLIN, 0},
+    };
+    while (true) {
+        if (poll(fds, 2, -1) < 0)
+            continue;
+        if (fds[1].revents)
+            return;
+
+        ssize_t length;
+        while ((length = read(this->inotifyFD, buffer, sizeof(buffer))) > 0) {
+            for (char* ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(ptr)->len) {
+                const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+                if (event->mask & IN_Q_OVERFLOW) {
+                    this->callback(Event::OVERFLOWED, "", true);
+                    continue;
+                }
+                auto folder = this->watchedFolders.find(event->wd);
+                if (folder == this->watchedFolders.end() || !event->len)
+                    continue;
+
+                std::string path = folder->second.empty() ? std::string{event->name} : folder->second + '/' + event->name;
+                bool isDirectory = event->mask & IN_ISDIR;
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    this->callback(Event::ADDED, path, isDirectory);
+                    if (isDirectory)
+                        this->watchFolder(path, true);
+                } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    if (isDirectory)
+                        this->unwatchFolder(path);
+                    this->callback(Event::REMOVED, path, isDirectory);
+                } else if (event->mask & IN_CLOSE_WRITE) {
+                    this->callback(Event::MODIFIED, path, false);
+                }
+            }
+        }
+    }
+}
+
+void FileWatcher::watchFolder(const std::string& path, bool reportContents) {
+    std::filesystem::path folder{this->root};
+    if (!path.empty())
+        folder /= path;
+    int wd = inotify_add_watch(this->inotifyFD, folder.c_str(), WATCH_MASK);
+    if (wd < 0)
+        return;
+    this->watchedFolders[wd] = path;
+
+    // Anything created before the watch was added would be missed otherwise
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator{folder, ec}) {
+        std::string entryPath = path.empty() ? entry.path().filename().string() : path + '/' + entry.path().filename().string();
+        bool isDirectory = entry.is_directory(ec);
+        if (reportContents)
+            this->callback(Event::ADDED, entryPath, isDirectory);
+        if (isDirectory)
+            this->watchFolder(entryPath, reportContents);
+    }
+}
+
+void FileWatcher::unwatchFolder(const std::string& path) {
+    std::string prefix = path + '/';
+    for (auto it = this->watchedFolders.begin(); it != this->watchedFolders.end();) {
+        if (it->second == path || it->second.starts_with(prefix)) {
+            inotify_rm_watch(this->inotifyFD, it->first);
+            it = this->watchedFolders.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+#else
+
+FileWatcher::FileWatcher(std::string root_, Callback callback_)
+    : root(std::move(root_))
+    , callback(std::move(callback_)) {}
+
+FileWatcher::~FileWatcher() = default;
+
+#endif
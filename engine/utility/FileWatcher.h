@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <core/Platform.h>
+
+namespace chira {
+
+/// Watches a folder and everything inside it on a background thread.
+/// Only implemented on Linux (inotify) for now, check isWatching() before relying on it.
+class FileWatcher {
+public:
+    enum class Event {
+        /// A file or folder was created or moved into the tree.
+        /// Folders also report every entry they already contain.
+        ADDED,
+        /// A file or folder was deleted or moved out of the tree.
+        /// Entries inside a removed folder are not reported separately.
+        REMOVED,
+        /// A file was written to and closed.
+        MODIFIED,
+        /// Events were dropped by the OS, the whole tree should be rescanned.
+        OVERFLOWED,
+    };
+    /// Paths are relative to the watched folder and always use forward slashes.
+    /// Called from the watcher thread!
+    using Callback = std::function<void(Event event, std::string_view path, bool isDirectory)>;
+
+    FileWatcher(std::string root_, Callback callback_);
+    ~FileWatcher();
+    FileWatcher(const FileWatcher& other) = delete;
+    FileWatcher& operator=(const FileWatcher& other) = delete;
+    FileWatcher(FileWatcher&& other) noexcept = delete;
+    FileWatcher& operator=(FileWatcher&& other) noexcept = delete;
+
+    [[nodiscard]] bool isWatching() const {
+        return this->watching;
+    }
+    [[nodiscard]] std::string_view getRoot() const {
+        return this->root;
+    }
+private:
+    std::string root;
+    Callback callback;
+    bool watching = false;
+#ifdef CHIRA_PLATFORM_LINUX
+    int inotifyFD = -1;
+    /// Written to when the watcher should stop, so the thread never has to time out.
+    int wakeFDs[2] = {-1, -1};
+    std::unordered_map<int, std::string> watchedFolders;
+    std::thread thread;
+
+    void run();
+    /// Watches a folder and its subfolders, and reports their contents if reportContents is set.
+    void watchFolder(const std::string& path, bool reportContents);
+    void unwatchFolder(const std::string& path);
+#endif
+};
+
+} // namespace chira
@@ -0,0 +1,127 @@
+#include "LZ4.h"
+
+#include <cstdint>
+#include <cstring>
+
+using namespace chira;
+
+// Constants from the LZ4 block format specification
+constexpr std::size_t MIN_MATCH = 4;
+constexpr std::size_t LAST_LITERALS = 5;
+constexpr std::size_t MATCH_FIND_LIMIT = 12;
+constexpr std::size_t MAX_OFFSET = 65535;
+constexpr std::size_t HASH_BITS = 16;
+
+static std::uint32_t read32(const byte* data) {
+    std::uint32_t out;
+    std::memcpy(&out, data, sizeof(out));
+    return out;
+}
+
+static std::uint32_t hash32(std::uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void writeLength(std::vector<byte>& out, std::size_t length) {
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(static_cast<byte>(length));
+}
+
+static void writeSequence(std::vector<byte>& out, const byte* literals, std::size_t literalLength, std::size_t offset, std::size_t matchLength) {
+    const bool lastSequence = matchLength == 0;
+    const std::size_t matchCode = lastSequence ? 0 : matchLength - MIN_MATCH;
+    out.push_back(static_cast<byte>(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15)));
+    if (literalLength >= 15)
+        writeLength(out, literalLength - 15);
+    out.insert(out.end(), literals, literals + literalLength);
+    if (lastSequence)
+        return;
+    out.push_back(static_cast<byte>(offset & 0xff));
+    out.push_back(static_cast<byte>(offset >> 8));
+    if (matchCode >= 15)
+        writeLength(out, matchCode - 15);
+}
+
+std::vector<byte> LZ4::compress(const byte* data, std::size_t size) {
+    std::vector<byte> out;
+    out.reserve(size + size / 255 + 16);
+
+    std::size_t anchor = 0, position = 0;
+    if (size > MATCH_FIND_LIMIT) {
+        // Greedy matching against the last position each 4-byte sequence was seen at
+        std::vector<std::size_t> table(std::size_t{1} << HASH_BITS, SIZE_MAX);
+        const std::size_t matchLimit = size - LAST_LITERALS;
+        while (position + MATCH_FIND_LIMIT < size) {
+            const std::uint32_t sequence = read32(data + position);
+            auto& entry = table[hash32(sequence)];
+            const std::size_t candidate = entry;
+            entry = position;
+            if (candidate == SIZE_MAX || position - candidate > MAX_OFFSET || read32(data + candidate) != sequence) {
+                position++;
+                continue;
+            }
+            std::size_t matchLength = MIN_MATCH;
+            while (position + matchLength < matchLimit && data[candidate + matchLength] == data[position + matchLength])
+                matchLength++;
+            writeSequence(out, data + anchor, position - anchor, position - candidate, matchLength);
+            position += matchLength;
+            anchor = position;
+        }
+    }
+    writeSequence(out, data + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+static bool readLength(const byte* data, std::size_t size, std::size_t& in, std::size_t& length) {
+    byte next;
+    do {
+        if (in >= size)
+            return false;
+        next = data[in++];
+        length += next;
+    } while (next == 255);
+    return true;
+}
+
+bool LZ4::decompress(const byte* data, std::size_t size, byte* output, std::size_t outputSize) {
+    std::size_t in = 0, out = 0;
+    while (in < size) {
+        const byte token = data[in++];
+
+        std::size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(data, size, in, literalLength))
+            return false;
+        if (literalLength > size - in || literalLength > outputSize - out)
+            return false;
+        std::memcpy(output + out, data + in, literalLength);
+        in += literalLength;
+        out += literalLength;
+        if (in == size)
+            break; // The last sequence has no match
+
+        if (size - in < 2)
+            return false;
+        const std::size_t offset = data[in] | (data[in + 1] << 8);
+        in += 2;
+        if (offset == 0 || offset > out)
+            return false;
+        std::size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(data, size, in, matchLength))
+            return false;
+        matchLength += MIN_MATCH;
+        if (matchLength > outputSize - out)
+            return false;
+        if (offset >= matchLength) {
+            std::memcpy(output + out, output + out - offset, matchLength);
+        } else {
+            // Overlapping match, the pattern repeats
+            for (std::size_t i = 0; i < matchLength; i++)
+                output[out + i] = output[out - offset + i];
+        }
+        out += matchLength;
+    }
+    return out == outputSize;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <math/Types.h>
+
+/// Compression using the LZ4 block format: no frame, no checksum, and the uncompressed size must be stored separately.
+/// Decompression is fast enough to run during loading without being noticed.
+namespace chira::LZ4 {
+
+[[nodiscard]] std::vector<byte> compress(const byte* data, std::size_t size);
+
+/// Returns false if the input is corrupt or doesn't decompress to exactly outputSize bytes.
+[[nodiscard]] bool decompress(const byte* data, std::size_t size, byte* output, std::size_t outputSize);
+
+} // namespace chira::LZ4
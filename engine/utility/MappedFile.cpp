@@ -0,0 +1,79 @@
+#include "MappedFile.h"
+
+#ifdef CHIRA_PLATFORM_WINDOWS
+    #define WIN32_LEAN_AND_MEAN
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+using namespace chira;
+
+MappedFile::MappedFile(std::shared_ptr<const MappedFile> parent_, std::size_t offset, std::size_t size_)
+    : parent(std::move(parent_)) {
+    if (this->parent && this->parent->isOpen() && offset <= this->parent->getSize() && size_ <= this->parent->getSize() - offset) {
+        this->data = this->parent->getData() + offset;
+        this->size = size_;
+        this->persistent = this->parent->isPersistent();
+    }
+}
+
+#ifdef CHIRA_PLATFORM_WINDOWS
+
+MappedFile::MappedFile(const std::string& path, bool persistent_)
+    : persistent(persistent_) {
+    this->fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (this->fileHandle == INVALID_HANDLE_VALUE) {
+        this->fileHandle = nullptr;
+        return;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(this->fileHandle, &fileSize) || fileSize.QuadPart == 0)
+        return;
+    this->mappingHandle = CreateFileMappingA(this->fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!this->mappingHandle)
+        return;
+    if (auto* view = MapViewOfFile(this->mappingHandle, FILE_MAP_READ, 0, 0, 0)) {
+        this->data = static_cast<const byte*>(view);
+        this->size = static_cast<std::size_t>(fileSize.QuadPart);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (this->data && !this->parent)
+        UnmapViewOfFile(this->data);
+    if (this->mappingHandle)
+        CloseHandle(this->mappingHandle);
+    if (this->fileHandle)
+        CloseHandle(this->fileHandle);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path, bool persistent_)
+    : persistent(persistent_) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat fileStat{};
+    // Zero-length files can't be mapped
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+        void* view = mmap(nullptr, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED) {
+            this->data = static_cast<const byte*>(view);
+            this->size = static_cast<std::size_t>(fileStat.st_size);
+        }
+    }
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (this->data && !this->parent)
+        munmap(const_cast<byte*>(this->data), this->size);
+}
+
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <core/Platform.h>
+
+namespace chira {
+
+/// A read-only view of a whole file, mapped into memory by the OS.
+/// Pages are loaded on first access, and nothing is copied out of the page cache.
+class MappedFile {
+public:
+    /// Check isOpen() afterwards, mapping can fail (e.g. the file is missing or empty).
+    /// Only mark the file persistent if nothing will write to it while it's mapped, like a packed archive.
+    explicit MappedFile(const std::string& path, bool persistent_ = false);
+    /// A view of part of another mapping, which is kept alive for as long as the view is.
+    MappedFile(std::shared_ptr<const MappedFile> parent_, std::size_t offset, std::size_t size_);
+    ~MappedFile();
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+    MappedFile(MappedFile&& other) noexcept = delete;
+    MappedFile& operator=(MappedFile&& other) noexcept = delete;
+
+    [[nodiscard]] bool isOpen() const {
+        return this->data;
+    }
+    /// Not null-terminated!
+    [[nodiscard]] const byte* getData() const {
+        return this->data;
+    }
+    [[nodiscard]] std::size_t getSize() const {
+        return this->size;
+    }
+    /// If false, the file might be rewritten (e.g. by the editor or while hot reloading), and the mapping
+    /// would change under the reader or fault when the file shrinks. Copy what's needed instead of keeping the mapping.
+    [[nodiscard]] bool isPersistent() const {
+        return this->persistent;
+    }
+private:
+    const byte* data = nullptr;
+    std::size_t size = 0;
+    bool persistent = false;
+    std::shared_ptr<const MappedFile> parent;
+#ifdef CHIRA_PLATFORM_WINDOWS
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+} // namespace chira
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
 #include <core/Assertions.h>
 
 namespace chira {
@@ -12,13 +18,23 @@ enum class CastType {
     C_CAST
 };
 
+struct SharedPointerMetadata;
+
+/// Return true to keep the object alive, the callback's owner is then responsible for it.
+using SharedPointerLastHolderCallback = bool(*)(void* context, SharedPointerMetadata* data);
+
 struct SharedPointerMetadata {
-    unsigned int refCount = 1;
+    std::atomic_uint refCount = 1;
     /// If the refcount is less than or equal to this number in the destructor (after it is subtracted once),
     /// this is the last holder of the pointer and sharedPointer::ptr will be deleted.\n
     /// 1 is the regular value, because this class is intended to be used as a resource, and the resource
     /// manager always holds 1 copy of the pointer.
-    unsigned int holderAmountForDelete = 1;
+    std::atomic_uint holderAmountForDelete = 1;
+    /// True if the pointer was made with SharedPointer::make, so it lives in the same allocation as this.
+    bool inlineStorage = false;
+    /// If set, this is called instead of deleting the object when holderAmountForDelete is reached.
+    std::atomic<SharedPointerLastHolderCallback> onLastHolder = nullptr;
+    void* onLastHolderContext = nullptr;
     SharedPointerMetadata() = default;
     explicit SharedPointerMetadata(unsigned int refCount_) : refCount(refCount_) {}
     SharedPointerMetadata(unsigned int refCount_, unsigned int holderAmountForDelete_) : refCount(refCount_), holderAmountForDelete(holderAmountForDelete_) {}
@@ -28,69 +44,70 @@ struct SharedPointerMetadata {
     SharedPointerMetadata& operator=(SharedPointerMetadata&& other) = delete;
 };
 
+/// Reference counting is atomic, so copies can be made and destroyed from any thread.
+/// The pointer itself is not synchronized: don't assign to the same SharedPointer from two threads.
 template<typename T> class SharedPointer {
+    // To steal the pointer and metadata when converting
+    template<typename U> friend class SharedPointer;
 public:
     SharedPointer() = default;
     explicit SharedPointer(T* inputPtr) : ptr(inputPtr), data(new SharedPointerMetadata{1}) {}
     SharedPointer(T* inputPtr, SharedPointerMetadata* data_) : ptr(inputPtr), data(data_) {
         if (this->data) {
-            this->data->refCount++;
+            this->data->refCount.fetch_add(1, std::memory_order_relaxed);
         }
     }
     SharedPointer<T>& operator=(const SharedPointer<T>& other) noexcept {
         if (this != &other) {
-            if ((this->data) && (this->data->refCount <= this->data->holderAmountForDelete)) {
-                delete this->ptr;
-                delete this->data;
+            // Add the new reference before releasing the old one, they might be the same
+            if (other.data) {
+                other.data->refCount.fetch_add(1, std::memory_order_relaxed);
             }
+            this->release();
             this->ptr = other.ptr;
             this->data = other.data;
-            if (this->data) {
-                this->data->refCount++;
-            }
         }
         return *this;
     }
-    SharedPointer(const SharedPointer<T>& other) noexcept {
-        if (this != &other) {
-            if ((this->data) && (this->data->refCount <= this->data->holderAmountForDelete)) {
-                delete this->ptr;
-                delete this->data;
-            }
-            this->ptr = other.ptr;
-            this->data = other.data;
-            if (this->data) {
-                this->data->refCount++;
-            }
-        }
-    }
+    SharedPointer(const SharedPointer<T>& other) noexcept : SharedPointer(other.ptr, other.data) {}
     SharedPointer<T>& operator=(SharedPointer<T>&& other) noexcept {
-        if ((this->data) && (this->data->refCount <= this->data->holderAmountForDelete)) {
-            delete this->ptr;
-            delete this->data;
+        if (this != &other) {
+            this->release();
+            this->ptr = std::exchange(other.ptr, nullptr);
+            this->data = std::exchange(other.data, nullptr);
         }
-        this->ptr = other.ptr;
-        this->data = other.data;
-        other.ptr = nullptr;
-        other.data = nullptr;
         return *this;
     }
-    SharedPointer(SharedPointer<T>&& other) noexcept {
-        *this = std::move(other);
-    }
+    SharedPointer(SharedPointer<T>&& other) noexcept
+        : ptr(std::exchange(other.ptr, nullptr))
+        , data(std::exchange(other.data, nullptr)) {}
+    /// Moves a pointer to a derived type into a pointer to its base type, without touching the refcount.
+    template<typename U> requires std::convertible_to<U*, T*>
+    SharedPointer(SharedPointer<U>&& other) noexcept // NOLINT(google-explicit-constructor)
+        : ptr(std::exchange(other.ptr, nullptr))
+        , data(std::exchange(other.data, nullptr)) {}
     ~SharedPointer() {
-        if (!this->data) {
-            delete this->ptr;
-            return;
-        }
-        this->data->refCount--;
-        if (this->data->refCount == this->data->holderAmountForDelete) {
-            delete this->ptr;
-        }
-        if (this->data->refCount == 0) {
-            delete this->data;
+        this->release();
+    }
+
+    /// Constructs the object and its metadata in a single allocation.
+    template<typename... Params>
+    [[nodiscard]] static SharedPointer<T> make(Params&&... params) {
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "Over-aligned types can't share an allocation with their metadata");
+        void* block = ::operator new(SharedPointer<T>::INLINE_STORAGE_OFFSET + sizeof(T));
+        auto* metadata = new(block) SharedPointerMetadata{0};
+        metadata->inlineStorage = true;
+        T* object;
+        try {
+            object = new(static_cast<std::byte*>(block) + SharedPointer<T>::INLINE_STORAGE_OFFSET) T{std::forward<Params>(params)...};
+        } catch (...) {
+            std::destroy_at(metadata);
+            ::operator delete(block);
+            throw;
         }
+        return SharedPointer<T>{object, metadata};
     }
+
     T* get() const noexcept {
         return this->ptr;
     }
@@ -108,22 +125,32 @@ public:
     }
     [[nodiscard]] unsigned int useCount() const {
         if (this->data)
-            return this->data->refCount;
+            return this->data->refCount.load(std::memory_order_relaxed);
         else
             return 0;
     }
     [[nodiscard]] unsigned int getHolderAmountForDelete() const {
         if (this->data) {
-            return this->data->holderAmountForDelete;
+            return this->data->holderAmountForDelete.load(std::memory_order_relaxed);
         } else {
             return 0;
         }
     }
     void setHolderAmountForDelete(unsigned int newHolderAmountForDelete) const {
         if (this->data) {
-            this->data->holderAmountForDelete = newHolderAmountForDelete;
+            this->data->holderAmountForDelete.store(newHolderAmountForDelete, std::memory_order_relaxed);
         }
     }
+    /// Set the context before anybody else can see this pointer, it isn't synchronized.
+    void setLastHolderCallback(SharedPointerLastHolderCallback callback, void* context) const {
+        if (this->data) {
+            this->data->onLastHolderContext = context;
+            this->data->onLastHolder.store(callback, std::memory_order_release);
+        }
+    }
+    [[nodiscard]] bool hasLastHolderCallback() const {
+        return this->data && this->data->onLastHolder.load(std::memory_order_relaxed);
+    }
     template<typename U>
     SharedPointer<U> castStatic() const {
         return SharedPointer<U>(static_cast<U*>(this->ptr), this->data);
@@ -159,6 +186,39 @@ public:
 protected:
     T* ptr = nullptr;
     SharedPointerMetadata* data = nullptr;
+
+    static constexpr inline std::size_t INLINE_STORAGE_OFFSET = (sizeof(SharedPointerMetadata) + alignof(T) - 1) / alignof(T) * alignof(T);
+
+    void release() noexcept {
+        if (!this->data) {
+            delete this->ptr;
+            return;
+        }
+        // Once the count is decremented another thread can free the metadata, so read everything beforehand
+        auto* metadata = this->data;
+        const auto holderAmountForDelete = metadata->holderAmountForDelete.load(std::memory_order_relaxed);
+        const auto callback = metadata->onLastHolder.load(std::memory_order_acquire);
+        auto* callbackContext = metadata->onLastHolderContext;
+        const bool inlineStorage = metadata->inlineStorage;
+        const auto remaining = metadata->refCount.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        if (remaining == holderAmountForDelete && this->ptr) {
+            // The remaining holders keep the metadata alive while the callback runs
+            if (!callback || !callback(callbackContext, metadata)) {
+                if (inlineStorage)
+                    std::destroy_at(this->ptr);
+                else
+                    delete this->ptr;
+            }
+        }
+        if (remaining == 0) {
+            if (inlineStorage) {
+                std::destroy_at(metadata);
+                ::operator delete(metadata);
+            } else {
+                delete metadata;
+            }
+        }
+    }
 };
 
 } // namespace chira
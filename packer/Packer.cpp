@@ -0,0 +1,22 @@
+#include <cstdlib>
+#include <iostream>
+#include <core/CommandLine.h>
+#include <resource/provider/ArchiveResourceProvider.h>
+
+using namespace chira;
+
+// Packs a resources folder (e.g. resources/engine) into a single archive for ArchiveResourceProvider
+int main(int argc, const char* const argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <resource folder> <output archive> [--no-compress]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    CommandLine::init(argc, argv);
+
+    if (!ArchiveResourceProvider::createArchive(argv[1], argv[2], !CommandLine::has("--no-compress"))) {
+        std::cerr << "Failed to pack \"" << argv[1] << "\" into \"" << argv[2] << '"' << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Packed \"" << argv[1] << "\" into \"" << argv[2] << '"' << std::endl;
+    return EXIT_SUCCESS;
+}
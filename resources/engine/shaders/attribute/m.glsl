@@ -0,0 +1 @@
+layout (location = 4) in mat4 m;
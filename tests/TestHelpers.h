@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <core/Engine.h>
 #include <core/Logger.h>
 #include <resource/provider/FilesystemResourceProvider.h>
@@ -14,6 +15,11 @@
     chira::Engine::preInit(sizeof argv / sizeof(argv[0]), argv); \
     chira::Resource::addResourceProvider(new chira::FilesystemResourceProvider{"tests"})
 
+/// For benchmarks, record the result with RecordProperty instead of asserting on it
+[[nodiscard]] inline long long microsecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
 #define SETUP_ANGELSCRIPT() chira::AngelScriptVM::init()
 
 #define LOG_BEGIN() \
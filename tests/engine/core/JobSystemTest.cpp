@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <core/JobSystem.h>
+
+using namespace chira;
+
+TEST(JobSystem, runsEveryJob) {
+    JobSystem jobSystem{4};
+    EXPECT_EQ(jobSystem.getThreadCount(), 4);
+
+    std::vector<int> results(1000);
+    JobSystem::JobGroup group;
+    for (int i = 0; i < static_cast<int>(results.size()); i++) {
+        jobSystem.run(group, [&results, i] {
+            results[i] = i * 2;
+        });
+    }
+    jobSystem.wait(group);
+    for (int i = 0; i < static_cast<int>(results.size()); i++) {
+        EXPECT_EQ(results[i], i * 2);
+    }
+}
+
+TEST(JobSystem, runsOnCallingThreadWithoutWorkers) {
+    JobSystem jobSystem{1};
+    EXPECT_EQ(jobSystem.getThreadCount(), 1);
+
+    int count = 0;
+    JobSystem::JobGroup group;
+    for (int i = 0; i < 100; i++) {
+        jobSystem.run(group, [&count] {
+            count++;
+        });
+    }
+    jobSystem.wait(group);
+    EXPECT_EQ(count, 100);
+}
+
+TEST(JobSystem, nestedJobsDoNotDeadlock) {
+    // More waiting jobs than threads, the waiting threads have to run the inner jobs themselves
+    JobSystem jobSystem{2};
+    std::atomic<int> count = 0;
+    JobSystem::JobGroup outer;
+    for (int i = 0; i < 16; i++) {
+        jobSystem.run(outer, [&jobSystem, &count] {
+            JobSystem::JobGroup inner;
+            for (int j = 0; j < 16; j++) {
+                jobSystem.run(inner, [&count] {
+                    count++;
+                });
+            }
+            jobSystem.wait(inner);
+        });
+    }
+    jobSystem.wait(outer);
+    EXPECT_EQ(count, 16 * 16);
+}
+
+TEST(JobSystem, groupsAreIndependent) {
+    JobSystem jobSystem{4};
+    std::atomic<bool> started = false;
+    std::atomic<bool> release = false;
+    std::atomic<int> count = 0;
+
+    JobSystem::JobGroup slow;
+    jobSystem.run(slow, [&started, &release] {
+        started = true;
+        while (!release) {
+            std::this_thread::yield();
+        }
+    });
+    // Make sure a worker has it, otherwise this thread could pick it up while waiting below
+    while (!started) {
+        std::this_thread::yield();
+    }
+    JobSystem::JobGroup fast;
+    for (int i = 0; i < 10; i++) {
+        jobSystem.run(fast, [&count] {
+            count++;
+        });
+    }
+    // Must not wait on the slow group's job
+    jobSystem.wait(fast);
+    EXPECT_EQ(count, 10);
+
+    release = true;
+    jobSystem.wait(slow);
+}
+
+TEST(JobSystem, waitRethrowsJobExceptions) {
+    JobSystem jobSystem{4};
+    std::atomic<int> count = 0;
+    JobSystem::JobGroup group;
+    for (int i = 0; i < 100; i++) {
+        jobSystem.run(group, [&count, i] {
+            if (i % 10 == 0)
+                throw std::runtime_error{"job failed"};
+            count++;
+        });
+    }
+    // Every other job still runs, and the group finishes instead of waiting forever
+    EXPECT_THROW(jobSystem.wait(group), std::runtime_error);
+    EXPECT_EQ(count, 90);
+
+    // The exception was taken out of the group, so it can be used again
+    jobSystem.run(group, [&count] {
+        count++;
+    });
+    EXPECT_NO_THROW(jobSystem.wait(group));
+    EXPECT_EQ(count, 91);
+}
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <TestHelpers.h>
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <entity/root/ArenaGroup.h>
+
+using namespace chira;
+
+TEST(EntityAllocator, reusesFreedSlots) {
+    EntityAllocator::reserve<Entity>(1);
+    const auto before = EntityAllocator::getStatistics();
+    auto* first = new Entity{"first"};
+    EXPECT_EQ(EntityAllocator::getStatistics().liveAllocations, before.liveAllocations + 1);
+    delete first;
+    EXPECT_EQ(EntityAllocator::getStatistics().liveAllocations, before.liveAllocations);
+
+    // The most recently freed slot is handed out first
+    auto* second = new Entity{"second"};
+    EXPECT_EQ(static_cast<void*>(second), static_cast<void*>(first));
+    EXPECT_EQ(EntityAllocator::getStatistics().reservedBytes, before.reservedBytes);
+    delete second;
+}
+
+TEST(EntityAllocator, concurrentAllocations) {
+    const auto before = EntityAllocator::getStatistics();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([t] {
+            // Threads share some sizes and not others
+            const std::size_t sizes[] = {64, 128, 256 + 16 * static_cast<std::size_t>(t)};
+            std::vector<std::pair<void*, std::size_t>> allocations;
+            for (int round = 0; round < 20; round++) {
+                for (int i = 0; i < 500; i++) {
+                    const auto size = sizes[i % 3];
+                    auto* memory = EntityAllocator::allocate(size);
+                    std::memset(memory, t, size);
+                    allocations.emplace_back(memory, size);
+                }
+                for (const auto& [memory, size] : allocations) {
+                    EntityAllocator::deallocate(memory, size);
+                }
+                allocations.clear();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(EntityAllocator::getStatistics().liveAllocations, before.liveAllocations);
+}
+
+TEST(EntityAllocator, arenaGroupOwnsSubtree) {
+    const auto before = EntityAllocator::getStatistics();
+    auto* level = new ArenaGroup{"level"};
+    auto* parent = level->create<Group>("parent");
+    level->addChild(parent);
+    for (int i = 0; i < 10; i++) {
+        parent->addChild(level->create<Entity>(std::to_string(i)));
+    }
+    EXPECT_EQ(level->getArena().getLiveCount(), 11u);
+    // Only the group itself comes from the pools
+    EXPECT_EQ(EntityAllocator::getStatistics().liveAllocations, before.liveAllocations + 1);
+
+    parent->removeChild("0");
+    EXPECT_EQ(level->getArena().getLiveCount(), 10u);
+    delete level;
+    EXPECT_EQ(EntityAllocator::getStatistics().liveAllocations, before.liveAllocations);
+}
+
+TEST(EntityAllocator, buildAndTeardownBenchmark) {
+    constexpr int count = 100000;
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (int i = 0; i < count; i++) {
+        names.push_back(std::to_string(i));
+    }
+
+    // Pooled
+    {
+        const auto before = EntityAllocator::getStatistics();
+        Entity root{"root"};
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& name : names) {
+            root.addChild(new Entity{name});
+        }
+        RecordProperty("pool_build_microseconds", static_cast<int>(microsecondsSince(start)));
+
+        // Delete every other entity, the holes left behind are what fragmentation looks like here
+        for (int i = 0; i < count; i += 2) {
+            root.removeChild(names[i]);
+        }
+        const auto holes = EntityAllocator::getStatistics();
+        const auto reserved = holes.reservedBytes - before.reservedBytes;
+        const auto used = holes.usedBytes - before.usedBytes;
+        ASSERT_GT(reserved, 0u);
+        RecordProperty("pool_fragmentation_percent", static_cast<int>((reserved - used) * 100 / reserved));
+
+        // New entities fill the holes instead of growing the pool
+        for (int i = 0; i < count; i += 2) {
+            root.addChild(new Entity{names[i]});
+        }
+        EXPECT_EQ(EntityAllocator::getStatistics().reservedBytes, holes.reservedBytes);
+
+        start = std::chrono::steady_clock::now();
+        root.removeAllChildren();
+        RecordProperty("pool_teardown_microseconds", static_cast<int>(microsecondsSince(start)));
+        EXPECT_EQ(EntityAllocator::getStatistics().liveAllocations, before.liveAllocations);
+    }
+
+    // Arena
+    {
+        Entity root{"root"};
+        auto* level = new ArenaGroup{"level"};
+        root.addChild(level);
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& name : names) {
+            level->addChild(level->create<Entity>(name));
+        }
+        RecordProperty("arena_build_microseconds", static_cast<int>(microsecondsSince(start)));
+        const auto& arena = level->getArena();
+        RecordProperty("arena_unused_percent", static_cast<int>((arena.getReservedBytes() - arena.getUsedBytes()) * 100 / arena.getReservedBytes()));
+
+        start = std::chrono::steady_clock::now();
+        root.removeChild("level");
+        RecordProperty("arena_teardown_microseconds", static_cast<int>(microsecondsSince(start)));
+        EXPECT_FALSE(root.hasChild("level"));
+    }
+}
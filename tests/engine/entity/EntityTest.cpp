@@ -0,0 +1,335 @@
+#include <gtest/gtest.h>
+#include <TestHelpers.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <core/JobSystem.h>
+#include <entity/Entity.h>
+
+using namespace chira;
+
+TEST(Entity, worldTransformFollowsParent) {
+    Entity root{"root"};
+    auto* child = new Entity{"child"};
+    auto* grandchild = new Entity{"grandchild"};
+    root.addChild(child);
+    child->addChild(grandchild);
+    child->setPosition({1, 0, 0});
+    grandchild->setPosition({0, 2, 0});
+    root.updateTransforms();
+    EXPECT_EQ(grandchild->getGlobalPosition(), (glm::vec3{1, 2, 0}));
+
+    // The cached matrix waits for the next update, the global position doesn't
+    root.translate({0, 0, 3});
+    EXPECT_EQ(glm::vec3{grandchild->getWorldMatrix()[3]}, (glm::vec3{1, 2, 0}));
+    EXPECT_EQ(grandchild->getGlobalPosition(), (glm::vec3{1, 2, 3}));
+    root.updateTransforms();
+    EXPECT_EQ(glm::vec3{grandchild->getWorldMatrix()[3]}, (glm::vec3{1, 2, 3}));
+
+    // Parent rotation applies to the child's position
+    child->setRotation(glm::angleAxis(glm::radians(90.f), glm::vec3{0, 0, 1}));
+    root.updateTransforms();
+    EXPECT_NEAR(grandchild->getGlobalPosition().x, -1.f, 0.0001f);
+    EXPECT_NEAR(grandchild->getGlobalPosition().y, 0.f, 0.0001f);
+    EXPECT_NEAR(grandchild->getGlobalPosition().z, 3.f, 0.0001f);
+}
+
+TEST(Entity, childLookupByName) {
+    Entity root{"root"};
+    auto* a = new Entity{"a"};
+    auto* b = new Entity{"b"};
+    auto* c = new Entity{"c"};
+    root.addChild(a);
+    root.addChild(b);
+    root.addChild(c);
+    EXPECT_EQ(root.getChild("b"), b);
+    EXPECT_FALSE(root.hasChild("d"));
+
+    // Duplicate names are rejected
+    auto* duplicate = new Entity{"a"};
+    root.addChild(duplicate);
+    EXPECT_EQ(root.getChild("a"), a);
+    delete duplicate;
+
+    // The last child takes the removed child's place and must still be found
+    root.removeChild("a");
+    EXPECT_FALSE(root.hasChild("a"));
+    EXPECT_EQ(root.getChild("b"), b);
+    EXPECT_EQ(root.getChild("c"), c);
+    root.removeChild(c->getName());
+    EXPECT_FALSE(root.hasChild("c"));
+    EXPECT_EQ(root.getChild("b"), b);
+    root.removeChild("missing");
+
+    root.removeAllChildren();
+    EXPECT_FALSE(root.hasChild("b"));
+}
+
+TEST(Entity, childLookupBenchmark) {
+    constexpr int count = 100000;
+    Entity root{"root"};
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (int i = 0; i < count; i++) {
+        names.push_back(std::to_string(i));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& name : names) {
+        root.addChild(new Entity{name});
+    }
+    RecordProperty("add_microseconds", static_cast<int>(microsecondsSince(start)));
+
+    start = std::chrono::steady_clock::now();
+    int found = 0;
+    for (const auto& name : names) {
+        found += root.hasChild(name);
+    }
+    RecordProperty("lookup_microseconds", static_cast<int>(microsecondsSince(start)));
+    EXPECT_EQ(found, count);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i += 2) {
+        root.removeChild(names[i]);
+    }
+    RecordProperty("remove_half_microseconds", static_cast<int>(microsecondsSince(start)));
+    for (int i = 0; i < count; i += 1000) {
+        EXPECT_FALSE(root.hasChild(names[i]));
+        EXPECT_EQ(root.getChild(names[i + 1])->getName(), names[i + 1]);
+    }
+}
+
+TEST(Entity, deepHierarchyBenchmark) {
+    constexpr int depth = 1000;
+    Entity root{"root"};
+    Entity* leaf = &root;
+    for (int i = 0; i < depth; i++) {
+        auto* child = new Entity{std::to_string(i)};
+        child->setPosition({1, 0, 0});
+        leaf->addChild(child);
+        leaf = child;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    root.updateTransforms();
+    RecordProperty("full_update_microseconds", static_cast<int>(microsecondsSince(start)));
+    EXPECT_FLOAT_EQ(leaf->getGlobalPosition().x, static_cast<float>(depth));
+
+    start = std::chrono::steady_clock::now();
+    root.updateTransforms();
+    RecordProperty("clean_update_microseconds", static_cast<int>(microsecondsSince(start)));
+
+    leaf->translate({0, 1, 0});
+    start = std::chrono::steady_clock::now();
+    root.updateTransforms();
+    RecordProperty("leaf_moved_update_microseconds", static_cast<int>(microsecondsSince(start)));
+    EXPECT_FLOAT_EQ(leaf->getGlobalPosition().y, 1.f);
+}
+
+TEST(Entity, wideHierarchyBenchmark) {
+    constexpr int width = 100000;
+    Entity root{"root"};
+    std::vector<Entity*> children;
+    children.reserve(width);
+    for (int i = 0; i < width; i++) {
+        auto* child = new Entity{std::to_string(i)};
+        child->setPosition({static_cast<float>(i), 0, 0});
+        root.addChild(child);
+        children.push_back(child);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    root.updateTransforms();
+    RecordProperty("full_update_microseconds", static_cast<int>(microsecondsSince(start)));
+
+    start = std::chrono::steady_clock::now();
+    root.updateTransforms();
+    RecordProperty("clean_update_microseconds", static_cast<int>(microsecondsSince(start)));
+
+    root.translate({0, 0, 5});
+    start = std::chrono::steady_clock::now();
+    root.updateTransforms();
+    RecordProperty("root_moved_update_microseconds", static_cast<int>(microsecondsSince(start)));
+
+    for (int i = 0; i < width; i += 1000) {
+        EXPECT_EQ(children[i]->getGlobalPosition(), (glm::vec3{static_cast<float>(i), 0, 5}));
+    }
+}
+
+/// Does a bit of busywork and moves itself, like a small game logic update
+class EntityTestWorker : public Entity {
+public:
+    explicit EntityTestWorker(std::string name_) : Entity(std::move(name_)) {
+        this->setUpdateInParallel(true);
+    }
+    void update() override {
+        float value = this->getPosition().x;
+        for (int i = 0; i < 200; i++) {
+            value = value * 0.999f + 0.001f;
+        }
+        this->setPosition({value, 0, 0});
+        this->updates++;
+    }
+    int updates = 0;
+};
+
+TEST(Entity, parallelUpdateRunsEveryChild) {
+    JobSystem jobSystem{4};
+    Entity root{"root"};
+    std::vector<EntityTestWorker*> workers;
+    for (int i = 0; i < 100; i++) {
+        auto* worker = new EntityTestWorker{std::to_string(i)};
+        root.addChild(worker);
+        workers.push_back(worker);
+    }
+    auto* serial = new Entity{"serial"};
+    root.addChild(serial);
+    EXPECT_FALSE(serial->canUpdateInParallel());
+
+    root.updateInParallel(jobSystem);
+    root.updateTransforms();
+    for (const auto* worker : workers) {
+        EXPECT_EQ(worker->updates, 1);
+        EXPECT_GT(worker->getWorldMatrix()[3].x, 0.f);
+    }
+}
+
+TEST(Entity, parallelUpdateDefersTreeChanges) {
+    /// Removes its sibling and adds a new one, which would break the update loop if done right away
+    class EntityTestRemover : public Entity {
+    public:
+        using Entity::Entity;
+        void update() override {
+            this->getParent()->removeChild("victim");
+            Entity::runAtSyncPoint([parent = this->getParent()] {
+                parent->addChild(new Entity{"added"});
+            });
+            this->sawVictim = this->getParent()->hasChild("victim");
+            this->sawAdded = this->getParent()->hasChild("added");
+        }
+        bool sawVictim = false;
+        bool sawAdded = false;
+    };
+
+    JobSystem jobSystem{4};
+    Entity root{"root"};
+    auto* remover = new EntityTestRemover{"remover"};
+    remover->setUpdateInParallel(true);
+    root.addChild(remover);
+    root.addChild(new Entity{"victim"});
+
+    root.updateInParallel(jobSystem);
+    EXPECT_TRUE(remover->sawVictim);
+    EXPECT_FALSE(remover->sawAdded);
+    EXPECT_FALSE(root.hasChild("victim"));
+    EXPECT_TRUE(root.hasChild("added"));
+    EXPECT_FALSE(Entity::isUpdatingInParallel());
+}
+
+TEST(Entity, serialUpdateChangesTreeRightAway) {
+    /// Same as above, but nothing updates in parallel so nothing needs to wait
+    class EntityTestRemover : public Entity {
+    public:
+        using Entity::Entity;
+        void update() override {
+            this->getParent()->removeChild("victim");
+            this->getParent()->addChild(new Entity{"added"});
+            this->sawVictim = this->getParent()->hasChild("victim");
+            this->sawAdded = this->getParent()->hasChild("added");
+        }
+        bool sawVictim = true;
+        bool sawAdded = false;
+    };
+
+    JobSystem jobSystem{4};
+    Entity root{"root"};
+    auto* remover = new EntityTestRemover{"remover"};
+    root.addChild(remover);
+    root.addChild(new Entity{"victim"});
+
+    root.updateInParallel(jobSystem);
+    EXPECT_FALSE(remover->sawVictim);
+    EXPECT_TRUE(remover->sawAdded);
+}
+
+TEST(Entity, parallelUpdateCreatesEntitiesAtSyncPoint) {
+    /// Every update it creates a batch of children and removes one from the batch before
+    class EntityTestSpawner : public Entity {
+    public:
+        explicit EntityTestSpawner(std::string name_) : Entity(std::move(name_)) {
+            this->setUpdateInParallel(true);
+        }
+        void update() override {
+            const int frame = this->frames++;
+            Entity::runAtSyncPoint([this, frame] {
+                for (int i = 0; i < 8; i++) {
+                    this->addChild(new Entity{std::to_string(frame) + '_' + std::to_string(i)});
+                }
+            });
+            if (frame > 0)
+                this->removeChild(std::to_string(frame - 1) + "_0");
+        }
+        int frames = 0;
+    };
+
+    constexpr int spawnerCount = 64;
+    constexpr int frames = 20;
+    JobSystem jobSystem{8};
+    Entity root{"root"};
+    std::vector<EntityTestSpawner*> spawners;
+    for (int i = 0; i < spawnerCount; i++) {
+        auto* spawner = new EntityTestSpawner{std::to_string(i)};
+        root.addChild(spawner);
+        spawners.push_back(spawner);
+    }
+    root.updateTransforms();
+    const auto transformCount = TransformPool::get().getSize();
+
+    for (int frame = 0; frame < frames; frame++) {
+        root.updateInParallel(jobSystem);
+        root.updateTransforms();
+    }
+    // Every frame added 8 children, and every frame but the first removed one
+    constexpr int childCount = frames * 8 - (frames - 1);
+    for (const auto* spawner : spawners) {
+        EXPECT_EQ(spawner->frames, frames);
+        EXPECT_TRUE(spawner->hasChild(std::to_string(frames - 1) + "_0"));
+        EXPECT_FALSE(spawner->hasChild(std::to_string(frames - 2) + "_0"));
+        EXPECT_TRUE(spawner->hasChild(std::to_string(frames - 2) + "_1"));
+    }
+    EXPECT_EQ(TransformPool::get().getSize(), transformCount + spawnerCount * childCount);
+}
+
+TEST(Entity, parallelUpdateScalingBenchmark) {
+    constexpr int count = 20000;
+    constexpr int frames = 10;
+    long long singleThreadMicroseconds = 0;
+    for (unsigned int threads : {1u, 2u, 4u, 8u}) {
+        JobSystem jobSystem{threads};
+        Entity root{"root"};
+        std::vector<EntityTestWorker*> workers;
+        workers.reserve(count);
+        for (int i = 0; i < count; i++) {
+            auto* worker = new EntityTestWorker{std::to_string(i)};
+            root.addChild(worker);
+            workers.push_back(worker);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++) {
+            root.updateInParallel(jobSystem);
+            root.updateTransforms();
+        }
+        const auto microseconds = microsecondsSince(start);
+        RecordProperty("threads_" + std::to_string(threads) + "_microseconds", static_cast<int>(microseconds));
+        if (threads == 1)
+            singleThreadMicroseconds = microseconds;
+        else if (microseconds > 0)
+            RecordProperty("threads_" + std::to_string(threads) + "_speedup_percent", static_cast<int>(singleThreadMicroseconds * 100 / microseconds));
+
+        for (int i = 0; i < count; i += 1000) {
+            EXPECT_EQ(workers[i]->updates, frames);
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <TestHelpers.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <entity/TransformPool.h>
+
+using namespace chira;
+
+TEST(TransformPool, parentCreatedAfterChild) {
+    TransformPool pool;
+    const auto child = pool.create();
+    const auto parent = pool.create();
+    pool.setPosition(child, {0, 1, 0});
+    pool.setPosition(parent, {1, 0, 0});
+    // The parent comes after the child in the pool, so it has to be reordered before updating
+    pool.setParent(child, parent);
+    pool.update();
+    EXPECT_EQ(glm::vec3{pool.getWorldMatrix(child)[3]}, (glm::vec3{1, 1, 0}));
+
+    pool.setPosition(parent, {2, 0, 0});
+    pool.update();
+    EXPECT_EQ(glm::vec3{pool.getWorldMatrix(child)[3]}, (glm::vec3{2, 1, 0}));
+}
+
+TEST(TransformPool, destroyedParent) {
+    TransformPool pool;
+    const auto parent = pool.create();
+    const auto child = pool.create();
+    pool.setParent(child, parent);
+    pool.setPosition(parent, {5, 0, 0});
+    pool.setPosition(child, {0, 0, 1});
+    pool.update();
+    EXPECT_EQ(glm::vec3{pool.getWorldMatrix(child)[3]}, (glm::vec3{5, 0, 1}));
+
+    pool.destroy(parent);
+    pool.update();
+    EXPECT_EQ(pool.getSize(), 1u);
+    EXPECT_EQ(glm::vec3{pool.getWorldMatrix(child)[3]}, (glm::vec3{0, 0, 1}));
+
+    // The destroyed handle gets reused, and must not become the child's parent again
+    const auto reused = pool.create();
+    EXPECT_EQ(reused.id, parent.id);
+    pool.setPosition(reused, {9, 9, 9});
+    pool.update();
+    EXPECT_EQ(glm::vec3{pool.getWorldMatrix(child)[3]}, (glm::vec3{0, 0, 1}));
+}
+
+static void benchmarkFullUpdate(std::size_t count) {
+    TransformPool pool;
+    std::vector<TransformHandle> handles;
+    handles.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+        handles.push_back(pool.create());
+        // A tree where every transform has up to 8 children
+        if (i > 0)
+            pool.setParent(handles[i], handles[(i - 1) / 8]);
+        pool.setPosition(handles[i], {1, 0, 0});
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    pool.update();
+    ::testing::Test::RecordProperty("full_update_microseconds_" + std::to_string(count), static_cast<int>(microsecondsSince(start)));
+
+    // Moving the root changes every world matrix, but no local matrix
+    pool.setPosition(handles[0], {0, 1, 0});
+    start = std::chrono::steady_clock::now();
+    pool.update();
+    ::testing::Test::RecordProperty("root_moved_update_microseconds_" + std::to_string(count), static_cast<int>(microsecondsSince(start)));
+
+    start = std::chrono::steady_clock::now();
+    pool.update();
+    ::testing::Test::RecordProperty("clean_update_microseconds_" + std::to_string(count), static_cast<int>(microsecondsSince(start)));
+
+    EXPECT_EQ(glm::vec3{pool.getWorldMatrix(handles[1])[3]}, (glm::vec3{1, 1, 0}));
+    EXPECT_EQ(glm::vec3{pool.getWorldMatrix(handles[9])[3]}, (glm::vec3{2, 1, 0}));
+}
+
+TEST(TransformPool, benchmark100k) {
+    benchmarkFullUpdate(100000);
+}
+
+TEST(TransformPool, benchmark1M) {
+    benchmarkFullUpdate(1000000);
+}
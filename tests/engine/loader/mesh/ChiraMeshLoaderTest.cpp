@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+#include <TestHelpers.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <loader/mesh/ChiraMeshLoader.h>
+
+using namespace chira;
+
+/// A wavy grid, with unit normals and UVs from 0 to 1
+static void makeGrid(int size, std::vector<Vertex>& vertices, std::vector<Index>& indices) {
+    for (int y = 0; y <= size; y++) {
+        for (int x = 0; x <= size; x++) {
+            const auto angle = static_cast<float>(x) * 0.1f;
+            const auto normalLength = std::sqrt(std::cos(angle) * std::cos(angle) + 1.f);
+            vertices.emplace_back(glm::vec3{static_cast<float>(x), std::sin(angle), static_cast<float>(y)},
+                                  ColorRGB{-std::cos(angle) / normalLength, 1.f / normalLength, 0.f},
+                                  ColorRG{static_cast<float>(x) / size, static_cast<float>(y) / size});
+        }
+    }
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            const auto a = static_cast<Index>(y * (size + 1) + x);
+            const auto b = a + 1;
+            const auto c = a + size + 2;
+            const auto d = a + size + 1;
+            indices.insert(indices.end(), {a, b, c, a, c, d});
+        }
+    }
+}
+
+[[nodiscard]] static std::vector<byte> createVersion1(const std::vector<Vertex>& vertices, const std::vector<Index>& indices) {
+    ChiraMeshHeader header;
+    header.version = 1;
+    header.vertexCount = static_cast<unsigned int>(vertices.size());
+    header.indexCount = static_cast<unsigned int>(indices.size());
+    std::vector<byte> out(CHIRA_MESH_HEADER_SIZE + vertices.size() * sizeof(Vertex) + indices.size() * sizeof(Index));
+    std::memcpy(out.data(), &header, CHIRA_MESH_HEADER_SIZE);
+    std::memcpy(out.data() + CHIRA_MESH_HEADER_SIZE, vertices.data(), vertices.size() * sizeof(Vertex));
+    std::memcpy(out.data() + CHIRA_MESH_HEADER_SIZE + vertices.size() * sizeof(Vertex), indices.data(), indices.size() * sizeof(Index));
+    return out;
+}
+
+TEST(ChiraMeshLoader, readsVersion1) {
+    std::vector<Vertex> vertices, loadedVertices;
+    std::vector<Index> indices, loadedIndices;
+    makeGrid(8, vertices, indices);
+    const auto data = createVersion1(vertices, indices);
+    ASSERT_TRUE(ChiraMeshLoader::loadMeshData("v1", data.data(), data.size(), loadedVertices, loadedIndices));
+    EXPECT_EQ(loadedVertices, vertices);
+    EXPECT_EQ(loadedIndices, indices);
+}
+
+TEST(ChiraMeshLoader, version2RoundTrip) {
+    std::vector<Vertex> vertices;
+    std::vector<Index> indices;
+    makeGrid(16, vertices, indices);
+
+    // The default options, which converting a mesh uses, change nothing
+    {
+        const auto data = ChiraMeshLoader{}.createMesh(vertices, indices);
+        std::vector<Vertex> loadedVertices;
+        std::vector<Index> loadedIndices;
+        ASSERT_TRUE(ChiraMeshLoader::loadMeshData("exact", data.data(), data.size(), loadedVertices, loadedIndices));
+        EXPECT_EQ(loadedVertices, vertices);
+        EXPECT_EQ(loadedIndices, indices);
+    }
+    // Quantized, compressed and with meshlets, within the precision of the quantized formats
+    {
+        const auto data = ChiraMeshLoader::createMesh(vertices, indices, {.quantize = true, .compress = true, .meshlets = true});
+        std::vector<Vertex> loadedVertices;
+        std::vector<Index> loadedIndices;
+        ASSERT_TRUE(ChiraMeshLoader::loadMeshData("quantized", data.data(), data.size(), loadedVertices, loadedIndices));
+        ASSERT_EQ(loadedVertices.size(), vertices.size());
+        EXPECT_EQ(loadedIndices, indices);
+        for (std::size_t i = 0; i < vertices.size(); i++) {
+            EXPECT_EQ(loadedVertices[i].position, vertices[i].position);
+            EXPECT_NEAR(loadedVertices[i].normal.r, vertices[i].normal.r, 0.001f);
+            EXPECT_NEAR(loadedVertices[i].normal.g, vertices[i].normal.g, 0.001f);
+            EXPECT_NEAR(loadedVertices[i].normal.b, vertices[i].normal.b, 0.001f);
+            EXPECT_NEAR(loadedVertices[i].color.r, vertices[i].color.r, 1.f / 255);
+            EXPECT_NEAR(loadedVertices[i].uv.r, vertices[i].uv.r, 0.001f);
+            EXPECT_NEAR(loadedVertices[i].uv.g, vertices[i].uv.g, 0.001f);
+        }
+    }
+}
+
+TEST(ChiraMeshLoader, sectionsAreAligned) {
+    std::vector<Vertex> vertices;
+    std::vector<Index> indices;
+    makeGrid(5, vertices, indices);
+    const auto data = ChiraMeshLoader::createMesh(vertices, indices, {});
+    ChiraMeshHeaderV2 header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    EXPECT_EQ(header.version, 2u);
+    ASSERT_EQ(header.sectionCount, 5u);
+    for (std::uint32_t i = 0; i < header.sectionCount; i++) {
+        ChiraMeshSection section;
+        std::memcpy(&section, data.data() + sizeof(header) + i * sizeof(section), sizeof(section));
+        EXPECT_EQ(section.dataOffset % CHIRA_MESH_SECTION_ALIGNMENT, 0u);
+        EXPECT_EQ(section.compression, ChiraMeshCompression::NONE);
+        // Few enough vertices for 16-bit indices
+        if (section.type == ChiraMeshSectionType::INDICES)
+            EXPECT_EQ(section.encoding, ChiraMeshEncoding::UINT16);
+    }
+}
+
+TEST(ChiraMeshLoader, rejectsCorruptData) {
+    std::vector<Vertex> vertices, loadedVertices;
+    std::vector<Index> indices, loadedIndices;
+    makeGrid(4, vertices, indices);
+    auto data = ChiraMeshLoader::createMesh(vertices, indices, {});
+    data[data.size() / 2] ^= 0xff;
+    EXPECT_FALSE(ChiraMeshLoader::loadMeshData("corrupt", data.data(), data.size(), loadedVertices, loadedIndices));
+    EXPECT_FALSE(ChiraMeshLoader::loadMeshData("truncated", data.data(), 10, loadedVertices, loadedIndices));
+}
+
+/// Lets a test edit the header or section table of a version 2 mesh, then fixes the checksum up so only the edit is wrong
+template<typename Edit>
+[[nodiscard]] static std::vector<byte> editVersion2(std::vector<byte> data, Edit edit) {
+    ChiraMeshHeaderV2 header;
+    std::memcpy(&header, data.data(), sizeof(ChiraMeshHeaderV2));
+    std::vector<ChiraMeshSection> table(header.sectionCount);
+    std::memcpy(table.data(), data.data() + sizeof(ChiraMeshHeaderV2), sizeof(ChiraMeshSection) * table.size());
+    edit(header, table);
+    std::memcpy(data.data() + sizeof(ChiraMeshHeaderV2), table.data(), sizeof(ChiraMeshSection) * table.size());
+
+    header.checksum = 14695981039346656037ull;
+    for (std::size_t i = sizeof(ChiraMeshHeaderV2); i < data.size(); i++) {
+        header.checksum ^= data[i];
+        header.checksum *= 1099511628211ull;
+    }
+    std::memcpy(data.data(), &header, sizeof(ChiraMeshHeaderV2));
+    return data;
+}
+
+TEST(ChiraMeshLoader, rejectsMalformedData) {
+    std::vector<Vertex> vertices, loadedVertices;
+    std::vector<Index> indices, loadedIndices;
+    makeGrid(4, vertices, indices);
+    const auto data = ChiraMeshLoader::createMesh(vertices, indices, {});
+    const auto compressedData = ChiraMeshLoader::createMesh(vertices, indices, {.compress = true});
+    ASSERT_TRUE(ChiraMeshLoader::loadMeshData("valid", data.data(), data.size(), loadedVertices, loadedIndices));
+
+    // Counts far bigger than the file must be rejected before anything is allocated for them
+    const auto hugeVertexCount = editVersion2(data, [](ChiraMeshHeaderV2& header, std::vector<ChiraMeshSection>&) {
+        header.vertexCount = 0xffffffff;
+    });
+    EXPECT_FALSE(ChiraMeshLoader::loadMeshData("huge vertex count", hugeVertexCount.data(), hugeVertexCount.size(), loadedVertices, loadedIndices));
+    const auto hugeIndexCount = editVersion2(data, [](ChiraMeshHeaderV2& header, std::vector<ChiraMeshSection>&) {
+        header.indexCount = 0xffffffff;
+    });
+    EXPECT_FALSE(ChiraMeshLoader::loadMeshData("huge index count", hugeIndexCount.data(), hugeIndexCount.size(), loadedVertices, loadedIndices));
+
+    // Even when the sections claim to be just as big, compressed data can only expand so far
+    const auto hugeCompressedSection = editVersion2(compressedData, [](ChiraMeshHeaderV2& header, std::vector<ChiraMeshSection>& table) {
+        header.vertexCount = 0x10000000;
+        for (auto& section : table) {
+            if (section.type == ChiraMeshSectionType::POSITIONS) {
+                section.size = static_cast<std::uint64_t>(header.vertexCount) * sizeof(float) * 3;
+                section.compression = ChiraMeshCompression::LZ4;
+            }
+        }
+    });
+    EXPECT_FALSE(ChiraMeshLoader::loadMeshData("huge compressed section", hugeCompressedSection.data(), hugeCompressedSection.size(), loadedVertices, loadedIndices));
+
+    // A mesh without positions or indices isn't a mesh
+    for (const auto type : {ChiraMeshSectionType::POSITIONS, ChiraMeshSectionType::INDICES}) {
+        const auto missingSection = editVersion2(data, [type](ChiraMeshHeaderV2&, std::vector<ChiraMeshSection>& table) {
+            for (auto& section : table) {
+                if (section.type == type)
+                    section.type = ChiraMeshSectionType::LOD_INDICES;
+            }
+        });
+        EXPECT_FALSE(ChiraMeshLoader::loadMeshData("missing section", missingSection.data(), missingSection.size(), loadedVertices, loadedIndices));
+    }
+
+    // Sections that don't match the counts in the header
+    const auto wrongSize = editVersion2(data, [](ChiraMeshHeaderV2& header, std::vector<ChiraMeshSection>&) {
+        header.vertexCount++;
+    });
+    EXPECT_FALSE(ChiraMeshLoader::loadMeshData("wrong size", wrongSize.data(), wrongSize.size(), loadedVertices, loadedIndices));
+}
+
+TEST(ChiraMeshLoader, loadBenchmark) {
+    std::vector<Vertex> vertices;
+    std::vector<Index> indices;
+    makeGrid(500, vertices, indices);
+
+    const auto benchmark = [this, &vertices, &indices](const std::string& name, const std::vector<byte>& data) {
+        std::vector<Vertex> loadedVertices;
+        std::vector<Index> loadedIndices;
+        const auto start = std::chrono::steady_clock::now();
+        EXPECT_TRUE(ChiraMeshLoader::loadMeshData(name, data.data(), data.size(), loadedVertices, loadedIndices));
+        RecordProperty(name + "_load_microseconds", static_cast<int>(microsecondsSince(start)));
+        RecordProperty(name + "_kilobytes", static_cast<int>(data.size() / 1024));
+        EXPECT_EQ(loadedVertices.size(), vertices.size());
+        EXPECT_EQ(loadedIndices.size(), indices.size());
+    };
+    benchmark("v1", createVersion1(vertices, indices));
+    benchmark("v2", ChiraMeshLoader::createMesh(vertices, indices, {.quantize = false}));
+    benchmark("v2_quantized", ChiraMeshLoader::createMesh(vertices, indices, {.quantize = true}));
+    benchmark("v2_quantized_compressed", ChiraMeshLoader::createMesh(vertices, indices, {.quantize = true, .compress = true}));
+}
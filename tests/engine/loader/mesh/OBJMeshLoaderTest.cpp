@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include <TestHelpers.h>
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <core/JobSystem.h>
+#include <loader/mesh/OBJMeshLoader.h>
+#include <resource/Resource.h>
+
+using namespace chira;
+
+/// A grid of quads with positions, UVs and normals, split into triangles
+[[nodiscard]] static std::string makeGridOBJ(int size) {
+    std::string obj = "# generated\no grid\n";
+    for (int y = 0; y <= size; y++) {
+        for (int x = 0; x <= size; x++) {
+            obj += "v " + std::to_string(x * 0.25f) + " 0.000000 " + std::to_string(y * 0.25f) + '\n';
+            obj += "vt " + std::to_string(static_cast<float>(x) / size) + ' ' + std::to_string(static_cast<float>(y) / size) + '\n';
+        }
+    }
+    obj += "vn 0.000000 1.000000 0.000000\n";
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            const auto a = std::to_string(y * (size + 1) + x + 1);
+            const auto b = std::to_string(y * (size + 1) + x + 2);
+            const auto c = std::to_string((y + 1) * (size + 1) + x + 2);
+            const auto d = std::to_string((y + 1) * (size + 1) + x + 1);
+            obj += "f " + a + '/' + a + "/1 " + b + '/' + b + "/1 " + c + '/' + c + "/1\n";
+            obj += "f " + a + '/' + a + "/1 " + c + '/' + c + "/1 " + d + '/' + d + "/1\n";
+        }
+    }
+    return obj;
+}
+
+/// How the loader used to read OBJ files, minus the vertex deduplication.
+/// Returns the triangle count, assuming every corner has a UV and a normal.
+[[nodiscard]] static std::size_t parseWithStreams(const std::string& data) {
+    std::vector<glm::vec3> positions;
+    std::vector<ColorRG> uvs;
+    std::vector<ColorRGB> normals;
+    std::size_t faceIndices = 0;
+    std::istringstream stream{data};
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (line.substr(0, 2) == "v ") {
+            glm::vec3 pos;
+            std::istringstream iss(line.substr(2));
+            iss >> pos.x >> pos.y >> pos.z;
+            positions.push_back(pos);
+        } else if (line.substr(0, 3) == "vt ") {
+            ColorRG uv;
+            std::istringstream iss(line.substr(3));
+            iss >> uv.r >> uv.g;
+            uvs.push_back(uv);
+        } else if (line.substr(0, 3) == "vn ") {
+            ColorRGB normal;
+            std::istringstream iss(line.substr(3));
+            iss >> normal.r >> normal.g >> normal.b;
+            normals.push_back(normal);
+        } else if (line.substr(0, 2) == "f ") {
+            std::string face = line.substr(2);
+            std::replace(face.begin(), face.end(), '/', ' ');
+            std::istringstream iss(face);
+            int index;
+            while (iss >> index) {
+                faceIndices++;
+            }
+        }
+    }
+    return faceIndices / 9;
+}
+
+TEST(OBJMeshLoader, parsesElements) {
+    OBJMeshLoader::OBJData data;
+    OBJMeshLoader::parse("# comment\r\n"
+                         "v 1 2 3\r\n"
+                         "v +4.5 -5e1 6\n"
+                         "  v 7 8 9 1.0\n"
+                         "vt 0.5 0.25\n"
+                         "vn 0 0 1\n"
+                         "usemtl whatever\n"
+                         "f 1/1/1 2/1/1 3/1/1\n", data);
+    ASSERT_EQ(data.positions.size(), 3u);
+    EXPECT_FLOAT_EQ(data.positions[1].x, 4.5f);
+    EXPECT_FLOAT_EQ(data.positions[1].y, -50.f);
+    EXPECT_FLOAT_EQ(data.positions[2].z, 9.f);
+    ASSERT_EQ(data.uvs.size(), 1u);
+    EXPECT_FLOAT_EQ(data.uvs[0].g, 0.25f);
+    ASSERT_EQ(data.normals.size(), 1u);
+    EXPECT_FLOAT_EQ(data.normals[0].b, 1.f);
+    ASSERT_EQ(data.corners.size(), 3u);
+    EXPECT_EQ(data.corners[2].position, 2);
+    EXPECT_EQ(data.corners[2].uv, 0);
+    EXPECT_EQ(data.corners[2].normal, 0);
+}
+
+TEST(OBJMeshLoader, parsesPolygonsAndNegativeIndices) {
+    OBJMeshLoader::OBJData data;
+    OBJMeshLoader::parse("v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+                         "vn 0 0 1\n"
+                         "f -4//-1 -3//-1 -2//-1 -1//-1 # a quad\n"
+                         "f 1 2 3\n", data);
+    // The quad is split into two triangles sharing its first corner
+    ASSERT_EQ(data.corners.size(), 9u);
+    EXPECT_EQ(data.corners[0].position, 0);
+    EXPECT_EQ(data.corners[1].position, 1);
+    EXPECT_EQ(data.corners[2].position, 2);
+    EXPECT_EQ(data.corners[3].position, 0);
+    EXPECT_EQ(data.corners[4].position, 2);
+    EXPECT_EQ(data.corners[5].position, 3);
+    EXPECT_EQ(data.corners[0].normal, 0);
+    EXPECT_EQ(data.corners[0].uv, -1);
+    // Missing UVs and normals
+    EXPECT_EQ(data.corners[8].uv, -1);
+    EXPECT_EQ(data.corners[8].normal, -1);
+}
+
+TEST(OBJMeshLoader, loadMeshSharesExistingVertices) {
+    PREINIT_ENGINE();
+
+    OBJMeshLoader loader;
+    std::vector<Vertex> vertices;
+    std::vector<Index> indices;
+    loader.loadMesh("file://quad.obj", vertices, indices);
+    ASSERT_EQ(vertices.size(), 4u);
+    ASSERT_EQ(indices.size(), 6u);
+
+    // Loading the same mesh on top of itself shouldn't add any vertices
+    loader.loadMesh("file://quad.obj", vertices, indices);
+    EXPECT_EQ(vertices.size(), 4u);
+    ASSERT_EQ(indices.size(), 12u);
+    EXPECT_TRUE(std::equal(indices.begin(), indices.begin() + 6, indices.begin() + 6));
+
+    Resource::discardAll();
+}
+
+TEST(OBJMeshLoader, parallelParseMatchesSerialParse) {
+    // Relative indices across chunk boundaries are the tricky part
+    std::string obj;
+    for (int i = 0; i < 300000; i++) {
+        obj += "v " + std::to_string(i) + " 0 0\nvn 0 1 0\n";
+        if (i >= 2)
+            obj += "f -3//-1 -2//-1 -1//-1\n";
+    }
+    OBJMeshLoader::OBJData serial, parallel;
+    OBJMeshLoader::parse(obj, serial);
+    JobSystem jobSystem{8};
+    OBJMeshLoader::parse(obj, parallel, &jobSystem);
+
+    ASSERT_EQ(serial.positions.size(), parallel.positions.size());
+    ASSERT_EQ(serial.corners.size(), parallel.corners.size());
+    for (std::size_t i = 0; i < serial.positions.size(); i++) {
+        ASSERT_EQ(serial.positions[i].x, parallel.positions[i].x);
+    }
+    for (std::size_t i = 0; i < serial.corners.size(); i++) {
+        ASSERT_EQ(serial.corners[i].position, parallel.corners[i].position);
+        ASSERT_EQ(serial.corners[i].normal, parallel.corners[i].normal);
+    }
+    EXPECT_EQ(serial.corners.back().position, 299999);
+}
+
+TEST(OBJMeshLoader, parseThroughputBenchmark) {
+    const auto obj = makeGridOBJ(400);
+    const auto megabytes = static_cast<double>(obj.size()) / (1024 * 1024);
+    const auto recordThroughput = [this, megabytes](const char* name, long long microseconds) {
+        RecordProperty(name, static_cast<int>(megabytes / (static_cast<double>(std::max(microseconds, 1LL)) / 1000000)));
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    const auto streamTriangles = parseWithStreams(obj);
+    recordThroughput("streams_megabytes_per_second", microsecondsSince(start));
+
+    OBJMeshLoader::OBJData serial;
+    start = std::chrono::steady_clock::now();
+    OBJMeshLoader::parse(obj, serial);
+    recordThroughput("serial_megabytes_per_second", microsecondsSince(start));
+    EXPECT_EQ(serial.corners.size() / 3, streamTriangles);
+
+    JobSystem jobSystem;
+    OBJMeshLoader::OBJData parallel;
+    start = std::chrono::steady_clock::now();
+    OBJMeshLoader::parse(obj, parallel, &jobSystem);
+    recordThroughput("parallel_megabytes_per_second", microsecondsSince(start));
+    EXPECT_EQ(parallel.corners.size(), serial.corners.size());
+}
@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+#include <TestHelpers.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+#include <math/BVH.h>
+
+using namespace chira;
+
+[[nodiscard]] static std::vector<AABB> makeBoxes(std::size_t count, unsigned int seed) {
+    std::mt19937 random{seed};
+    std::uniform_real_distribution<float> positionDistribution{-500.f, 500.f};
+    std::uniform_real_distribution<float> sizeDistribution{0.1f, 2.f};
+    std::vector<AABB> boxes;
+    boxes.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+        const glm::vec3 center{positionDistribution(random), positionDistribution(random), positionDistribution(random)};
+        boxes.push_back({center - sizeDistribution(random), center + sizeDistribution(random)});
+    }
+    return boxes;
+}
+
+TEST(BVH, queriesMatchBruteForce) {
+    const auto boxes = makeBoxes(5000, 1);
+    BVH bvh;
+    for (const auto& box : boxes)
+        static_cast<void>(bvh.insert(box));
+    bvh.commit();
+    ASSERT_EQ(bvh.getObjectCount(), boxes.size());
+
+    const Frustum frustum{glm::perspective(glm::radians(60.f), 1.f, 0.1f, 400.f) * glm::lookAt(glm::vec3{0}, glm::vec3{1, 0, 0}, glm::vec3{0, 1, 0})};
+    std::vector<BVH::ObjectID> found;
+    bvh.queryFrustum(frustum, found);
+    std::sort(found.begin(), found.end());
+    std::vector<BVH::ObjectID> expected;
+    for (BVH::ObjectID i = 0; i < boxes.size(); i++) {
+        if (frustum.intersects(boxes[i]))
+            expected.push_back(i);
+    }
+    EXPECT_EQ(found, expected);
+
+    found.clear();
+    bvh.querySphere(glm::vec3{0}, 100.f, found);
+    std::sort(found.begin(), found.end());
+    expected.clear();
+    for (BVH::ObjectID i = 0; i < boxes.size(); i++) {
+        const auto offset = glm::clamp(glm::vec3{0}, boxes[i].min, boxes[i].max);
+        if (glm::dot(offset, offset) <= 100.f * 100.f)
+            expected.push_back(i);
+    }
+    EXPECT_EQ(found, expected);
+
+    // Ray from outside the scene straight at the first box
+    const glm::vec3 origin{-1000.f, 0.f, 0.f};
+    const auto direction = boxes[0].getCenter() - origin;
+    float distance = 0.f;
+    const auto hit = bvh.raycast(origin, direction, &distance);
+    ASSERT_NE(hit, BVH::INVALID_ID);
+    EXPECT_LE(distance, 1.f);
+    EXPECT_EQ(bvh.raycast(origin, -direction), BVH::INVALID_ID);
+}
+
+[[nodiscard]] static std::vector<BVH::ObjectID> sphereBruteForce(const std::vector<AABB>& boxes, const std::vector<bool>& alive, glm::vec3 center, float radius) {
+    std::vector<BVH::ObjectID> expected;
+    for (BVH::ObjectID i = 0; i < boxes.size(); i++) {
+        const auto offset = glm::clamp(center, boxes[i].min, boxes[i].max) - center;
+        if (alive[i] && glm::dot(offset, offset) <= radius * radius)
+            expected.push_back(i);
+    }
+    return expected;
+}
+
+TEST(BVH, incrementalChangesMatchBruteForce) {
+    auto boxes = makeBoxes(5000, 3);
+    std::vector<bool> alive(boxes.size(), true);
+    BVH bvh;
+    for (std::size_t i = 0; i < 4000; i++)
+        static_cast<void>(bvh.insert(boxes[i]));
+    bvh.commit();
+    EXPECT_EQ(bvh.getNodeCount(), 2 * bvh.getObjectCount() - 1);
+
+    // One at a time, so none of these commits rebuild the tree
+    for (std::size_t i = 4000; i < boxes.size(); i++) {
+        static_cast<void>(bvh.insert(boxes[i]));
+        bvh.commit();
+    }
+    for (BVH::ObjectID i = 0; i < boxes.size(); i += 3) {
+        bvh.remove(i);
+        alive[i] = false;
+    }
+    bvh.commit();
+    for (BVH::ObjectID i = 1; i < boxes.size(); i += 50) {
+        boxes[i] = {boxes[i].min + 30.f, boxes[i].max + 30.f};
+        bvh.update(i, boxes[i]);
+    }
+    bvh.commit();
+
+    const auto aliveCount = static_cast<std::size_t>(std::count(alive.begin(), alive.end(), true));
+    ASSERT_EQ(bvh.getObjectCount(), aliveCount);
+    EXPECT_EQ(bvh.getNodeCount(), 2 * aliveCount - 1);
+    for (int i = 0; i < 50; i++) {
+        const glm::vec3 center{static_cast<float>(i * 20 - 500), 0.f, static_cast<float>(250 - i * 10)};
+        std::vector<BVH::ObjectID> found;
+        bvh.querySphere(center, 150.f, found);
+        std::sort(found.begin(), found.end());
+        EXPECT_EQ(found, sphereBruteForce(boxes, alive, center, 150.f));
+    }
+}
+
+TEST(BVH, raycastAlongAxis) {
+    BVH bvh;
+    const auto id = bvh.insert({glm::vec3{9.f, 0.f, -1.f}, glm::vec3{11.f, 2.f, 1.f}});
+    bvh.commit();
+    // The direction has zero components, so the ray runs along the box's faces on those axes
+    float distance = 0.f;
+    EXPECT_EQ(bvh.raycast(glm::vec3{0}, glm::vec3{1.f, 0.f, 0.f}, &distance), id);
+    EXPECT_FLOAT_EQ(distance, 9.f);
+    EXPECT_EQ(bvh.raycast(glm::vec3{0.f, 3.f, 0.f}, glm::vec3{1.f, 0.f, 0.f}), BVH::INVALID_ID);
+}
+
+TEST(BVH, deferredUpdates) {
+    BVH bvh;
+    const auto id = bvh.insert({glm::vec3{-1}, glm::vec3{1}});
+    std::vector<BVH::ObjectID> found;
+    bvh.querySphere(glm::vec3{0}, 1.f, found);
+    EXPECT_TRUE(found.empty());
+
+    bvh.commit();
+    bvh.querySphere(glm::vec3{0}, 1.f, found);
+    EXPECT_EQ(found, std::vector<BVH::ObjectID>{id});
+
+    bvh.update(id, {glm::vec3{99}, glm::vec3{101}});
+    EXPECT_EQ(bvh.getBounds(id), (AABB{glm::vec3{99}, glm::vec3{101}}));
+    bvh.commit();
+    found.clear();
+    bvh.querySphere(glm::vec3{0}, 1.f, found);
+    EXPECT_TRUE(found.empty());
+    bvh.querySphere(glm::vec3{100}, 1.f, found);
+    EXPECT_EQ(found, std::vector<BVH::ObjectID>{id});
+
+    // Removed objects disappear from queries right away
+    bvh.remove(id);
+    EXPECT_TRUE(bvh.getBounds(id).isEmpty());
+    found.clear();
+    bvh.querySphere(glm::vec3{100}, 1.f, found);
+    EXPECT_TRUE(found.empty());
+    bvh.commit();
+    EXPECT_EQ(bvh.getObjectCount(), 0u);
+    EXPECT_EQ(bvh.getNodeCount(), 0u);
+}
+
+TEST(BVH, benchmark100k) {
+    constexpr std::size_t objectCount = 100000;
+    auto boxes = makeBoxes(objectCount, 2);
+    BVH bvh;
+    std::vector<BVH::ObjectID> ids;
+    for (const auto& box : boxes)
+        ids.push_back(bvh.insert(box));
+
+    auto start = std::chrono::steady_clock::now();
+    bvh.build();
+    RecordProperty("build_microseconds", static_cast<int>(microsecondsSince(start)));
+
+    // Nudge everything a little, like a frame of movement
+    for (std::size_t i = 0; i < objectCount; i++) {
+        bvh.update(ids[i], boxes[i].transform(glm::translate(glm::mat4{1.f}, glm::vec3{0.5f, 0.f, 0.f})));
+    }
+    start = std::chrono::steady_clock::now();
+    bvh.refit();
+    RecordProperty("refit_microseconds", static_cast<int>(microsecondsSince(start)));
+
+    const Frustum frustum{glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 1000.f) * glm::lookAt(glm::vec3{0}, glm::vec3{0, 0, -1}, glm::vec3{0, 1, 0})};
+    std::vector<BVH::ObjectID> found;
+    found.reserve(objectCount);
+    start = std::chrono::steady_clock::now();
+    bvh.queryFrustum(frustum, found);
+    RecordProperty("frustum_query_microseconds", static_cast<int>(microsecondsSince(start)));
+    EXPECT_GT(found.size(), 0u);
+    EXPECT_LT(found.size(), objectCount);
+
+    found.clear();
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 1000; i++) {
+        bvh.querySphere(boxes[i].getCenter(), 10.f, found);
+    }
+    RecordProperty("sphere_queries_1000_microseconds", static_cast<int>(microsecondsSince(start)));
+    EXPECT_GE(found.size(), 1000u);
+
+    int hits = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 1000; i++) {
+        if (bvh.raycast(glm::vec3{0}, boxes[i].getCenter() + glm::vec3{0.5f, 0.f, 0.f}) != BVH::INVALID_ID)
+            hits++;
+    }
+    RecordProperty("raycasts_1000_microseconds", static_cast<int>(microsecondsSince(start)));
+    EXPECT_EQ(hits, 1000);
+
+    // Adding one object to a big tree shouldn't cost a rebuild
+    start = std::chrono::steady_clock::now();
+    static_cast<void>(bvh.insert({glm::vec3{-1}, glm::vec3{1}}));
+    bvh.commit();
+    RecordProperty("single_insert_microseconds", static_cast<int>(microsecondsSince(start)));
+    EXPECT_EQ(bvh.getNodeCount(), 2 * bvh.getObjectCount() - 1);
+}
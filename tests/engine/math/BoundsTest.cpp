@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <TestHelpers.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <math/Bounds.h>
+
+using namespace chira;
+
+TEST(Bounds, expandAndTransform) {
+    AABB box;
+    EXPECT_TRUE(box.isEmpty());
+    EXPECT_TRUE(box.transform(glm::translate(glm::mat4{1.f}, glm::vec3{1, 2, 3})).isEmpty());
+
+    box.expand(glm::vec3{-1, -1, -1});
+    box.expand(glm::vec3{1, 1, 1});
+    EXPECT_FALSE(box.isEmpty());
+    EXPECT_EQ(box.getCenter(), glm::vec3{0});
+
+    const auto moved = box.transform(glm::translate(glm::mat4{1.f}, glm::vec3{10, 0, 0}));
+    EXPECT_EQ(moved.min, (glm::vec3{9, -1, -1}));
+    EXPECT_EQ(moved.max, (glm::vec3{11, 1, 1}));
+
+    // A cube rotated 45 degrees around Y is sqrt(2) wide on X and Z
+    const auto rotated = box.transform(glm::rotate(glm::mat4{1.f}, glm::radians(45.f), glm::vec3{0, 1, 0}));
+    EXPECT_NEAR(rotated.max.x, glm::sqrt(2.f), 0.0001f);
+    EXPECT_NEAR(rotated.max.y, 1.f, 0.0001f);
+    EXPECT_NEAR(rotated.max.z, glm::sqrt(2.f), 0.0001f);
+}
+
+TEST(Bounds, frustumIntersects) {
+    const Frustum frustum{glm::perspective(glm::radians(90.f), 1.f, 0.1f, 100.f) * glm::lookAt(glm::vec3{0}, glm::vec3{0, 0, -1}, glm::vec3{0, 1, 0})};
+    const auto boxAt = [](glm::vec3 center) {
+        return AABB{center - glm::vec3{0.5f}, center + glm::vec3{0.5f}};
+    };
+    EXPECT_TRUE(frustum.intersects(boxAt({0, 0, -10})));
+    EXPECT_TRUE(frustum.intersects(boxAt({9.9f, 0, -10})));
+    EXPECT_FALSE(frustum.intersects(boxAt({0, 0, 10})));
+    EXPECT_FALSE(frustum.intersects(boxAt({20, 0, -10})));
+    EXPECT_FALSE(frustum.intersects(boxAt({0, 0, -200})));
+    EXPECT_FALSE(frustum.intersects(AABB{}));
+}
+
+TEST(Bounds, cullLargeScene) {
+    constexpr int objectCount = 100000;
+    std::mt19937 random{4321};
+    std::uniform_real_distribution<float> angleDistribution{0.f, glm::two_pi<float>()};
+    std::uniform_real_distribution<float> radiusDistribution{10.f, 500.f};
+
+    AABB cube;
+    cube.expand(glm::vec3{-0.5f});
+    cube.expand(glm::vec3{0.5f});
+    std::vector<glm::mat4> transforms;
+    transforms.reserve(objectCount);
+    for (int i = 0; i < objectCount; i++) {
+        const float angle = angleDistribution(random), radius = radiusDistribution(random);
+        transforms.push_back(glm::translate(glm::mat4{1.f}, glm::vec3{glm::cos(angle) * radius, 0.f, glm::sin(angle) * radius}));
+    }
+
+    // A 36 degree wide view of objects spread evenly around the camera sees about 10% of them
+    const Frustum frustum{glm::perspective(glm::radians(36.f), 1.f, 0.1f, 1000.f) * glm::lookAt(glm::vec3{0}, glm::vec3{0, 0, -1}, glm::vec3{0, 1, 0})};
+    const auto start = std::chrono::steady_clock::now();
+    int visible = 0;
+    for (const auto& transform : transforms) {
+        if (frustum.intersects(cube.transform(transform)))
+            visible++;
+    }
+    RecordProperty("cull_microseconds", static_cast<int>(microsecondsSince(start)));
+
+    EXPECT_GT(visible, objectCount * 9 / 100);
+    EXPECT_LT(visible, objectCount * 12 / 100);
+}
@@ -0,0 +1,213 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+#include <loader/mesh/ChiraMeshLoader.h>
+#include <math/MeshOptimizer.h>
+
+using namespace chira;
+
+/// A flat grid of quads as two triangles each, row by row
+static void makeGrid(int size, std::vector<Vertex>& vertices, std::vector<Index>& indices) {
+    for (int y = 0; y <= size; y++) {
+        for (int x = 0; x <= size; x++) {
+            vertices.emplace_back(glm::vec3{static_cast<float>(x), 0.f, static_cast<float>(y)}, ColorRGB{0.f, 1.f, 0.f});
+        }
+    }
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            const auto a = static_cast<Index>(y * (size + 1) + x);
+            const auto b = a + 1;
+            const auto c = a + size + 2;
+            const auto d = a + size + 1;
+            indices.insert(indices.end(), {a, b, c, a, c, d});
+        }
+    }
+}
+
+/// A closed box centered on the origin, each side a grid of quads, facing outwards unless inwards is true
+static void makeBox(float halfSize, int size, bool inwards, std::vector<Vertex>& vertices, std::vector<Index>& indices) {
+    for (int axis = 0; axis < 3; axis++) {
+        for (const float side : {-1.f, 1.f}) {
+            const auto first = static_cast<Index>(vertices.size());
+            for (int v = 0; v <= size; v++) {
+                for (int u = 0; u <= size; u++) {
+                    glm::vec3 position;
+                    position[axis] = side * halfSize;
+                    position[(axis + 1) % 3] = halfSize * (2.f * static_cast<float>(u) / static_cast<float>(size) - 1.f);
+                    position[(axis + 2) % 3] = halfSize * (2.f * static_cast<float>(v) / static_cast<float>(size) - 1.f);
+                    vertices.emplace_back(position);
+                }
+            }
+            // Counterclockwise seen from the positive side of the axis
+            const bool flip = (side < 0.f) != inwards;
+            for (int v = 0; v < size; v++) {
+                for (int u = 0; u < size; u++) {
+                    const auto a = first + static_cast<Index>(v * (size + 1) + u);
+                    const auto b = a + 1;
+                    const auto c = a + size + 2;
+                    const auto d = a + size + 1;
+                    if (flip)
+                        indices.insert(indices.end(), {a, c, b, a, d, c});
+                    else
+                        indices.insert(indices.end(), {a, b, c, a, c, d});
+                }
+            }
+        }
+    }
+}
+
+/// Every triangle's corner positions in order, sorted, so meshes can be compared no matter how they're ordered
+[[nodiscard]] static std::vector<std::array<float, 9>> getTriangles(const std::vector<Vertex>& vertices, const std::vector<Index>& indices) {
+    std::vector<std::array<float, 9>> triangles;
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        auto& triangle = triangles.emplace_back();
+        for (std::size_t corner = 0; corner < 3; corner++) {
+            const auto& position = vertices[indices[i + corner]].position;
+            triangle[corner * 3] = position.x;
+            triangle[corner * 3 + 1] = position.y;
+            triangle[corner * 3 + 2] = position.z;
+        }
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+TEST(MeshOptimizer, cacheMetrics) {
+    // Three triangles sharing no vertices transform every vertex once
+    const std::vector<Index> separate{0, 1, 2, 3, 4, 5, 6, 7, 8};
+    EXPECT_FLOAT_EQ(MeshOptimizer::getACMR(separate, 9), 3.f);
+    EXPECT_FLOAT_EQ(MeshOptimizer::getATVR(separate, 9), 1.f);
+
+    // A quad reuses two of its vertices
+    const std::vector<Index> quad{0, 1, 2, 0, 2, 3};
+    EXPECT_FLOAT_EQ(MeshOptimizer::getACMR(quad, 4), 2.f);
+    EXPECT_FLOAT_EQ(MeshOptimizer::getATVR(quad, 4), 1.f);
+
+    // With a cache of three, the first vertex is gone by the time it's used again
+    const std::vector<Index> evicted{0, 1, 2, 3, 4, 5, 0, 1, 2};
+    EXPECT_FLOAT_EQ(MeshOptimizer::getATVR(evicted, 6, 3), 1.5f);
+
+    EXPECT_FLOAT_EQ(MeshOptimizer::getACMR({}, 0), 0.f);
+    EXPECT_FLOAT_EQ(MeshOptimizer::getATVR({}, 0), 0.f);
+}
+
+TEST(MeshOptimizer, vertexCacheOrder) {
+    std::vector<Vertex> vertices;
+    std::vector<Index> indices;
+    makeGrid(100, vertices, indices);
+
+    // Shuffled triangles miss the cache almost every time
+    std::vector<std::size_t> order(indices.size() / 3);
+    for (std::size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937{1234});
+    std::vector<Index> shuffled;
+    for (const auto triangle : order) {
+        shuffled.insert(shuffled.end(), {indices[triangle * 3], indices[triangle * 3 + 1], indices[triangle * 3 + 2]});
+    }
+    EXPECT_GT(MeshOptimizer::getACMR(shuffled, vertices.size()), 2.5f);
+
+    auto optimized = shuffled;
+    MeshOptimizer::optimizeVertexCache(optimized, vertices.size());
+    EXPECT_LT(MeshOptimizer::getACMR(optimized, vertices.size()), 0.75f);
+    EXPECT_LT(MeshOptimizer::getATVR(optimized, vertices.size()), 1.5f);
+    EXPECT_EQ(getTriangles(vertices, optimized), getTriangles(vertices, shuffled));
+
+    // The same input always gives the same output
+    auto again = shuffled;
+    MeshOptimizer::optimizeVertexCache(again, vertices.size());
+    EXPECT_EQ(again, optimized);
+}
+
+TEST(MeshOptimizer, vertexFetchOrder) {
+    std::vector<Vertex> vertices{Vertex{glm::vec3{0, 0, 0}}, Vertex{glm::vec3{1, 0, 0}}, Vertex{glm::vec3{2, 0, 0}}, Vertex{glm::vec3{3, 0, 0}}};
+    std::vector<Index> indices{3, 1, 0, 3, 0, 1};
+    MeshOptimizer::optimizeVertexFetch(vertices, indices);
+
+    // Vertices come in the order they're first used, and vertex 2 isn't used at all
+    ASSERT_EQ(vertices.size(), 3u);
+    EXPECT_EQ(vertices[0].position, (glm::vec3{3, 0, 0}));
+    EXPECT_EQ(vertices[1].position, (glm::vec3{1, 0, 0}));
+    EXPECT_EQ(vertices[2].position, (glm::vec3{0, 0, 0}));
+    EXPECT_EQ(indices, (std::vector<Index>{0, 1, 2, 0, 2, 1}));
+}
+
+TEST(MeshOptimizer, overdrawDrawsOutsideFirst) {
+    std::vector<Vertex> vertices;
+    std::vector<Index> indices;
+    // A box facing inwards inside a box facing outwards, the inner one first.
+    // The outer box's clusters face away from the center and the inner box's towards it, so they sort differently
+    makeBox(1.f, 10, true, vertices, indices);
+    const auto innerTriangles = indices.size() / 3;
+    makeBox(2.f, 10, false, vertices, indices);
+    const auto outerTriangles = indices.size() / 3 - innerTriangles;
+    // How many of the first outerTriangles triangles belong to the outer box
+    const auto countOuterInFront = [&vertices, outerTriangles](const std::vector<Index>& order) {
+        std::size_t count = 0;
+        for (std::size_t triangle = 0; triangle < outerTriangles; triangle++) {
+            const auto& position = vertices[order[triangle * 3]].position;
+            if (std::max({std::abs(position.x), std::abs(position.y), std::abs(position.z)}) > 1.5f)
+                count++;
+        }
+        return count;
+    };
+
+    MeshOptimizer::optimizeVertexCache(indices, vertices.size());
+    const auto before = indices;
+    const auto acmr = MeshOptimizer::getACMR(indices, vertices.size());
+    MeshOptimizer::optimizeOverdraw(indices, vertices);
+
+    EXPECT_EQ(getTriangles(vertices, indices), getTriangles(vertices, before));
+    EXPECT_LE(MeshOptimizer::getACMR(indices, vertices.size()), acmr * 1.05f + 0.01f);
+    // The cache order draws the inner box first, afterwards the outer box is drawn first.
+    // A cluster can straddle both boxes, so a few triangles may end up on the wrong side
+    EXPECT_EQ(countOuterInFront(before), 0u);
+    EXPECT_GE(countOuterInFront(indices), outerTriangles * 95 / 100);
+}
+
+TEST(MeshOptimizer, shippedMeshes) {
+    for (const auto* path : {"resources/engine/meshes/missing.cmdl", "resources/editor/meshes/teapot.cmdl"}) {
+        std::ifstream file{path, std::ios::binary};
+        ASSERT_TRUE(file.is_open()) << path;
+        const std::vector<byte> data{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+        std::vector<Vertex> vertices;
+        std::vector<Index> indices;
+        ASSERT_TRUE(ChiraMeshLoader::loadMeshData(path, data.data(), data.size(), vertices, indices)) << path;
+
+        const auto name = std::filesystem::path{path}.stem().string();
+        const auto acmrBefore = MeshOptimizer::getACMR(indices, vertices.size());
+        const auto atvrBefore = MeshOptimizer::getATVR(indices, vertices.size());
+        const auto triangles = getTriangles(vertices, indices);
+
+        auto optimizedVertices = vertices;
+        auto optimizedIndices = indices;
+        MeshOptimizer::optimize(optimizedVertices, optimizedIndices);
+        const auto acmrAfter = MeshOptimizer::getACMR(optimizedIndices, optimizedVertices.size());
+        const auto atvrAfter = MeshOptimizer::getATVR(optimizedIndices, optimizedVertices.size());
+        RecordProperty(name + "_acmr_before", std::to_string(acmrBefore));
+        RecordProperty(name + "_acmr_after", std::to_string(acmrAfter));
+        RecordProperty(name + "_atvr_before", std::to_string(atvrBefore));
+        RecordProperty(name + "_atvr_after", std::to_string(atvrAfter));
+
+        EXPECT_LT(acmrAfter, acmrBefore) << path;
+        EXPECT_LT(atvrAfter, atvrBefore) << path;
+        EXPECT_EQ(getTriangles(optimizedVertices, optimizedIndices), triangles) << path;
+
+        // Optimizing while writing gives the same mesh
+        const auto written = ChiraMeshLoader::createMesh(vertices, indices, {.quantize = false, .optimize = true});
+        std::vector<Vertex> loadedVertices;
+        std::vector<Index> loadedIndices;
+        ASSERT_TRUE(ChiraMeshLoader::loadMeshData(path, written.data(), written.size(), loadedVertices, loadedIndices)) << path;
+        EXPECT_EQ(loadedVertices, optimizedVertices) << path;
+        EXPECT_EQ(loadedIndices, optimizedIndices) << path;
+    }
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <TestHelpers.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <math/VertexWelder.h>
+
+using namespace chira;
+
+/// Corners of a grid of quads as two triangles each, so most vertices show up several times
+[[nodiscard]] static std::vector<Vertex> makeGridCorners(int size) {
+    std::vector<Vertex> corners;
+    corners.reserve(static_cast<std::size_t>(size) * size * 6);
+    const auto corner = [size](int x, int y) {
+        return Vertex{{static_cast<float>(x), 0, static_cast<float>(y)}, {0, 1, 0}, {static_cast<float>(x) / size, static_cast<float>(y) / size}};
+    };
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            corners.push_back(corner(x, y));
+            corners.push_back(corner(x + 1, y));
+            corners.push_back(corner(x + 1, y + 1));
+            corners.push_back(corner(x, y));
+            corners.push_back(corner(x + 1, y + 1));
+            corners.push_back(corner(x, y + 1));
+        }
+    }
+    return corners;
+}
+
+TEST(VertexWelder, mergesEqualVertices) {
+    VertexWelder welder;
+    std::vector<Vertex> vertices;
+    const Vertex a{{1, 2, 3}, {0, 0, 1}};
+    const Vertex b{{1, 2, 3}, {0, 1, 0}};
+    EXPECT_EQ(welder.weld(a, vertices), 0u);
+    EXPECT_EQ(welder.weld(b, vertices), 1u);
+    EXPECT_EQ(welder.weld(a, vertices), 0u);
+    EXPECT_EQ(vertices.size(), 2u);
+
+    // -0 and 0 are equal
+    EXPECT_EQ(welder.weld(Vertex{glm::vec3{-0.f, 0, 0}}, vertices), welder.weld(Vertex{glm::vec3{0.f, 0, 0}}, vertices));
+
+    // Added vertices can still be found
+    const Vertex c{{5, 5, 5}};
+    const auto first = welder.add(c, vertices);
+    EXPECT_EQ(welder.add(c, vertices), first + 1);
+    EXPECT_EQ(welder.weld(c, vertices), first);
+
+    welder.clear();
+    vertices.clear();
+    EXPECT_EQ(welder.weld(b, vertices), 0u);
+}
+
+TEST(VertexWelder, epsilonMergesCloseVertices) {
+    VertexWelder welder{0.01f};
+    std::vector<Vertex> vertices;
+    EXPECT_EQ(welder.weld(Vertex{glm::vec3{1.f, 0, 0}}, vertices), 0u);
+    EXPECT_EQ(welder.weld(Vertex{glm::vec3{1.001f, 0, 0}}, vertices), 0u);
+    EXPECT_EQ(welder.weld(Vertex{glm::vec3{1.1f, 0, 0}}, vertices), 1u);
+    // The first vertex is kept as is
+    EXPECT_EQ(vertices[0].position.x, 1.f);
+}
+
+TEST(VertexWelder, weldBenchmark) {
+    // Roughly 10k, 100k and 1M unique vertices
+    for (const int size : {100, 316, 1000}) {
+        const auto corners = makeGridCorners(size);
+        VertexWelder welder;
+        std::vector<Vertex> vertices;
+        std::vector<Index> indices;
+        indices.reserve(corners.size());
+
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto& corner : corners) {
+            indices.push_back(welder.weld(corner, vertices));
+        }
+        RecordProperty("weld_" + std::to_string(vertices.size()) + "_vertices_microseconds", static_cast<int>(microsecondsSince(start)));
+        EXPECT_EQ(vertices.size(), static_cast<std::size_t>(size + 1) * (size + 1));
+        for (std::size_t i = 0; i < corners.size(); i += 997) {
+            EXPECT_EQ(vertices[indices[i]], corners[i]);
+        }
+    }
+
+    // The linear search it replaces, only at the smallest size
+    const auto corners = makeGridCorners(100);
+    std::vector<Vertex> vertices;
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto& corner : corners) {
+        if (std::find(vertices.begin(), vertices.end(), corner) == vertices.end())
+            vertices.push_back(corner);
+    }
+    RecordProperty("linear_search_" + std::to_string(vertices.size()) + "_vertices_microseconds", static_cast<int>(microsecondsSince(start)));
+}
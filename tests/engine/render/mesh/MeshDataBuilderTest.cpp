@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <render/mesh/MeshDataBuilder.h>
+
+using namespace chira;
+
+/// Exposes what the builder keeps to itself
+class MeshDataBuilderTestMesh : public MeshDataBuilder {
+public:
+    using MeshDataBuilder::addVertex;
+    [[nodiscard]] const std::vector<Vertex>& getVertices() const {
+        return this->vertices;
+    }
+    [[nodiscard]] const std::vector<Index>& getIndices() const {
+        return this->indices;
+    }
+};
+
+TEST(MeshDataBuilder, addVertexAfterOptimize) {
+    MeshDataBuilderTestMesh mesh;
+    const auto corner = [](int x, int y) {
+        return Vertex{glm::vec3{static_cast<float>(x), 0, static_cast<float>(y)}, ColorRGB{0, 1, 0}};
+    };
+    std::vector<Vertex> corners;
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            mesh.addSquare(corner(x, y), corner(x + 1, y), corner(x + 1, y + 1), corner(x, y + 1));
+            corners.push_back(corner(x, y));
+        }
+    }
+    mesh.optimize();
+    const auto vertexCount = mesh.getVertices().size();
+
+    // Vertices that are already there are found where they ended up
+    for (const auto& corner : corners) {
+        mesh.addVertex(corner);
+        ASSERT_LT(mesh.getIndices().back(), mesh.getVertices().size());
+        EXPECT_EQ(mesh.getVertices()[mesh.getIndices().back()], corner);
+    }
+    EXPECT_EQ(mesh.getVertices().size(), vertexCount);
+
+    // New ones are still added
+    mesh.addVertex(Vertex{glm::vec3{100, 0, 100}});
+    EXPECT_EQ(mesh.getIndices().back(), vertexCount);
+    EXPECT_EQ(mesh.getVertices().size(), vertexCount + 1);
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <TestHelpers.h>
+
+#include <chrono>
+#include <random>
+#include <set>
+#include <render/queue/RenderQueue.h>
+
+using namespace chira;
+
+// The queue never dereferences these while sorting, it only needs distinct addresses
+alignas(64) static char fakeObjects[64 * 1024];
+
+template<typename T>
+[[nodiscard]] static T* fake(std::size_t index) {
+    return reinterpret_cast<T*>(&fakeObjects[index * 64]);
+}
+
+TEST(RenderQueue, sortKeyOrder) {
+    auto* shader = fake<Shader>(0);
+    auto* material = fake<IMaterial>(1);
+    const Renderer::MeshHandle mesh{1, 1, 1};
+
+    // Pass comes first, then depth within the same shader, material and mesh
+    EXPECT_LT(RenderQueue::getSortKey(RenderPass::GEOMETRY, shader, material, mesh, 1000.f),
+              RenderQueue::getSortKey(RenderPass::SKYBOX, shader, material, mesh, 0.f));
+    EXPECT_LT(RenderQueue::getSortKey(RenderPass::GEOMETRY, shader, material, mesh, 1.f),
+              RenderQueue::getSortKey(RenderPass::GEOMETRY, shader, material, mesh, 2.f));
+    EXPECT_LT(RenderQueue::getSortKey(RenderPass::GEOMETRY, shader, material, mesh, 0.5f),
+              RenderQueue::getSortKey(RenderPass::GEOMETRY, shader, material, mesh, 0.75f));
+    EXPECT_EQ(RenderQueue::getSortKey(RenderPass::GEOMETRY, shader, material, mesh, -1.f),
+              RenderQueue::getSortKey(RenderPass::GEOMETRY, shader, material, mesh, 0.f));
+}
+
+TEST(RenderQueue, sortGroupsStateChanges) {
+    constexpr int shaderCount = 8, materialsPerShader = 32, packetCount = 10000;
+    std::mt19937 random{1234};
+    std::uniform_int_distribution<int> materialDistribution{0, shaderCount * materialsPerShader - 1};
+    std::uniform_real_distribution<float> positionDistribution{-500.f, 500.f};
+
+    RenderQueue queue;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < packetCount; i++) {
+        const int material = materialDistribution(random);
+        DrawPacket packet{
+            .indexCount = 36,
+            .material = fake<IMaterial>(shaderCount + material),
+            .shader = fake<Shader>(material / materialsPerShader),
+        };
+        packet.model[3] = glm::vec4{positionDistribution(random), positionDistribution(random), positionDistribution(random), 1.f};
+        queue.submit(i % 100 == 0 ? RenderPass::SKYBOX : RenderPass::GEOMETRY, packet);
+    }
+    queue.sort();
+    RecordProperty("submit_and_sort_microseconds", static_cast<int>(microsecondsSince(start)));
+
+    const auto& packets = queue.getPackets();
+    ASSERT_EQ(packets.size(), packetCount);
+
+    // Every shader and material is bound exactly once per pass
+    std::size_t materialChanges = 0, shaderChanges = 0;
+    std::set<std::pair<std::uint64_t, const IMaterial*>> seenMaterials;
+    std::set<std::pair<std::uint64_t, const Shader*>> seenShaders;
+    for (std::size_t i = 0; i < packets.size(); i++) {
+        const auto pass = packets[i].sortKey >> 60;
+        if (i == 0 || packets[i].material != packets[i - 1].material) {
+            materialChanges++;
+            EXPECT_TRUE(seenMaterials.emplace(pass, packets[i].material).second);
+        } else {
+            // Front to back within a material
+            EXPECT_LE(packets[i - 1].sortKey, packets[i].sortKey);
+        }
+        if (i == 0 || packets[i].shader != packets[i - 1].shader) {
+            shaderChanges++;
+            EXPECT_TRUE(seenShaders.emplace(pass, packets[i].shader).second);
+        }
+    }
+    EXPECT_LE(materialChanges, 2u * shaderCount * materialsPerShader);
+    EXPECT_LE(shaderChanges, 2u * shaderCount);
+}
+
+TEST(RenderQueue, instancedBatches) {
+    constexpr int meshCount = 4, packetCount = 50000;
+    std::mt19937 random{5678};
+    std::uniform_int_distribution<unsigned int> meshDistribution{1, meshCount};
+    std::uniform_real_distribution<float> positionDistribution{-500.f, 500.f};
+
+    RenderQueue queue;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < packetCount; i++) {
+        const auto mesh = meshDistribution(random);
+        DrawPacket packet{
+            .mesh = {mesh, mesh, mesh},
+            .indexCount = 36,
+            .material = fake<IMaterial>(1),
+            .shader = fake<Shader>(0),
+        };
+        packet.model[3] = glm::vec4{positionDistribution(random), positionDistribution(random), positionDistribution(random), 1.f};
+        queue.submit(RenderPass::GEOMETRY, packet);
+    }
+    queue.sort();
+    RecordProperty("submit_and_sort_microseconds", static_cast<int>(microsecondsSince(start)));
+
+    // Sorting puts every instance of a mesh next to each other, so there is one batch per mesh
+    const auto& packets = queue.getPackets();
+    ASSERT_EQ(packets.size(), packetCount);
+    std::size_t batches = 1;
+    for (std::size_t i = 1; i < packets.size(); i++) {
+        if (!RenderQueue::canBatch(packets[i - 1], packets[i]))
+            batches++;
+    }
+    EXPECT_EQ(batches, meshCount);
+}
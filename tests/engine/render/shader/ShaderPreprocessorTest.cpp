@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <TestHelpers.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <render/shader/ShaderPreprocessor.h>
+
+using namespace chira;
+
+TEST(ShaderPreprocessor, expandsSymbols) {
+    ShaderPreprocessor preprocessor{[](const std::string&) { return std::string{}; }};
+    preprocessor.setSymbol("COUNT", "4");
+    preprocessor.setSymbol("A+B(c)", "works");
+
+    // GLSL directives and unknown symbols are copied through untouched
+    EXPECT_EQ(preprocessor.preprocess("#define COUNT #COUNT#\n#UNKNOWN# #A+B(c)#", "test"),
+              "#define COUNT 4\n#UNKNOWN# works");
+    EXPECT_EQ(preprocessor.preprocess("#COUNT##COUNT#", "test"), "44");
+    EXPECT_EQ(preprocessor.preprocess("#COUNT\n#", "test"), "#COUNT\n#");
+}
+
+TEST(ShaderPreprocessor, customPrefixAndSuffix) {
+    ShaderPreprocessor preprocessor{[](const std::string&) { return std::string{}; }};
+    preprocessor.setSymbol("NAME", "value");
+    preprocessor.setPrefix("{{");
+    preprocessor.setSuffix("}}");
+    EXPECT_EQ(preprocessor.preprocess("#NAME# {{NAME}} {{ NAME }}", "test"), "#NAME# value {{ NAME }}");
+}
+
+TEST(ShaderPreprocessor, cachesIncludes) {
+    std::unordered_map<std::string, int> loads;
+    ShaderPreprocessor preprocessor{[&loads](const std::string& identifier) {
+        loads[identifier]++;
+        if (identifier == "file://a.glsl")
+            return std::string{"a #include file://b.glsl#"};
+        if (identifier == "file://b.glsl")
+            return std::string{"b #VALUE#"};
+        return std::string{};
+    }};
+    preprocessor.setSymbol("VALUE", "1");
+
+    std::vector<std::string> includes;
+    EXPECT_EQ(preprocessor.preprocess("#include file://a.glsl#;", "test", &includes), "a b 1;");
+    EXPECT_EQ(includes, (std::vector<std::string>{"file://a.glsl", "file://b.glsl"}));
+
+    // Cached includes still report everything they pulled in
+    includes.clear();
+    EXPECT_EQ(preprocessor.preprocess("#include file://a.glsl#", "test", &includes), "a b 1");
+    EXPECT_EQ(includes, (std::vector<std::string>{"file://a.glsl", "file://b.glsl"}));
+    EXPECT_EQ(loads["file://a.glsl"], 1);
+    EXPECT_EQ(loads["file://b.glsl"], 1);
+
+    // Changing a symbol invalidates the cache
+    preprocessor.setSymbol("VALUE", "2");
+    EXPECT_EQ(preprocessor.preprocess("#include file://a.glsl#", "test"), "a b 2");
+    EXPECT_EQ(loads["file://a.glsl"], 2);
+}
+
+TEST(ShaderPreprocessor, includeCycle) {
+    ShaderPreprocessor preprocessor{[](const std::string&) {
+        return std::string{"x#include file://self.glsl#"};
+    }};
+    EXPECT_EQ(preprocessor.preprocess("#include file://self.glsl#", "test"), "x");
+}
+
+TEST(ShaderPreprocessor, conditionals) {
+    int loads = 0;
+    ShaderPreprocessor preprocessor{[&loads](const std::string&) {
+        loads++;
+        return std::string{"included"};
+    }};
+    preprocessor.setSymbol("LIT", "1");
+
+    EXPECT_EQ(preprocessor.preprocess("#ifdef LIT#lit#else#unlit#endif#", "test"), "lit");
+    EXPECT_EQ(preprocessor.preprocess("#ifndef LIT#lit#else#unlit#endif#", "test"), "unlit");
+    EXPECT_EQ(preprocessor.preprocess("a#ifdef SHADOWS#b#ifdef LIT#c#endif#d#else#e#ifdef LIT#f#else#g#endif##endif#h", "test"), "aefh");
+
+    // Includes in dropped branches are never loaded
+    EXPECT_EQ(preprocessor.preprocess("#ifdef SHADOWS##include file://shadows.glsl##endif#", "test"), "");
+    EXPECT_EQ(loads, 0);
+}
+
+[[nodiscard]] static std::string readFile(const std::filesystem::path& path) {
+    std::ifstream file{path, std::ios::binary};
+    std::stringstream stream;
+    stream << file.rdbuf();
+    return stream.str();
+}
+
+TEST(ShaderPreprocessor, engineShaders) {
+    const std::filesystem::path root{"resources/engine"};
+    ShaderPreprocessor preprocessor{[&root](const std::string& identifier) {
+        return readFile(root / identifier.substr(std::string_view{"file://"}.size()));
+    }};
+    preprocessor.setSymbol("DIRECTIONAL_LIGHT_COUNT", "4");
+    preprocessor.setSymbol("POINT_LIGHT_COUNT", "64");
+    preprocessor.setSymbol("SPOT_LIGHT_COUNT", "4");
+
+    std::vector<std::pair<std::string, std::string>> shaders;
+    for (const auto& entry : std::filesystem::directory_iterator{root / "shaders"}) {
+        if (entry.path().extension() == ".vsh" || entry.path().extension() == ".fsh")
+            shaders.emplace_back(entry.path().filename().string(), readFile(entry.path()));
+    }
+    ASSERT_FALSE(shaders.empty());
+
+    constexpr int iterations = 100;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        for (const auto& [name, source] : shaders) {
+            auto out = preprocessor.preprocess(source, name);
+            EXPECT_EQ(out.find("#include"), std::string::npos) << name;
+            EXPECT_EQ(out.find("_COUNT#"), std::string::npos) << name;
+        }
+    }
+    RecordProperty("microseconds_per_pass", static_cast<int>(microsecondsSince(start) / iterations));
+}
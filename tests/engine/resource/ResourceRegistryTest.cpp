@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <TestHelpers.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <resource/ResourceRegistry.h>
+#include <resource/StringResource.h>
+
+using namespace chira;
+
+static SharedPointer<Resource> makeUncountedResource(const std::string& identifier) {
+    SharedPointer<Resource> resource{new StringResource{identifier}};
+    // Let the registry delete it when it's erased, nothing else holds it
+    resource.setHolderAmountForDelete(0);
+    return resource;
+}
+
+TEST(ResourceRegistry, setGetErase) {
+    ResourceRegistry registry;
+    EXPECT_FALSE(registry.contains(ResourceKey{"registrytest://a.txt"}));
+    EXPECT_FALSE(registry.get(ResourceKey{"registrytest://a.txt"}));
+
+    auto resource = makeUncountedResource("registrytest://a.txt");
+    const auto* rawResource = resource.get();
+    registry.set(ResourceKey{"registrytest://a.txt"}, std::move(resource));
+    EXPECT_TRUE(registry.contains(ResourceKey{"registrytest://a.txt"}));
+    EXPECT_TRUE(registry.contains(ResourceKey{"registrytest://a.txt"}, rawResource));
+    EXPECT_FALSE(registry.contains(ResourceKey{"registrytest://b.txt"}, rawResource));
+    EXPECT_EQ(registry.getUseCount(ResourceKey{"registrytest://a.txt"}), 1);
+    EXPECT_EQ(registry.get(ResourceKey{"registrytest://a.txt"}).get(), rawResource);
+    EXPECT_EQ(registry.size(), 1);
+
+    int visited = 0;
+    registry.forEach([&visited](std::string_view identifier, const SharedPointer<Resource>& cached) {
+        EXPECT_EQ(identifier, "registrytest://a.txt");
+        EXPECT_EQ(cached->getIdentifier(), identifier);
+        visited++;
+    });
+    EXPECT_EQ(visited, 1);
+
+    EXPECT_TRUE(registry.erase(ResourceKey{"registrytest://a.txt"}));
+    EXPECT_FALSE(registry.erase(ResourceKey{"registrytest://a.txt"}));
+    EXPECT_EQ(registry.size(), 0);
+}
+
+TEST(ResourceRegistry, concurrentLookups) {
+    constexpr int RESOURCE_COUNT = 256;
+    ResourceRegistry registry;
+    std::vector<std::string> identifiers;
+    for (int i = 0; i < RESOURCE_COUNT; i++) {
+        identifiers.push_back("registrytest://" + std::to_string(i) + ".txt");
+        registry.set(ResourceKey{identifiers.back()}, makeUncountedResource(identifiers.back()));
+    }
+
+    // Readers look up resources that are always present while the writer churns through others
+    std::atomic_bool running = true;
+    std::atomic_int misses = 0;
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&] {
+            while (running) {
+                for (const auto& identifier : identifiers) {
+                    if (!registry.contains(ResourceKey{identifier}))
+                        misses++;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < 10000; i++) {
+        const std::string identifier = "registrytest://churn/" + std::to_string(i % 64) + ".txt";
+        if (i % 2 == 0)
+            registry.set(ResourceKey{identifier}, makeUncountedResource(identifier));
+        else
+            registry.erase(ResourceKey{identifier});
+    }
+    running = false;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(misses, 0);
+    registry.clear();
+    EXPECT_EQ(registry.size(), 0);
+}
+
+TEST(ResourceRegistry, insertLoadingHidesUntilFinished) {
+    ResourceRegistry registry;
+    const ResourceKey key{"registrytest://loading.txt"};
+    auto [loading, inserted] = registry.insertLoading(key, makeUncountedResource("registrytest://loading.txt"), false);
+    ASSERT_TRUE(inserted);
+    const auto* rawLoading = loading.get();
+    // The loading thread sees it while compiling it
+    EXPECT_EQ(registry.get(key).get(), rawLoading);
+
+    std::atomic_bool finished = false;
+    std::atomic_bool sawFinished = false;
+    std::thread lookup{[&] {
+        auto resource = registry.get(key);
+        sawFinished = finished.load() && resource.get() == rawLoading;
+    }};
+    // The loser of the race gets the winner's resource, its own is dropped
+    std::thread loser{[&] {
+        auto [resource, lost] = registry.insertLoading(key, makeUncountedResource("registrytest://loading.txt"), false);
+        EXPECT_FALSE(lost);
+        EXPECT_EQ(resource.get(), rawLoading);
+    }};
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+    EXPECT_EQ(registry.getUnowned(key), rawLoading);
+    finished = true;
+    registry.finishLoading(key, rawLoading);
+    lookup.join();
+    loser.join();
+    EXPECT_TRUE(sawFinished);
+    EXPECT_EQ(registry.size(), 1);
+    registry.clear();
+}
+
+TEST(ResourceRegistry, lookupBenchmark) {
+    constexpr int RESOURCE_COUNT = 1024;
+    constexpr int LOOKUPS_PER_THREAD = 200000;
+    ResourceRegistry registry;
+    std::vector<std::string> identifiers;
+    for (int i = 0; i < RESOURCE_COUNT; i++) {
+        identifiers.push_back("registrytest://" + std::to_string(i) + ".txt");
+        registry.set(ResourceKey{identifiers.back()}, makeUncountedResource(identifiers.back()));
+    }
+    std::vector<std::string> missingIdentifiers;
+    for (int i = 0; i < RESOURCE_COUNT; i++) {
+        missingIdentifiers.push_back("registrytest://missing/" + std::to_string(i) + ".txt");
+    }
+
+    for (int threadCount : {1, 4, 16}) {
+        for (bool hits : {true, false}) {
+            const auto& lookedUp = hits ? identifiers : missingIdentifiers;
+            std::atomic_int found = 0;
+            const auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> threads;
+            for (int t = 0; t < threadCount; t++) {
+                threads.emplace_back([&registry, &lookedUp, &found, t] {
+                    int foundHere = 0;
+                    for (int i = 0; i < LOOKUPS_PER_THREAD; i++) {
+                        if (registry.get(ResourceKey{lookedUp[(i + t * 31) % RESOURCE_COUNT]}))
+                            foundHere++;
+                    }
+                    found += foundHere;
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            const auto elapsed = microsecondsSince(start);
+            EXPECT_EQ(found, hits ? threadCount * LOOKUPS_PER_THREAD : 0);
+            RecordProperty((hits ? "hit_" : "miss_") + std::to_string(threadCount) + "_threads_microseconds", static_cast<int>(elapsed));
+        }
+    }
+    registry.clear();
+}
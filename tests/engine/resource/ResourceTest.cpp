@@ -0,0 +1,447 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <TestHelpers.h>
+#include <loader/image/Image.h>
+#include <resource/BinaryResource.h>
+#include <resource/PropertiesResource.h>
+#include <resource/StringResource.h>
+
+using namespace chira;
+
+constexpr int ASYNC_RESOURCE_COUNT = 512;
+
+TEST(Resource, getResourceAsync) {
+    PREINIT_ENGINE();
+
+    auto folder = std::filesystem::temp_directory_path() / "chira_async_resource_test";
+    std::filesystem::create_directories(folder);
+    for (int i = 0; i < ASYNC_RESOURCE_COUNT; i++) {
+        std::ofstream file{folder / (std::to_string(i) + ".txt"), std::ios::binary};
+        file << "resource " << i;
+    }
+    Resource::addResourceProvider(new FilesystemResourceProvider{folder.string(), true, "asynctest"});
+
+    std::vector<std::shared_future<SharedPointer<StringResource>>> strings;
+    std::vector<std::shared_future<SharedPointer<BinaryResource>>> binaries;
+    for (int i = 0; i < ASYNC_RESOURCE_COUNT; i++) {
+        // Half are text, half are binary, to get different resource types in flight at once
+        if (i % 2 == 0)
+            strings.push_back(Resource::getResourceAsync<StringResource>("asynctest://" + std::to_string(i) + ".txt"));
+        else
+            binaries.push_back(Resource::getResourceAsync<BinaryResource>("asynctest://" + std::to_string(i) + ".txt"));
+    }
+    // Asking again while the load is in flight should not start a second load
+    auto duplicate = Resource::getResourceAsync<StringResource>("asynctest://0.txt");
+    auto missing = Resource::getResourceAsync<StringResource>("asynctest://missing.txt");
+
+    int loadedEvents = 0;
+    auto listener = Events::addListener("chira::resource::loaded", [&loadedEvents](const std::any&) {
+        loadedEvents++;
+    });
+
+    const auto allReady = [&] {
+        const auto isReady = [](const auto& future) {
+            return future.wait_for(std::chrono::seconds{0}) == std::future_status::ready;
+        };
+        return std::all_of(strings.begin(), strings.end(), isReady) &&
+               std::all_of(binaries.begin(), binaries.end(), isReady) &&
+               isReady(missing);
+    };
+    const auto start = std::chrono::steady_clock::now();
+    while (!allReady()) {
+        ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{30});
+        // Stands in for a frame
+        Resource::processAsyncLoads();
+        Events::update();
+        std::this_thread::yield();
+    }
+    Events::update();
+    EXPECT_EQ(loadedEvents, ASYNC_RESOURCE_COUNT);
+    Events::removeListener(listener);
+
+    for (int i = 0; i < ASYNC_RESOURCE_COUNT / 2; i++) {
+        EXPECT_EQ(strings[i].get()->getString(), "resource " + std::to_string(i * 2) + '\0');
+        EXPECT_TRUE(Resource::hasResource(strings[i].get()->getIdentifier().data()));
+        std::string contents = "resource " + std::to_string(i * 2 + 1);
+        ASSERT_EQ(binaries[i].get()->getBufferLength(), contents.size());
+        EXPECT_EQ(std::memcmp(binaries[i].get()->getBuffer(), contents.data(), contents.size()), 0);
+    }
+    EXPECT_EQ(duplicate.get().get(), strings[0].get().get());
+    EXPECT_FALSE(missing.get());
+
+    // A cached resource is handed back right away
+    auto cached = Resource::getResourceAsync<StringResource>("asynctest://0.txt");
+    EXPECT_EQ(cached.wait_for(std::chrono::seconds{0}), std::future_status::ready);
+    EXPECT_EQ(cached.get().get(), strings[0].get().get());
+
+    std::vector<std::string> identifiers;
+    for (const auto& future : strings)
+        identifiers.emplace_back(future.get()->getIdentifier());
+    for (const auto& future : binaries)
+        identifiers.emplace_back(future.get()->getIdentifier());
+    strings.clear();
+    binaries.clear();
+    duplicate = {};
+    cached = {};
+    for (const auto& identifier : identifiers)
+        Resource::removeResource(identifier);
+    Resource::discardAll();
+    std::filesystem::remove_all(folder);
+}
+
+// Remembers which thread decoded it
+class ThreadCheckedImage : public Image {
+public:
+    explicit ThreadCheckedImage(std::string identifier_) : Image(std::move(identifier_)) {}
+    void compile(const byte buffer[], std::size_t bufferLen) override {
+        this->decodeThread = std::this_thread::get_id();
+        Image::compile(buffer, bufferLen);
+    }
+    void compileMapped(const std::shared_ptr<const MappedFile>& file) override {
+        this->decodeThread = std::this_thread::get_id();
+        Image::compileMapped(file);
+    }
+    std::thread::id decodeThread;
+};
+
+// Stands in for a texture, which has to be uploaded on the main thread
+class ThreadCheckedTexture : public PropertiesResource {
+public:
+    explicit ThreadCheckedTexture(std::string identifier_) : PropertiesResource(std::move(identifier_)) {}
+    void compile(const nlohmann::json& properties) override {
+        this->compileThread = std::this_thread::get_id();
+        if (!this->image)
+            this->image = Resource::getResource<ThreadCheckedImage>(properties.at("image").get<std::string>());
+    }
+    void prepareAsync(const nlohmann::json& properties) override {
+        this->image = Resource::getResource<ThreadCheckedImage>(properties.at("image").get<std::string>());
+    }
+    SharedPointer<ThreadCheckedImage> image;
+    std::thread::id compileThread;
+};
+
+TEST(Resource, getResourceAsyncDecodesOffMainThread) {
+    PREINIT_ENGINE();
+
+    auto folder = std::filesystem::temp_directory_path() / "chira_async_decode_test";
+    std::filesystem::create_directories(folder);
+    std::filesystem::copy_file("resources/engine/textures/missing.png", folder / "image.png", std::filesystem::copy_options::overwrite_existing);
+    std::ofstream{folder / "texture.json", std::ios::binary} << R"({"image": "decodetest://image.png"})";
+    Resource::addResourceProvider(new FilesystemResourceProvider{folder.string(), true, "decodetest"});
+
+    auto texture = Resource::getResourceAsync<ThreadCheckedTexture>("decodetest://texture.json");
+    const auto start = std::chrono::steady_clock::now();
+    while (texture.wait_for(std::chrono::seconds{0}) != std::future_status::ready) {
+        ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{30});
+        Resource::processAsyncLoads();
+        std::this_thread::yield();
+    }
+
+    ASSERT_TRUE(texture.get());
+    ASSERT_TRUE(texture.get()->image);
+    EXPECT_GT(texture.get()->image->getWidth(), 0);
+    // Only the upload happens on the main thread
+    EXPECT_EQ(texture.get()->compileThread, std::this_thread::get_id());
+    EXPECT_NE(texture.get()->image->decodeThread, std::thread::id{});
+    EXPECT_NE(texture.get()->image->decodeThread, std::this_thread::get_id());
+    // The image was loaded while preparing the texture, so it's still a dependency
+    EXPECT_EQ(Resource::getDependents("decodetest://image.png"), std::vector<std::string>{"decodetest://texture.json"});
+
+    texture = {};
+    Resource::removeResource("decodetest://texture.json");
+    Resource::cleanup();
+    Resource::removeResource("decodetest://image.png");
+    Resource::discardAll();
+    std::filesystem::remove_all(folder);
+}
+
+// Stands in for something like a texture, which is built out of another resource
+class CombinedStringResource : public StringResource {
+public:
+    explicit CombinedStringResource(std::string identifier_) : StringResource(std::move(identifier_)) {}
+    void compile(const byte buffer[], std::size_t /*bufferLength*/) override {
+        this->base = Resource::getResource<StringResource>("reloadtest://base.txt");
+        this->combined = std::string{reinterpret_cast<const char*>(buffer)} + '+' + this->base->getString().c_str();
+        this->compileCount++;
+    }
+    SharedPointer<StringResource> base;
+    std::string combined;
+    int compileCount = 0;
+};
+
+TEST(Resource, hotReload) {
+    PREINIT_ENGINE();
+
+    auto folder = std::filesystem::temp_directory_path() / "chira_hot_reload_test";
+    std::filesystem::remove_all(folder);
+    std::filesystem::create_directories(folder);
+    std::ofstream{folder / "base.txt", std::ios::binary} << "one";
+    std::ofstream{folder / "combined.txt", std::ios::binary} << "combined";
+    auto* provider = new FilesystemResourceProvider{folder.string(), true, "reloadtest"};
+    Resource::addResourceProvider(provider);
+
+    auto base = Resource::getResource<StringResource>("reloadtest://base.txt");
+    auto combined = Resource::getResource<CombinedStringResource>("reloadtest://combined.txt");
+    EXPECT_EQ(combined->combined, "combined+one");
+    EXPECT_EQ(Resource::getDependents("reloadtest://base.txt"), std::vector<std::string>{"reloadtest://combined.txt"});
+    EXPECT_TRUE(Resource::getDependents("reloadtest://combined.txt").empty());
+
+    int reloadedEvents = 0;
+    auto listener = Events::addListener("chira::resource::reloaded", [&reloadedEvents](const std::any&) {
+        reloadedEvents++;
+    });
+
+    const auto waitForReload = [&](const std::string& file, const std::string& contents, const std::string& expected) {
+        std::ofstream{folder / file, std::ios::binary} << contents;
+        if (!provider->isIndexed())
+            Resource::markChanged("reloadtest://" + file);
+        const auto start = std::chrono::steady_clock::now();
+        while (combined->combined != expected && std::chrono::steady_clock::now() - start < std::chrono::seconds{5}) {
+            Resource::processReloads();
+            std::this_thread::sleep_for(std::chrono::milliseconds{5});
+        }
+        return combined->combined == expected;
+    };
+
+    // Dependencies are reloaded first, otherwise the combined resource would still see the old base
+    ASSERT_TRUE(waitForReload("base.txt", "two", "combined+two"));
+    EXPECT_EQ(base->getString(), std::string{"two"} + '\0');
+    EXPECT_EQ(combined->compileCount, 2);
+    Events::update();
+    EXPECT_EQ(reloadedEvents, 2);
+
+    // Dependents are reloaded, dependencies are not
+    ASSERT_TRUE(waitForReload("combined.txt", "changed", "changed+two"));
+    EXPECT_EQ(combined->compileCount, 3);
+    Events::update();
+    EXPECT_EQ(reloadedEvents, 3);
+    Events::removeListener(listener);
+
+    // The dependency was recorded again when it was recompiled
+    EXPECT_EQ(Resource::getDependents("reloadtest://base.txt"), std::vector<std::string>{"reloadtest://combined.txt"});
+
+    combined = SharedPointer<CombinedStringResource>{};
+    base = SharedPointer<StringResource>{};
+    Resource::removeResource("reloadtest://combined.txt");
+    Resource::removeResource("reloadtest://base.txt");
+    Resource::discardAll();
+    std::filesystem::remove_all(folder);
+}
+
+TEST(Resource, unusedResourceBudget) {
+    PREINIT_ENGINE();
+
+    constexpr std::size_t FILE_SIZE = 400 * 1024;
+    auto folder = std::filesystem::temp_directory_path() / "chira_budget_test";
+    std::filesystem::create_directories(folder);
+    for (const auto* name : {"a.bin", "b.bin", "c.bin"}) {
+        std::ofstream{folder / name, std::ios::binary} << std::string(FILE_SIZE, 'x');
+    }
+    Resource::addResourceProvider(new FilesystemResourceProvider{folder.string(), true, "budgettest"});
+    Resource::evictUnusedResources(0);
+    Resource::setUnusedResourceBudget(1024 * 1024);
+    const auto before = Resource::getCacheStatistics();
+
+    // Dropping the last handle keeps the resource warm instead of deleting it
+    auto a = Resource::getResource<BinaryResource>("budgettest://a.bin");
+    const auto* aPointer = a.get();
+    a = SharedPointer<BinaryResource>{};
+    auto statistics = Resource::getCacheStatistics();
+    EXPECT_EQ(statistics.unusedResources, 1);
+    EXPECT_GE(statistics.unusedBytes, FILE_SIZE);
+    a = Resource::getResource<BinaryResource>("budgettest://a.bin");
+    EXPECT_EQ(a.get(), aPointer);
+    a = SharedPointer<BinaryResource>{};
+
+    // Going over budget evicts the least recently used resource
+    Resource::getResource<BinaryResource>("budgettest://b.bin");
+    Resource::getResource<BinaryResource>("budgettest://c.bin");
+    Resource::cleanup();
+    statistics = Resource::getCacheStatistics();
+    EXPECT_EQ(statistics.misses - before.misses, 3);
+    EXPECT_EQ(statistics.hits - before.hits, 1);
+    EXPECT_EQ(statistics.evictions - before.evictions, 1);
+    EXPECT_LE(statistics.unusedBytes, 1024 * 1024);
+
+    auto b = Resource::getResource<BinaryResource>("budgettest://b.bin");
+    EXPECT_EQ(Resource::getCacheStatistics().hits - before.hits, 2);
+    a = Resource::getResource<BinaryResource>("budgettest://a.bin");
+    EXPECT_EQ(Resource::getCacheStatistics().misses - before.misses, 4);
+    ASSERT_EQ(a->getBufferLength(), FILE_SIZE);
+
+    // Resources in use are never evicted
+    Resource::evictUnusedResources(0);
+    EXPECT_EQ(Resource::getCacheStatistics().unusedResources, 0);
+    EXPECT_EQ(b->getBufferLength(), FILE_SIZE);
+    EXPECT_EQ(Resource::getResource<BinaryResource>("budgettest://b.bin").get(), b.get());
+
+    a = SharedPointer<BinaryResource>{};
+    b = SharedPointer<BinaryResource>{};
+    Resource::setUnusedResourceBudget(256 * 1024 * 1024);
+    Resource::discardAll();
+    std::filesystem::remove_all(folder);
+}
+
+TEST(Resource, unusedResourcesAreLeastRecentlyUsed) {
+    PREINIT_ENGINE();
+
+    constexpr std::size_t FILE_SIZE = 400 * 1024;
+    auto folder = std::filesystem::temp_directory_path() / "chira_lru_test";
+    std::filesystem::create_directories(folder);
+    for (const auto* name : {"a.bin", "b.bin", "c.bin"}) {
+        std::ofstream{folder / name, std::ios::binary} << std::string(FILE_SIZE, 'x');
+    }
+    Resource::addResourceProvider(new FilesystemResourceProvider{folder.string(), true, "lrutest"});
+    Resource::evictUnusedResources(0);
+
+    Resource::getResource<BinaryResource>("lrutest://a.bin");
+    Resource::getResource<BinaryResource>("lrutest://b.bin");
+    EXPECT_EQ(Resource::getCacheStatistics().unusedResources, 2);
+
+    // Resources in use again leave the unused list, and don't count towards the budget
+    auto a = Resource::getResource<BinaryResource>("lrutest://a.bin");
+    auto statistics = Resource::getCacheStatistics();
+    EXPECT_EQ(statistics.unusedResources, 1);
+    EXPECT_LT(statistics.unusedBytes, FILE_SIZE * 2);
+    // Removing one that's in use by the caller still works
+    Resource::removeResource("lrutest://a.bin");
+    Resource::cleanup();
+    EXPECT_EQ(Resource::getCacheStatistics().unusedResources, 1);
+
+    // Using a resource again makes it the most recently used one
+    a = SharedPointer<BinaryResource>{};
+    Resource::getResource<BinaryResource>("lrutest://a.bin");
+    Resource::getResource<BinaryResource>("lrutest://c.bin");
+    Resource::getResource<BinaryResource>("lrutest://b.bin");
+    EXPECT_EQ(Resource::getCacheStatistics().unusedResources, 3);
+    Resource::evictUnusedResources(FILE_SIZE * 2 + FILE_SIZE / 2);
+    EXPECT_EQ(Resource::getCacheStatistics().unusedResources, 2);
+    const auto before = Resource::getCacheStatistics();
+    Resource::getResource<BinaryResource>("lrutest://b.bin");
+    Resource::getResource<BinaryResource>("lrutest://c.bin");
+    EXPECT_EQ(Resource::getCacheStatistics().hits - before.hits, 2);
+    EXPECT_EQ(Resource::getCacheStatistics().misses - before.misses, 0);
+    Resource::getResource<BinaryResource>("lrutest://a.bin");
+    EXPECT_EQ(Resource::getCacheStatistics().misses - before.misses, 1);
+
+    // Dropping the same resource from many threads at once only adds it to the list once
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([] {
+            for (int i = 0; i < 1000; i++) {
+                Resource::getResource<BinaryResource>("lrutest://b.bin");
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(Resource::getCacheStatistics().unusedResources, 3);
+
+    Resource::discardAll();
+    std::filesystem::remove_all(folder);
+}
+
+TEST(Resource, cleanupIsDeferred) {
+    PREINIT_ENGINE();
+
+    auto first = Resource::getResource<StringResource>("file://string_resource_test.txt");
+    Resource::removeResource("file://string_resource_test.txt");
+
+    // Lookups don't touch the garbage, so the resource is still cached until the next cleanup
+    for (int i = 0; i < 10000; i++) {
+        ASSERT_EQ(Resource::getResource<StringResource>("file://string_resource_test.txt").get(), first.get());
+    }
+
+    Resource::cleanup();
+    auto second = Resource::getResource<StringResource>("file://string_resource_test.txt");
+    EXPECT_NE(second.get(), first.get());
+    // The old copy stays valid for as long as it's held
+    EXPECT_STREQ(first->getString().c_str(), "test");
+    EXPECT_STREQ(second->getString().c_str(), "test");
+
+    first = SharedPointer<StringResource>{};
+    second = SharedPointer<StringResource>{};
+    Resource::discardAll();
+}
+
+TEST(Resource, cleanupBenchmark) {
+    PREINIT_ENGINE();
+
+    constexpr int LOOKUP_COUNT = 100000;
+    auto cached = Resource::getResource<StringResource>("file://string_resource_test.txt");
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < LOOKUP_COUNT; i++) {
+        ASSERT_EQ(Resource::getResource<StringResource>("file://string_resource_test.txt").get(), cached.get());
+    }
+    RecordProperty("lookup_microseconds", static_cast<int>(microsecondsSince(start)));
+
+    // Lookups used to clean up before doing anything else
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < LOOKUP_COUNT; i++) {
+        Resource::cleanup();
+        ASSERT_EQ(Resource::getResource<StringResource>("file://string_resource_test.txt").get(), cached.get());
+    }
+    RecordProperty("lookup_with_cleanup_microseconds", static_cast<int>(microsecondsSince(start)));
+
+    cached = SharedPointer<StringResource>{};
+    Resource::discardAll();
+}
+
+TEST(Resource, concurrentProviderLookups) {
+    PREINIT_ENGINE();
+
+    // Readers look up resources from providers that exist and providers that don't while providers are being added
+    std::atomic_bool running = true;
+    std::atomic_int misses = 0;
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&running, &misses, t] {
+            while (running) {
+                if (!Resource::hasResource("file://string_resource_test.txt"))
+                    misses++;
+                if (Resource::hasResource("lookuptest" + std::to_string(t) + "://string_resource_test.txt"))
+                    misses++;
+            }
+        });
+    }
+    for (int i = 0; i < 16; i++) {
+        Resource::addResourceProvider(new FilesystemResourceProvider{"tests", false, "lookupchurn" + std::to_string(i)});
+    }
+    running = false;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(misses, 0);
+    EXPECT_TRUE(Resource::hasResource("lookupchurn15://string_resource_test.txt"));
+    Resource::discardAll();
+}
+
+TEST(Resource, binaryResourceSurvivesRewrite) {
+    PREINIT_ENGINE();
+
+    // Big enough to be mapped by the filesystem provider
+    constexpr std::size_t FILE_SIZE = 400 * 1024;
+    auto folder = std::filesystem::temp_directory_path() / "chira_rewrite_test";
+    std::filesystem::create_directories(folder);
+    std::ofstream{folder / "a.bin", std::ios::binary} << std::string(FILE_SIZE, 'x');
+    Resource::addResourceProvider(new FilesystemResourceProvider{folder.string(), true, "rewritetest"});
+
+    auto a = Resource::getResource<BinaryResource>("rewritetest://a.bin");
+    ASSERT_EQ(a->getBufferLength(), FILE_SIZE);
+    // Truncating a file that's still mapped would fault when the missing pages are read
+    std::ofstream{folder / "a.bin", std::ios::binary | std::ios::trunc} << "y";
+    EXPECT_TRUE(std::all_of(a->getBuffer(), a->getBuffer() + a->getBufferLength(), [](byte b) { return b == 'x'; }));
+
+    a = SharedPointer<BinaryResource>{};
+    Resource::discardAll();
+    std::filesystem::remove_all(folder);
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <vector>
+#include <TestHelpers.h>
+#include <resource/BinaryResource.h>
+#include <resource/StringResource.h>
+#include <resource/provider/ArchiveResourceProvider.h>
+
+using namespace chira;
+
+TEST(ArchiveResourceProvider, packAndRead) {
+    PREINIT_ENGINE();
+
+    auto folder = std::filesystem::temp_directory_path() / "chira_archive_test";
+    std::filesystem::create_directories(folder / "nested");
+    std::string repetitive(10000, 'z');
+    std::string noise;
+    for (int i = 0; i < 1000; i++)
+        noise += static_cast<char>((i * 7919) % 251);
+    {
+        std::ofstream{folder / "plain.txt", std::ios::binary} << "test";
+        std::ofstream{folder / "nested" / "repetitive.txt", std::ios::binary} << repetitive;
+        std::ofstream{folder / "nested" / "noise.bin", std::ios::binary} << noise;
+        std::ofstream{folder / "empty.txt", std::ios::binary};
+    }
+    auto archive = std::filesystem::temp_directory_path() / ("chira_archive_test" + ARCHIVE_FILE_EXTENSION);
+    ASSERT_TRUE(ArchiveResourceProvider::createArchive(folder.string(), archive.string()));
+
+    auto* provider = new ArchiveResourceProvider{archive.string(), true, "archivetest"};
+    ASSERT_TRUE(provider->isOpen());
+    EXPECT_EQ(provider->getResourceCount(), 4);
+    EXPECT_TRUE(provider->hasResource("nested/repetitive.txt"));
+    EXPECT_FALSE(provider->hasResource("nested"));
+    EXPECT_FALSE(provider->hasResource("missing.txt"));
+    Resource::addResourceProvider(provider);
+
+    EXPECT_EQ(Resource::getUniqueUncachedResource<StringResource>("archivetest://plain.txt")->getString(), std::string{"test"} + '\0');
+    EXPECT_EQ(Resource::getUniqueUncachedResource<StringResource>("archivetest://nested/repetitive.txt")->getString(), repetitive + '\0');
+    EXPECT_EQ(Resource::getUniqueUncachedResource<StringResource>("archivetest://empty.txt")->getString(), std::string{'\0'});
+    auto binary = Resource::getUniqueUncachedResource<BinaryResource>("archivetest://nested/noise.bin");
+    ASSERT_EQ(binary->getBufferLength(), noise.size());
+    EXPECT_EQ(std::memcmp(binary->getBuffer(), noise.data(), noise.size()), 0);
+    binary.reset();
+
+    Resource::discardAll();
+    std::filesystem::remove_all(folder);
+    std::filesystem::remove(archive);
+}
+
+TEST(ArchiveResourceProvider, invalidArchive) {
+    PREINIT_ENGINE();
+
+    auto archive = std::filesystem::temp_directory_path() / ("chira_invalid_archive_test" + ARCHIVE_FILE_EXTENSION);
+    std::ofstream{archive, std::ios::binary} << "this is not an archive, but it is long enough to have a header";
+    ArchiveResourceProvider provider{archive.string(), true, "archivetest"};
+    EXPECT_FALSE(provider.isOpen());
+    EXPECT_FALSE(provider.hasResource("plain.txt"));
+
+    Resource::discardAll();
+    std::filesystem::remove(archive);
+}
+
+TEST(ArchiveResourceProvider, corruptArchive) {
+    PREINIT_ENGINE();
+
+    auto folder = std::filesystem::temp_directory_path() / "chira_corrupt_archive_test";
+    std::filesystem::create_directories(folder);
+    std::ofstream{folder / "plain.txt", std::ios::binary} << "test";
+    auto archive = std::filesystem::temp_directory_path() / ("chira_corrupt_archive_test" + ARCHIVE_FILE_EXTENSION);
+    ASSERT_TRUE(ArchiveResourceProvider::createArchive(folder.string(), archive.string(), false));
+
+    std::vector<char> original;
+    {
+        std::ifstream in{archive, std::ios::binary};
+        original.assign(std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+    }
+    ArchiveHeader header;
+    ASSERT_GE(original.size(), sizeof(ArchiveHeader));
+    std::memcpy(&header, original.data(), sizeof(ArchiveHeader));
+    ASSERT_EQ(header.entryCount, 1);
+
+    const auto openWithEntry = [&](const std::function<void(ArchiveEntry&)>& corrupt) {
+        auto bytes = original;
+        ArchiveEntry entry;
+        std::memcpy(&entry, bytes.data() + header.tocOffset, sizeof(ArchiveEntry));
+        corrupt(entry);
+        std::memcpy(bytes.data() + header.tocOffset, &entry, sizeof(ArchiveEntry));
+        std::ofstream{archive, std::ios::binary | std::ios::trunc}.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        ArchiveResourceProvider provider{archive.string(), true, "archivetest"};
+        return provider.isOpen() && provider.hasResource("plain.txt");
+    };
+
+    EXPECT_TRUE(openWithEntry([](ArchiveEntry&) {}));
+    // Uncompressed entries that claim to be bigger than what's stored would be read past the end
+    EXPECT_FALSE(openWithEntry([](ArchiveEntry& entry) { entry.size = 1024 * 1024; }));
+    // Offsets and sizes that wrap around when added together
+    EXPECT_FALSE(openWithEntry([](ArchiveEntry& entry) { entry.dataOffset = UINT64_MAX - 1; }));
+    EXPECT_FALSE(openWithEntry([](ArchiveEntry& entry) { entry.storedSize = entry.size = UINT64_MAX; }));
+    EXPECT_FALSE(openWithEntry([](ArchiveEntry& entry) { entry.nameOffset = UINT32_MAX; entry.nameLength = 2; }));
+    // Compressed entries that could never decompress to their size
+    EXPECT_FALSE(openWithEntry([](ArchiveEntry& entry) { entry.compression = ArchiveCompression::LZ4; entry.size = UINT64_MAX; }));
+    EXPECT_FALSE(openWithEntry([](ArchiveEntry& entry) { entry.compression = static_cast<ArchiveCompression>(7); }));
+    // Lookups rely on the hash
+    EXPECT_FALSE(openWithEntry([](ArchiveEntry& entry) { entry.nameHash++; }));
+
+    Resource::discardAll();
+    std::filesystem::remove_all(folder);
+    std::filesystem::remove(archive);
+}
@@ -1,6 +1,13 @@
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
 #include <TestHelpers.h>
+#include <resource/BinaryResource.h>
 #include <resource/StringResource.h>
 
 using namespace chira;
@@ -15,6 +22,132 @@ TEST(FilesystemResourceProvider, getStringResource) {
     Resource::discardAll();
 }
 
+TEST(FilesystemResourceProvider, getMappedResource) {
+    PREINIT_ENGINE();
+
+    // Big enough to be mapped instead of read
+    auto folder = std::filesystem::temp_directory_path() / "chira_mapped_resource_test";
+    std::filesystem::create_directories(folder);
+    std::string contents(FilesystemResourceProvider::MAPPED_FILE_MIN_SIZE * 2, 'x');
+    for (std::size_t i = 0; i < contents.size(); i += 1024)
+        contents[i] = static_cast<char>('a' + (i / 1024) % 26);
+    {
+        std::ofstream file{folder / "big.bin", std::ios::binary};
+        file << contents;
+    }
+    Resource::addResourceProvider(new FilesystemResourceProvider{folder.string(), true, "mappedtest"});
+
+    auto binary = Resource::getResource<BinaryResource>("mappedtest://big.bin");
+    ASSERT_EQ(binary->getBufferLength(), contents.size());
+    EXPECT_EQ(std::memcmp(binary->getBuffer(), contents.data(), contents.size()), 0);
+
+    // Resources that don't handle mappings still get a null-terminated copy
+    auto string = Resource::getUniqueUncachedResource<StringResource>("mappedtest://big.bin");
+    EXPECT_EQ(string->getString(), contents + '\0');
+
+    Resource::removeResource(binary->getIdentifier().data());
+    binary = SharedPointer<BinaryResource>{};
+    string.reset();
+    Resource::discardAll();
+    std::filesystem::remove_all(folder);
+}
+
+// The index is updated from the watcher thread, so give it a moment to catch up
+static bool waitForResource(const FilesystemResourceProvider& provider, std::string_view name, bool expected) {
+    for (int i = 0; i < 200; i++) {
+        if (provider.hasResource(name) == expected)
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    return false;
+}
+
+TEST(FilesystemResourceProvider, indexTracksChanges) {
+    auto folder = std::filesystem::temp_directory_path() / "chira_index_test";
+    std::filesystem::remove_all(folder);
+    std::filesystem::create_directories(folder / "nested");
+    std::ofstream{folder / "nested" / "existing.txt"} << "test";
+
+    FilesystemResourceProvider provider{folder.string(), true, "indextest"};
+    EXPECT_TRUE(provider.hasResource("nested"));
+    EXPECT_TRUE(provider.hasResource("nested/existing.txt"));
+    EXPECT_FALSE(provider.hasResource("nested/missing.txt"));
+    if (!provider.isIndexed()) {
+        std::filesystem::remove_all(folder);
+        GTEST_SKIP() << "File watching is not supported on this platform";
+    }
+
+    std::ofstream{folder / "nested" / "created.txt"} << "test";
+    EXPECT_TRUE(waitForResource(provider, "nested/created.txt", true));
+
+    std::filesystem::create_directories(folder / "new" / "deeper");
+    std::ofstream{folder / "new" / "deeper" / "file.txt"} << "test";
+    EXPECT_TRUE(waitForResource(provider, "new/deeper/file.txt", true));
+
+    std::filesystem::rename(folder / "new", folder / "renamed");
+    EXPECT_TRUE(waitForResource(provider, "renamed/deeper/file.txt", true));
+    EXPECT_TRUE(waitForResource(provider, "new/deeper/file.txt", false));
+
+    std::filesystem::remove_all(folder / "nested");
+    EXPECT_TRUE(waitForResource(provider, "nested/existing.txt", false));
+    EXPECT_FALSE(provider.hasResource("nested"));
+
+    // Changes made through a new folder after a rename must still be seen
+    std::ofstream{folder / "renamed" / "deeper" / "late.txt"} << "test";
+    EXPECT_TRUE(waitForResource(provider, "renamed/deeper/late.txt", true));
+
+    std::filesystem::remove_all(folder);
+}
+
+TEST(FilesystemResourceProvider, indexNormalizesNames) {
+    auto folder = std::filesystem::temp_directory_path() / "chira_normalize_test";
+    std::filesystem::remove_all(folder);
+    std::filesystem::create_directories(folder / "nested");
+    std::ofstream{folder / "nested" / "file.txt"} << "test";
+
+    // Every spelling the filesystem accepts is found, whether the index is used or not
+    FilesystemResourceProvider provider{folder.string(), true, "normalizetest"};
+    for (const auto* name : {"nested/file.txt", "./nested/file.txt", "nested//file.txt", "nested/./file.txt", R"(nested\file.txt)", "nested/"}) {
+        EXPECT_TRUE(provider.hasResource(name)) << name;
+    }
+    EXPECT_FALSE(provider.hasResource("./nested//missing.txt"));
+    EXPECT_EQ(FilesystemResourceProvider::normalizeName(R"(./a//b\c/)"), "a/b/c");
+
+    std::filesystem::remove_all(folder);
+}
+
+TEST(FilesystemResourceProvider, resolveAcrossStackedProviders) {
+    PREINIT_ENGINE();
+
+    // Every provider overrides a slice of the files, the rest fall through to the providers below it
+    constexpr int providerCount = 4, fileCount = 250;
+    auto folder = std::filesystem::temp_directory_path() / "chira_stacked_test";
+    std::filesystem::remove_all(folder);
+    for (int p = 0; p < providerCount; p++) {
+        auto layer = folder / std::to_string(p);
+        std::filesystem::create_directories(layer / "files");
+        for (int f = p * fileCount / providerCount; f < fileCount; f++)
+            std::ofstream{layer / "files" / (std::to_string(f) + ".txt")} << p;
+        Resource::addResourceProvider(new FilesystemResourceProvider{layer.string(), true, "stackedtest"});
+    }
+
+    std::vector<std::string> identifiers;
+    for (int i = 0; i < 10000; i++) {
+        identifiers.push_back("stackedtest://files/" + std::to_string(i % (fileCount * 2)) + ".txt");
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10000; i++) {
+        ASSERT_EQ(Resource::hasResource(identifiers[i]), i % (fileCount * 2) < fileCount);
+    }
+    RecordProperty("lookup_microseconds", static_cast<int>(microsecondsSince(start)));
+    auto* provider = Resource::getResourceProviderWithResource("stackedtest://files/0.txt");
+    EXPECT_EQ(provider, Resource::getResourceProviders("stackedtest")[0].get());
+    provider = Resource::getResourceProviderWithResource("stackedtest://files/" + std::to_string(fileCount - 1) + ".txt");
+    EXPECT_EQ(provider, Resource::getResourceProviders("stackedtest")[providerCount - 1].get());
+
+    std::filesystem::remove_all(folder);
+}
+
 TEST(FilesystemResourceProvider, getResourceIdentifier) {
     auto path1 = FilesystemResourceProvider::getResourceIdentifier(R"(C:\this\is\a\path\)" + FILESYSTEM_ROOT_FOLDER + R"(\test\files\file.txt)");
     EXPECT_STREQ(path1.c_str(), (FILESYSTEM_PROVIDER_NAME + RESOURCE_ID_SEPARATOR.data() + "files/file.txt").c_str());
@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <utility/LZ4.h>
+
+using namespace chira;
+
+static void expectRoundTrip(const std::vector<byte>& data) {
+    auto compressed = LZ4::compress(data.data(), data.size());
+    std::vector<byte> decompressed(data.size());
+    ASSERT_TRUE(LZ4::decompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size()));
+    EXPECT_EQ(decompressed, data);
+}
+
+TEST(LZ4, roundTrip) {
+    std::mt19937 random{42};
+    for (std::size_t size : {0, 1, 12, 13, 100, 65536, 300000}) {
+        std::vector<byte> repetitive(size), noise(size);
+        for (std::size_t i = 0; i < size; i++) {
+            repetitive[i] = "the quick brown fox "[random() % 20];
+            noise[i] = static_cast<byte>(random());
+        }
+        expectRoundTrip(repetitive);
+        expectRoundTrip(noise);
+    }
+}
+
+TEST(LZ4, compressesRepetitiveData) {
+    std::vector<byte> data(100000, 'a');
+    auto compressed = LZ4::compress(data.data(), data.size());
+    EXPECT_LT(compressed.size(), data.size() / 100);
+}
+
+TEST(LZ4, rejectsCorruptData) {
+    std::vector<byte> data(1000);
+    for (std::size_t i = 0; i < data.size(); i++)
+        data[i] = static_cast<byte>(i % 7);
+    auto compressed = LZ4::compress(data.data(), data.size());
+    std::vector<byte> output(data.size());
+    // Truncated input, and the wrong expected size
+    EXPECT_FALSE(LZ4::decompress(compressed.data(), compressed.size() / 2, output.data(), output.size()));
+    EXPECT_FALSE(LZ4::decompress(compressed.data(), compressed.size(), output.data(), output.size() - 1));
+}
@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+#include <TestHelpers.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <utility/SharedPointer.h>
+
+using namespace chira;
+
+struct SharedPointerTestBase {
+    explicit SharedPointerTestBase(int* destroyed_) : destroyed(destroyed_) {}
+    virtual ~SharedPointerTestBase() {
+        (*this->destroyed)++;
+    }
+    int* destroyed;
+};
+
+struct SharedPointerTestDerived : public SharedPointerTestBase {
+    SharedPointerTestDerived(int* destroyed_, int value_) : SharedPointerTestBase(destroyed_), value(value_) {}
+    int value;
+};
+
+TEST(SharedPointer, holderAmountForDelete) {
+    int destroyed = 0;
+    SharedPointer<SharedPointerTestBase> owner{new SharedPointerTestBase{&destroyed}};
+    {
+        auto copy = owner;
+        EXPECT_EQ(owner.useCount(), 2);
+    }
+    // The last copy besides the owner (the resource cache) deletes the object
+    EXPECT_EQ(destroyed, 1);
+    EXPECT_EQ(owner.useCount(), 1);
+
+    // Releasing the owner only frees the metadata, the object is already gone
+    owner = SharedPointer<SharedPointerTestBase>{new SharedPointerTestBase{&destroyed}};
+    EXPECT_EQ(destroyed, 1);
+
+    // With nothing to hold the pointer aside from the users, the last user deletes it
+    owner.setHolderAmountForDelete(0);
+    EXPECT_EQ(owner.getHolderAmountForDelete(), 0);
+    owner = SharedPointer<SharedPointerTestBase>{};
+    EXPECT_EQ(destroyed, 2);
+}
+
+TEST(SharedPointer, copyAssignmentReleasesOldReference) {
+    int destroyed = 0;
+    SharedPointer<SharedPointerTestBase> first{new SharedPointerTestBase{&destroyed}};
+    first.setHolderAmountForDelete(0);
+    SharedPointer<SharedPointerTestBase> second{new SharedPointerTestBase{&destroyed}};
+    second.setHolderAmountForDelete(0);
+    auto firstCopy = first;
+    EXPECT_EQ(first.useCount(), 2);
+    firstCopy = second;
+    EXPECT_EQ(first.useCount(), 1);
+    EXPECT_EQ(second.useCount(), 2);
+    firstCopy = firstCopy;
+    EXPECT_EQ(second.useCount(), 2);
+    EXPECT_EQ(destroyed, 0);
+}
+
+TEST(SharedPointer, moveAndConvert) {
+    int destroyed = 0;
+    {
+        auto derived = SharedPointer<SharedPointerTestDerived>::make(&destroyed, 42);
+        derived.setHolderAmountForDelete(0);
+        EXPECT_EQ(derived->value, 42);
+        SharedPointer<SharedPointerTestBase> base = std::move(derived);
+        EXPECT_FALSE(derived);
+        EXPECT_EQ(base.useCount(), 1);
+        auto castBack = base.castAssert<SharedPointerTestDerived>();
+        EXPECT_EQ(castBack->value, 42);
+        EXPECT_EQ(base.useCount(), 2);
+    }
+    EXPECT_EQ(destroyed, 1);
+}
+
+TEST(SharedPointer, makeKeepsHolderSemantics) {
+    int destroyed = 0;
+    auto owner = SharedPointer<SharedPointerTestBase>::make(&destroyed);
+    {
+        auto copy = owner;
+    }
+    // Destroyed in place, but the allocation stays until the owner lets go too
+    EXPECT_EQ(destroyed, 1);
+    EXPECT_EQ(owner.useCount(), 1);
+}
+
+TEST(SharedPointer, concurrentCopies) {
+    int destroyed = 0;
+    auto owner = SharedPointer<SharedPointerTestBase>::make(&destroyed);
+    auto holder = owner;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&owner] {
+            for (int i = 0; i < 100000; i++) {
+                auto copy = owner;
+                auto cast = copy.castStatic<SharedPointerTestBase>();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(owner.useCount(), 2);
+    EXPECT_EQ(destroyed, 0);
+}
+
+TEST(SharedPointer, concurrentRelease) {
+    // Every thread drops its copy at the same time, so any of them can be the one freeing the allocation
+    // Run with CHIRA_BUILD_WITH_SANITIZERS to catch the metadata being touched after it is freed
+    for (int i = 0; i < 500; i++) {
+        int destroyed = 0;
+        std::atomic_int lastHolders = 0;
+        auto onLastHolder = [](void* context, SharedPointerMetadata*) {
+            static_cast<std::atomic_int*>(context)->fetch_add(1);
+            return false;
+        };
+        auto owner = SharedPointer<SharedPointerTestBase>::make(&destroyed);
+        owner.setHolderAmountForDelete(0);
+        owner.setLastHolderCallback(onLastHolder, &lastHolders);
+        std::vector<SharedPointer<SharedPointerTestBase>> copies(4, owner);
+        owner = SharedPointer<SharedPointerTestBase>{};
+
+        std::atomic_bool start = false;
+        std::vector<std::thread> threads;
+        for (auto& copy : copies) {
+            threads.emplace_back([&start, copy = std::move(copy)]() mutable {
+                while (!start.load()) {}
+                copy = SharedPointer<SharedPointerTestBase>{};
+            });
+        }
+        start.store(true);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        EXPECT_EQ(lastHolders.load(), 1);
+        EXPECT_EQ(destroyed, 1);
+    }
+}
+
+namespace {
+
+/// The pre-atomic counting scheme, kept to compare against.
+template<typename T>
+class NonAtomicSharedPointer {
+public:
+    explicit NonAtomicSharedPointer(T* inputPtr) : ptr(inputPtr), data(new SharedPointerMetadataNonAtomic{}) {}
+    NonAtomicSharedPointer(const NonAtomicSharedPointer<T>& other) : ptr(other.ptr), data(other.data) {
+        this->data->refCount++;
+    }
+    NonAtomicSharedPointer<T>& operator=(const NonAtomicSharedPointer<T>& other) = delete;
+    ~NonAtomicSharedPointer() {
+        this->data->refCount--;
+        if (this->data->refCount == this->data->holderAmountForDelete) {
+            delete this->ptr;
+        }
+        if (this->data->refCount == 0) {
+            delete this->data;
+        }
+    }
+private:
+    struct SharedPointerMetadataNonAtomic {
+        unsigned int refCount = 1;
+        // Only the pointers being benchmarked hold it, there's no resource cache copy
+        unsigned int holderAmountForDelete = 0;
+    };
+    T* ptr;
+    SharedPointerMetadataNonAtomic* data;
+};
+
+template<typename Pointer>
+long long benchmarkCopies(const Pointer& source, int threadCount) {
+    constexpr int ROUNDS = 200;
+    constexpr int COPIES = 1000;
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&source] {
+            std::vector<Pointer> copies;
+            copies.reserve(COPIES);
+            for (int round = 0; round < ROUNDS; round++) {
+                for (int i = 0; i < COPIES; i++) {
+                    copies.push_back(source);
+                }
+                copies.clear();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return microsecondsSince(start);
+}
+
+} // namespace
+
+TEST(SharedPointer, copyBenchmark) {
+    int destroyed = 0;
+    NonAtomicSharedPointer<SharedPointerTestBase> nonAtomic{new SharedPointerTestBase{&destroyed}};
+    SharedPointer<SharedPointerTestBase> shared{new SharedPointerTestBase{&destroyed}};
+    shared.setHolderAmountForDelete(0);
+    auto standard = std::make_shared<SharedPointerTestBase>(&destroyed);
+
+    // The old counter isn't thread safe, it can only be measured on one thread
+    RecordProperty("non_atomic_1_thread_microseconds", static_cast<int>(benchmarkCopies(nonAtomic, 1)));
+    for (int threadCount : {1, 8}) {
+        const auto suffix = std::to_string(threadCount) + (threadCount == 1 ? "_thread_microseconds" : "_threads_microseconds");
+        RecordProperty("shared_pointer_" + suffix, static_cast<int>(benchmarkCopies(shared, threadCount)));
+        RecordProperty("std_shared_ptr_" + suffix, static_cast<int>(benchmarkCopies(standard, threadCount)));
+    }
+    EXPECT_EQ(destroyed, 0);
+}